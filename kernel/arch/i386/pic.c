@@ -49,4 +49,21 @@ void pic_send_eoi(uint8_t irq) {
         outb(PIC2_CMD, PIC_EOI);
     }
     outb(PIC1_CMD, PIC_EOI);
-}
\ No newline at end of file
+}
+
+void pic_unmask(uint8_t irq) {
+    if (irq >= 8) {
+        outb(PIC2_DATA, inb(PIC2_DATA) & (uint8_t)~(1u << (irq - 8)));
+        irq = 2;
+    }
+    outb(PIC1_DATA, inb(PIC1_DATA) & (uint8_t)~(1u << irq));
+}
+
+int pic_spurious(uint8_t irq) {
+    uint16_t cmd = irq >= 8 ? PIC2_CMD : PIC1_CMD;
+    outb(cmd, 0x0B);            /* OCW3: read the in-service register */
+    if (inb(cmd) & 0x80) return 0;
+    /* The master did see the cascade line, so it still wants its EOI. */
+    if (irq >= 8) outb(PIC1_CMD, PIC_EOI);
+    return 1;
+}
@@ -1,5 +1,35 @@
 #include <kernel/serial.h>
 #include <kernel/ports.h>
+#include <kernel/cpu.h>
+#include <kernel/waitq.h>
+
+/* COM1 runs polled until serial_enable_irq(); after that output goes into a
+   TX ring that the THRE interrupt drains a FIFO's worth at a time, and input
+   is pulled into an RX ring by the receive interrupts. Writers only spin
+   when the ring is full, and then push the FIFO themselves, since with
+   interrupts off (syscalls, ISRs, panic) nobody else will. */
+
+#define TX_SIZE 4096u   /* powers of two */
+#define RX_SIZE 256u
+#define UART_FIFO 16u   /* 16550A transmit FIFO depth */
+
+#define IER_RDA   0x01  /* received data available */
+#define IER_THRE  0x02  /* transmit holding register empty */
+#define IIR_NONE  0x01
+#define IIR_ID    0x0E
+#define IIR_THRE  0x02
+#define IIR_RDA   0x04
+#define IIR_RLS   0x06  /* line status */
+#define IIR_CTO   0x0C  /* character timeout */
+
+static uint8_t tx_buf[TX_SIZE];
+static uint8_t rx_buf[RX_SIZE];
+static volatile uint32_t tx_head, tx_tail, rx_head, rx_tail;
+static volatile int tx_busy;    /* FIFO loaded, THRE interrupt will follow */
+static int irq_mode;
+static uint32_t cur_baud = SERIAL_DEFAULT_BAUD;
+static struct serial_stats stats;
+static struct wait_queue rx_wq, tx_wq;
 
 static int serial_is_transmit_empty(void) {
     return inb(COM1_PORT + 5) & 0x20; // LSR bit 5: THR empty
@@ -9,30 +39,127 @@ static int serial_has_data(void) {
     return inb(COM1_PORT + 5) & 0x01; // LSR bit 0: data ready
 }
 
+/* Load up to one FIFO from the ring. Interrupts off, transmitter empty. */
+static void tx_fill(void) {
+    uint32_t n = 0;
+    while (n < UART_FIFO && tx_tail != tx_head) {
+        outb(COM1_PORT, tx_buf[tx_tail & (TX_SIZE - 1)]);
+        tx_tail++;
+        n++;
+    }
+    stats.tx_bytes += n;
+    tx_busy = n != 0;
+    if (n) waitq_wake(&tx_wq);
+}
+
+static void rx_drain(void) {
+    uint32_t before = rx_head;
+    while (serial_has_data()) {
+        uint8_t c = inb(COM1_PORT);
+        if (rx_head - rx_tail < RX_SIZE) {
+            rx_buf[rx_head & (RX_SIZE - 1)] = c;
+            rx_head++;
+            stats.rx_bytes++;
+        } else {
+            stats.rx_dropped++;
+        }
+    }
+    if (rx_head != before) waitq_wake(&rx_wq);
+}
+
+static void tx_put(uint8_t c) {
+    while (tx_head - tx_tail >= TX_SIZE) {
+        stats.tx_full++;
+        while (!serial_is_transmit_empty()) {}
+        tx_fill();
+    }
+    tx_buf[tx_head & (TX_SIZE - 1)] = c;
+    tx_head++;
+}
+
 void serial_init(void) {
     // Disable interrupts
     outb(COM1_PORT + 1, 0x00);
-    // Enable DLAB
-    outb(COM1_PORT + 3, 0x80);
-    // Set baud rate divisor for 115200/baud. For 38400: divisor=3.
-    outb(COM1_PORT + 0, 0x03); // low byte (3)
-    outb(COM1_PORT + 1, 0x00); // high byte
-    // 8 bits, no parity, one stop, disable DLAB
-    outb(COM1_PORT + 3, 0x03);
+    serial_set_baud(SERIAL_DEFAULT_BAUD);
     // Enable FIFO, clear them, 14-byte threshold
     outb(COM1_PORT + 2, 0xC7);
     // IRQs disabled, RTS/DSR set
     outb(COM1_PORT + 4, 0x0B);
 }
 
+int serial_set_baud(uint32_t baud) {
+    if (baud == 0 || baud > SERIAL_UART_CLOCK / 16u) return -1;
+    uint32_t divisor = SERIAL_UART_CLOCK / 16u / baud;
+    if (divisor > 0xFFFF) return -1;
+    /* Let anything already queued go out at the old rate. */
+    serial_flush();
+    uint32_t flags = irq_save();
+    uint8_t lcr = 0x03; // 8 bits, no parity, one stop
+    outb(COM1_PORT + 3, 0x80 | lcr);   // DLAB on
+    outb(COM1_PORT + 0, (uint8_t)(divisor & 0xFF));
+    outb(COM1_PORT + 1, (uint8_t)(divisor >> 8));
+    outb(COM1_PORT + 3, lcr);          // DLAB off
+    cur_baud = SERIAL_UART_CLOCK / 16u / divisor;
+    irq_restore(flags);
+    return 0;
+}
+
+uint32_t serial_get_baud(void) {
+    return cur_baud;
+}
+
+void serial_enable_irq(void) {
+    uint32_t flags = irq_save();
+    while (!serial_is_transmit_empty()) {}
+    rx_drain();
+    tx_busy = 0;
+    irq_mode = 1;
+    // OUT2 gates the UART interrupt line onto the PIC
+    outb(COM1_PORT + 4, 0x0B);
+    outb(COM1_PORT + 1, IER_RDA | IER_THRE);
+    irq_restore(flags);
+}
+
+void serial_irq(void) {
+    stats.irqs++;
+    for (int guard = 0; guard < 16; ++guard) {
+        uint8_t iir = inb(COM1_PORT + 2);
+        if (iir & IIR_NONE) break;
+        switch (iir & IIR_ID) {
+            case IIR_THRE:
+                tx_fill();
+                break;
+            case IIR_RDA:
+            case IIR_CTO:
+                rx_drain();
+                break;
+            case IIR_RLS:
+                (void)inb(COM1_PORT + 5);
+                break;
+            default: // modem status
+                (void)inb(COM1_PORT + 6);
+                break;
+        }
+    }
+}
+
 void serial_putchar(char c) {
-    if (c == '\n') {
-        // Convert LF to CRLF for terminals
+    if (!irq_mode) {
+        if (c == '\n') {
+            // Convert LF to CRLF for terminals
+            while (!serial_is_transmit_empty()) {}
+            outb(COM1_PORT, '\r');
+        }
         while (!serial_is_transmit_empty()) {}
-        outb(COM1_PORT, '\r');
+        outb(COM1_PORT, (uint8_t)c);
+        return;
     }
-    while (!serial_is_transmit_empty()) {}
-    outb(COM1_PORT, (uint8_t)c);
+    uint32_t flags = irq_save();
+    if (c == '\n') tx_put('\r');
+    tx_put((uint8_t)c);
+    /* Transmitter idle: prime it, the THRE interrupt keeps it going. */
+    if (!tx_busy) tx_fill();
+    irq_restore(flags);
 }
 
 void serial_writestring(const char* s) {
@@ -42,13 +169,60 @@ void serial_writestring(const char* s) {
     }
 }
 
+void serial_flush(void) {
+    if (!irq_mode) return;
+    uint32_t flags = irq_save();
+    while (tx_tail != tx_head) {
+        while (!serial_is_transmit_empty()) {}
+        tx_fill();
+    }
+    while (!serial_is_transmit_empty()) {}
+    irq_restore(flags);
+}
+
 int serial_available(void) {
-    return serial_has_data();
+    if (!irq_mode) return serial_has_data();
+    if (rx_head == rx_tail) {
+        /* Interrupts may be off (caller inside a syscall); look directly. */
+        uint32_t flags = irq_save();
+        rx_drain();
+        irq_restore(flags);
+    }
+    return rx_head != rx_tail;
 }
 
 int serial_getchar(void) {
-    if (!serial_has_data()) {
-        return -1;
+    if (!irq_mode) {
+        if (!serial_has_data()) {
+            return -1;
+        }
+        return (int)inb(COM1_PORT);
     }
-    return (int)inb(COM1_PORT);
+    if (!serial_available()) return -1;
+    uint32_t flags = irq_save();
+    int c = rx_buf[rx_tail & (RX_SIZE - 1)];
+    rx_tail++;
+    irq_restore(flags);
+    return c;
+}
+
+void serial_get_stats(struct serial_stats* out) {
+    uint32_t flags = irq_save();
+    *out = stats;
+    out->baud = cur_baud;
+    out->tx_queued = tx_head - tx_tail;
+    out->irq_mode = (uint32_t)irq_mode;
+    irq_restore(flags);
+}
+
+uint32_t serial_tx_room(void) {
+    return irq_mode ? TX_SIZE - (tx_head - tx_tail) : 1u;
+}
+
+struct wait_queue* serial_rx_waitq(void) {
+    return &rx_wq;
+}
+
+struct wait_queue* serial_tx_waitq(void) {
+    return &tx_wq;
 }
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include <kernel/tty.h>
+#include <kernel/ports.h>
 
 /* We must include vga.h from its *new* location */
 #include "vga.h"
@@ -12,6 +13,15 @@
 #define VGA_HEIGHT 25
 #define SCROLLBACK_LINES 256
 
+/* Text memory holds 32 KiB (204 rows); the visible window slides down it
+   by moving the CRTC start address, and is copied back to the top when it
+   reaches the end. */
+#define VGA_MEM_ROWS (0x8000 / 2 / VGA_WIDTH)
+#define CRTC_INDEX 0x3D4
+#define CRTC_DATA  0x3D5
+#define CRTC_START_HI 0x0C
+#define CRTC_START_LO 0x0D
+
 /*
  * --- THIS IS THE FIX ---
  * The VGA buffer is *physically* at 0xB8000.
@@ -32,7 +42,17 @@ static size_t terminal_column;
 static uint8_t terminal_color;
 static uint16_t* terminal_buffer;
 
+/* The shadow screen is a ring of rows: logical row y lives in row
+   (screen_top + y) % VGA_HEIGHT, so scrolling it moves no memory. Each
+   shadow row remembers the columns [dirty_lo, dirty_hi) that VGA memory
+   has not seen yet; terminal_flush copies only those. */
 static uint16_t terminal_screen[VGA_WIDTH * VGA_HEIGHT];
+static size_t screen_top;
+static uint8_t dirty_lo[VGA_HEIGHT];
+static uint8_t dirty_hi[VGA_HEIGHT];
+static size_t vga_origin;           /* VGA row shown at the top of the screen */
+static size_t crtc_origin;          /* what the CRTC was last told */
+
 static uint16_t scrollback[SCROLLBACK_LINES][VGA_WIDTH];
 static size_t scrollback_head;
 static size_t scrollback_count;
@@ -42,6 +62,51 @@ static void terminal_render(void);
 static void scrollback_push_line(const uint16_t* line);
 static size_t scrollback_base_index(void);
 
+static uint16_t* screen_row(size_t y) {
+    return &terminal_screen[((screen_top + y) % VGA_HEIGHT) * VGA_WIDTH];
+}
+
+static void mark_dirty(size_t y, size_t lo, size_t hi) {
+    size_t r = (screen_top + y) % VGA_HEIGHT;
+    if (dirty_lo[r] >= dirty_hi[r]) {
+        dirty_lo[r] = (uint8_t)lo;
+        dirty_hi[r] = (uint8_t)hi;
+        return;
+    }
+    if (lo < dirty_lo[r]) dirty_lo[r] = (uint8_t)lo;
+    if (hi > dirty_hi[r]) dirty_hi[r] = (uint8_t)hi;
+}
+
+static void clear_dirty(void) {
+    for (size_t r = 0; r < VGA_HEIGHT; r++) {
+        dirty_lo[r] = dirty_hi[r] = 0;
+    }
+}
+
+static void crtc_set_origin(void) {
+    uint16_t start = (uint16_t)(vga_origin * VGA_WIDTH);
+    outb(CRTC_INDEX, CRTC_START_HI);
+    outb(CRTC_DATA, (uint8_t)(start >> 8));
+    outb(CRTC_INDEX, CRTC_START_LO);
+    outb(CRTC_DATA, (uint8_t)start);
+    crtc_origin = vga_origin;
+}
+
+void terminal_flush(void) {
+    if (display_offset > 0) return;     /* the scrollback view owns VGA memory */
+    for (size_t y = 0; y < VGA_HEIGHT; y++) {
+        size_t r = (screen_top + y) % VGA_HEIGHT;
+        if (dirty_lo[r] >= dirty_hi[r]) continue;
+        size_t lo = dirty_lo[r], n = (size_t)dirty_hi[r] - lo;
+        memcpy(&terminal_buffer[(vga_origin + y) * VGA_WIDTH + lo],
+               &terminal_screen[r * VGA_WIDTH + lo], n * sizeof(uint16_t));
+        dirty_lo[r] = dirty_hi[r] = 0;
+    }
+    if (crtc_origin != vga_origin) {
+        crtc_set_origin();
+    }
+}
+
 void terminal_initialize(void) {
 	terminal_row = 0;
 	terminal_column = 0;
@@ -50,6 +115,8 @@ void terminal_initialize(void) {
     scrollback_head = 0;
     scrollback_count = 0;
     display_offset = 0;
+    screen_top = 0;
+    vga_origin = 0;
     for (size_t y = 0; y < VGA_HEIGHT; y++) {
         for (size_t x = 0; x < VGA_WIDTH; x++) {
             const size_t index = y * VGA_WIDTH + x;
@@ -57,6 +124,7 @@ void terminal_initialize(void) {
         }
     }
     terminal_render();
+    crtc_set_origin();
 }
 
 /* ... The rest of tty.c (terminal_setcolor, terminal_putentryat, etc.)
@@ -66,12 +134,10 @@ void terminal_setcolor(uint8_t color) {
 	terminal_color = color;
 }
 
+/* Shadow only; terminal_flush() brings VGA memory up to date. */
 void terminal_putentryat(unsigned char c, uint8_t color, size_t x, size_t y) {
-    const size_t index = y * VGA_WIDTH + x;
-    terminal_screen[index] = vga_entry(c, color);
-    if (display_offset == 0) {
-        terminal_buffer[index] = terminal_screen[index];
-    }
+    screen_row(y)[x] = vga_entry(c, color);
+    mark_dirty(y, x, x + 1);
 }
 
 /*
@@ -93,6 +159,8 @@ static size_t scrollback_base_index(void) {
     return (scrollback_head + SCROLLBACK_LINES - scrollback_count) % SCROLLBACK_LINES;
 }
 
+/* Redraw the whole window at the current origin: the live screen, or the
+   scrollback view display_offset lines up. */
 static void terminal_render(void) {
     if (display_offset > scrollback_count) {
         display_offset = scrollback_count;
@@ -105,14 +173,14 @@ static void terminal_render(void) {
     const size_t base = scrollback_base_index();
     for (size_t y = 0; y < VGA_HEIGHT; y++) {
         size_t line_index = start_line + y;
-        uint16_t* dest = &terminal_buffer[y * VGA_WIDTH];
+        uint16_t* dest = &terminal_buffer[(vga_origin + y) * VGA_WIDTH];
         if (line_index < scrollback_count) {
             size_t idx = (base + line_index) % SCROLLBACK_LINES;
             memcpy(dest, scrollback[idx], VGA_WIDTH * sizeof(uint16_t));
         } else {
             size_t screen_line = line_index - scrollback_count;
             if (screen_line < VGA_HEIGHT) {
-                memcpy(dest, &terminal_screen[screen_line * VGA_WIDTH], VGA_WIDTH * sizeof(uint16_t));
+                memcpy(dest, screen_row(screen_line), VGA_WIDTH * sizeof(uint16_t));
             } else {
                 for (size_t x = 0; x < VGA_WIDTH; x++) {
                     dest[x] = vga_entry(' ', terminal_color);
@@ -120,35 +188,37 @@ static void terminal_render(void) {
             }
         }
     }
+    if (display_offset == 0) {
+        clear_dirty();
+    }
 }
 
+/* New blank bottom row. The rows above keep their VGA copies: moving the
+   origin down one row shows them one line higher. */
 static void terminal_scroll_line(void) {
-    scrollback_push_line(&terminal_screen[0]);
-    memmove(terminal_screen,
-            terminal_screen + VGA_WIDTH,
-            (VGA_HEIGHT - 1) * VGA_WIDTH * sizeof(uint16_t));
-    const size_t last_row_index = (VGA_HEIGHT - 1) * VGA_WIDTH;
+    uint16_t* top = screen_row(0);
+    scrollback_push_line(top);
+    screen_top = (screen_top + 1) % VGA_HEIGHT;
     for (size_t x = 0; x < VGA_WIDTH; x++) {
-        terminal_screen[last_row_index + x] = vga_entry(' ', terminal_color);
+        top[x] = vga_entry(' ', terminal_color);
     }
+    size_t r = (screen_top + VGA_HEIGHT - 1) % VGA_HEIGHT;
+    dirty_lo[r] = 0;
+    dirty_hi[r] = VGA_WIDTH;
     terminal_row = VGA_HEIGHT - 1;
     terminal_column = 0;
-    if (display_offset < scrollback_count) {
-        display_offset++;
-        if (display_offset > scrollback_count) {
-            display_offset = scrollback_count;
+    if (++vga_origin + VGA_HEIGHT > VGA_MEM_ROWS) {
+        /* Out of text memory: start again at the top, all rows redrawn. */
+        vga_origin = 0;
+        for (size_t i = 0; i < VGA_HEIGHT; i++) {
+            dirty_lo[i] = 0;
+            dirty_hi[i] = VGA_WIDTH;
         }
     }
-    terminal_render();
 }
 
-void terminal_putchar(char c) {
-    unsigned char uc = c;
-
-    if (display_offset > 0) {
-        terminal_scroll_to_bottom();
-    }
-
+/* One character into the shadow screen. */
+static void terminal_emit(unsigned char uc) {
     if (uc == '\b') {
         if (terminal_column > 0) {
             terminal_column--;
@@ -184,9 +254,47 @@ void terminal_putchar(char c) {
     }
 }
 
+void terminal_putchar(char c) {
+    if (display_offset > 0) {
+        terminal_scroll_to_bottom();
+    }
+    terminal_emit((unsigned char)c);
+    terminal_flush();
+}
+
+/* Runs of printable characters go straight into the shadow row; VGA
+   memory and the CRTC are touched once, for the rows still on screen. */
 void terminal_write(const char* data, size_t size) {
-	for (size_t i = 0; i < size; i++)
-		terminal_putchar(data[i]);
+    if (display_offset > 0) {
+        terminal_scroll_to_bottom();
+    }
+    size_t i = 0;
+    while (i < size) {
+        unsigned char uc = (unsigned char)data[i];
+        if (uc < ' ') {
+            terminal_emit(uc);
+            i++;
+            continue;
+        }
+        size_t n = VGA_WIDTH - terminal_column - 1;
+        size_t end = i;
+        while (end < size && end - i < n && (unsigned char)data[end] >= ' ') end++;
+        uint16_t* row = screen_row(terminal_row);
+        for (size_t k = i; k < end; k++) {
+            row[terminal_column + (k - i)] = vga_entry((unsigned char)data[k], terminal_color);
+        }
+        if (end > i) {
+            mark_dirty(terminal_row, terminal_column, terminal_column + (end - i));
+            terminal_column += end - i;
+            i = end;
+        }
+        /* The last column goes through terminal_emit for the wrap. */
+        if (i < size && (unsigned char)data[i] >= ' ') {
+            terminal_emit((unsigned char)data[i]);
+            i++;
+        }
+    }
+    terminal_flush();
 }
 
 void terminal_writestring(const char* data) {
@@ -202,6 +310,7 @@ void terminal_clear(void) {
     }
     terminal_row = 0;
     terminal_column = 0;
+    screen_top = 0;
     scrollback_head = 0;
     scrollback_count = 0;
     display_offset = 0;
@@ -226,11 +335,17 @@ void terminal_scroll_view(int delta) {
         }
     }
     terminal_render();
+    if (crtc_origin != vga_origin) {
+        crtc_set_origin();
+    }
 }
 
 void terminal_scroll_to_bottom(void) {
     display_offset = 0;
     terminal_render();
+    if (crtc_origin != vga_origin) {
+        crtc_set_origin();
+    }
 }
 
 size_t terminal_get_scroll_offset(void) {
@@ -12,6 +12,15 @@ struct GdtEntry gdt[GDT_ENTRIES];
 struct GdtPtr   gdt_ptr;
 
 static struct TssEntry tss_entry;
+static int sysenter_on;
+
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+static inline void wrmsr(uint32_t msr, uint32_t lo) {
+    __asm__ volatile("wrmsr" :: "c"(msr), "a"(lo), "d"(0));
+}
 
 /* Helper function to create a GDT entry */
 void gdt_set_entry(int index, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
@@ -77,4 +86,27 @@ void gdt_initialize(void) {
 
 void tss_set_kernel_stack(uint32_t esp0) {
     tss_entry.esp0 = esp0;
+    /* SYSENTER runs on the same kernel stack as int 0x80. */
+    if (sysenter_on) wrmsr(MSR_SYSENTER_ESP, esp0);
+}
+
+int sysenter_init(void) {
+    extern void sysenter_entry(void);
+    uint32_t eax, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    if (!(edx & (1u << 11))) return -1;
+    /* Pentium Pro before model 3 stepping 3 sets SEP without SYSENTER. */
+    uint32_t family = (eax >> 8) & 0xF, model = (eax >> 4) & 0xF, stepping = eax & 0xF;
+    if (family == 6 && model < 3 && stepping < 3) return -1;
+    /* SYSEXIT derives the user selectors from CS: +16 code, +24 stack,
+       which is why the GDT keeps user code/data right after kernel data. */
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+    wrmsr(MSR_SYSENTER_ESP, tss_entry.esp0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+    sysenter_on = 1;
+    return 0;
+}
+
+int sysenter_enabled(void) {
+    return sysenter_on;
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <kernel/tty.h>
 #include <kernel/stdio.h>
 #include <kernel/pic.h>
+#include <kernel/mmap.h>
+#include <kernel/proc.h>
+#include <kernel/serial.h>
 
 /* --- External Assembly Functions --- */
 extern void idt_load(struct IdtPtr* idt_ptr);
@@ -46,6 +49,17 @@ void isr_fault_handler(struct registers* regs) {
         syscall_dispatch(regs);
         return;
     }
+    /* Demand paging for file mappings; anything else is fatal. */
+    if (regs->int_num == 14) {
+        uint32_t fault_addr;
+        asm volatile("movl %%cr2, %0" : "=r"(fault_addr));
+        int r = mmap_handle_fault(fault_addr, regs->err_code);
+        if (r == 0) return;
+        if (r == MMAP_FAULT_SIGBUS && (regs->cs & 3) == 3 && proc_prepare_kernel_return(regs, MMAP_SIGBUS_EXIT)) {
+            printf("bus error: access at 0x%x past end of mapped file\n", fault_addr);
+            proc_switch_to_kernel_now();
+        }
+    }
     printf("--- KERNEL PANIC ---\n");
     printf("Received Exception: %d\n", regs->int_num);
     if (regs->int_num == 13) {
@@ -74,6 +88,7 @@ void isr_fault_handler(struct registers* regs) {
     }
     
     printf("Halting system.\n");
+    serial_flush();
     for (;;) {
         asm volatile ("cli; hlt");
     }
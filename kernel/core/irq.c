@@ -1,4 +1,5 @@
 #include <kernel/idt.h>
+#include <kernel/irq.h>
 #include <kernel/pic.h>
 #include <kernel/stdio.h>
 #include <kernel/keyboard.h>
@@ -6,20 +7,47 @@
 #include <kernel/ports.h>
 #include <kernel/sched.h>
 #include <kernel/process.h>
+#include <kernel/vdso.h>
+#include <kernel/serial.h>
 
 /* Forward declare stubs from irq.S */
-extern void irq0();
-extern void irq1();
-/* ... and so on ... */
+extern void irq0(), irq1(), irq2(), irq3(), irq4(), irq5(), irq6(), irq7();
+extern void irq8(), irq9(), irq10(), irq11(), irq12(), irq13(), irq14(), irq15();
+
+static void (*const irq_stubs[IRQ_LINES])() = {
+    irq0, irq1, irq2, irq3, irq4, irq5, irq6, irq7,
+    irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15,
+};
+
+/* Driver handlers per line, filled by irq_register. */
+static irq_fn handlers[IRQ_LINES][IRQ_MAX_SHARED];
+
+int irq_register(uint8_t irq, irq_fn fn) {
+    if (irq >= IRQ_LINES || !fn) return -1;
+    for (int i = 0; i < IRQ_MAX_SHARED; ++i) {
+        if (!handlers[irq][i]) {
+            handlers[irq][i] = fn;
+            pic_unmask(irq);
+            return 0;
+        }
+    }
+    printf("irq: line %u already has %d handlers\n", irq, IRQ_MAX_SHARED);
+    return -1;
+}
+
+/* Run the drivers on a line; 1 if any is hooked there. */
+static int run_handlers(uint8_t irq) {
+    if (!handlers[irq][0]) return 0;
+    for (int i = 0; i < IRQ_MAX_SHARED && handlers[irq][i]; ++i) {
+        handlers[irq][i]();
+    }
+    return 1;
+}
 
 static void timer_handler(struct registers* regs) {
     pit_on_tick();
+    vdso_tick();
     sched_tick();
-    
-    /* Poll USB devices */
-    extern void usb_poll(void);
-    usb_poll();
-    
     process_schedule(regs);  // Schedule user processes
 }
 
@@ -40,17 +68,24 @@ void irq_handler(struct registers* regs) {
        to get the actual IRQ number (0-15) for the PIC. */
     uint8_t irq_num = regs->int_num - 32;
 
+    if ((irq_num == 7 || irq_num == 15) && pic_spurious(irq_num)) return;
+
     /* Handle the specific IRQ */
     /* We now use '->' (pointer) instead of '.' (value) */
     switch (irq_num) {
         case 0: /* IRQ 0: Timer */
+            /* Drivers that could not get a line of their own ride here. */
+            run_handlers(0);
             timer_handler(regs);
             break;
         case 1: /* IRQ 1: Keyboard */
             keyboard_handler();
             break;
+        case COM1_IRQ: /* IRQ 4: COM1 */
+            serial_irq();
+            break;
         default:
-            printf("Unhandled IRQ: %d\n", irq_num);
+            if (!run_handlers(irq_num)) printf("Unhandled IRQ: %d\n", irq_num);
     }
     /* Acknowledge the interrupt by sending EOI to the PIC */
     pic_send_eoi(irq_num);
@@ -64,11 +99,12 @@ void irq_install(void) {
     
     /* 0x08 is Kernel Code Segment */
     /* 0x8E is 32-bit Interrupt Gate */
-    idt_set_entry(32, (uint32_t)irq0, 0x08, 0x8E);
-    idt_set_entry(33, (uint32_t)irq1, 0x08, 0x8E);
-    /* ... and so on ... */
+    for (int i = 0; i < IRQ_LINES; ++i) {
+        idt_set_entry(32 + i, (uint32_t)irq_stubs[i], 0x08, 0x8E);
+    }
 
-    /* Enable (unmask) Timer (IRQ 0) and Keyboard (IRQ 1) */
-    /* 0xFC = 11111100 (unmask 0 and 1) */
-    outb(PIC1_DATA, inb(PIC1_DATA) & 0xFC);
+    /* Enable (unmask) Timer (IRQ 0), Keyboard (IRQ 1) and COM1 (IRQ 4) */
+    /* 0xEC = 11101100 (unmask 0, 1 and 4); the UART stays quiet until
+       serial_enable_irq() sets its IER. Other lines open in irq_register. */
+    outb(PIC1_DATA, inb(PIC1_DATA) & 0xEC);
 }
@@ -14,7 +14,13 @@
 #include <kernel/block.h>
 #include <kernel/sched.h>
 #include <kernel/process.h>
+#include <kernel/ipc.h>
+#include <kernel/klog.h>
+#include <kernel/ehci.h>
+#include <kernel/vdso.h>
+#include <kernel/serial.h>
 #include <kernel/ports.h>
+#include <kernel/cpu.h>
 
 extern void enter_user_mode(void* entry, uint32_t user_stack);
 
@@ -24,6 +30,7 @@ extern void enter_user_mode(void* entry, uint32_t user_stack);
  */
 void kernel_main(uint32_t magic, uint32_t multiboot_addr) {
     /* Boot code already switched to a high kernel stack before calling us. */
+    uint64_t boot_start = rdtsc();
 
         /*
          * 2. Initialize all kernel subsystems.
@@ -68,51 +75,75 @@ void kernel_main(uint32_t magic, uint32_t multiboot_addr) {
     /* Set TSS kernel stack (use current esp) for privilege transitions */
     uint32_t cur_esp; __asm__ volatile("movl %%esp, %0" : "=r"(cur_esp));
     tss_set_kernel_stack(cur_esp);
+    klog(KLOG_CORE, KLOG_INFO, "SYSENTER fast system calls: %s\n", sysenter_init() == 0 ? "enabled" : "not supported");
+    vdso_init();
 
     /* Bootstrap a small heap at 0xC0200000, map ~64 KiB initially */
     kmalloc_init((void*)0xC0200000u, 64*1024);
     void* test = kmalloc(1024);
-    printf("kmalloc(1024) -> %p (phys %x)\n", test, vmm_resolve((uint32_t)test));
+    klog(KLOG_MM, KLOG_DEBUG, "kmalloc(1024) -> %p (phys %x)\n", test, vmm_resolve((uint32_t)test));
 
     /* Init keyboard driver */
     keyboard_init();
     
+    /* EHCI first: it hands low- and full-speed ports to the UHCI companion */
+    if (ehci_init() != 0) {
+        klog(KLOG_USB, KLOG_DEBUG, "usb: no EHCI controller\n");
+    }
+
     /* Init USB (for USB keyboards) */
     extern int usb_init(void);
     if (usb_init() != 0) {
-        printf("usb: no USB controller found, using PS/2 only\n");
+        klog(KLOG_USB, KLOG_INFO, "usb: no USB controller found, using PS/2 only\n");
     }
     
     /* Init block layer (optional) */
     if (block_init() != 0) {
-        printf("block: no ATA disk detected, continuing with modules\n");
+        klog(KLOG_BLOCK, KLOG_INFO, "block: no ATA disk detected, continuing with modules\n");
     }
 
     /* Init filesystem (ext2 preferred if present) */
     fs_init();
     /* Init scheduler */
     sched_init();
+    /* Log thread: records so far (and from now on) reach the consoles when idle */
+    klog_init();
     /* Init process management */
     process_init();
     
+    /* Start IPC servers (kernel threads; interrupts still off) */
+    ipc_init();
+
     /* Init HTAS scheduler */
     extern void htas_init(void);
     htas_init();
-    printf("HTAS: Initialized (4 CPUs, 2 NUMA nodes)\n");
+    klog(KLOG_CORE, KLOG_INFO, "HTAS: Initialized (4 CPUs, 2 NUMA nodes)\n");
     
     /* Accessing multiboot info (must add offset) */
     if (magic == 0x2BADB002) {
-        printf("Multiboot magic is correct.\n");
+        klog(KLOG_CORE, KLOG_DEBUG, "Multiboot magic is correct.\n");
         /* struct multiboot_info* mb_info = (struct multiboot_info*)(multiboot_addr + 0xC0000000); */
         /* printf("Mem lower: %dKB\n", mb_info->mem_lower); */
     }
 
-    /* Enable interrupts for timer and keyboard */
+    /* Serial output from here on is buffered and drained by IRQ 4 */
+    serial_enable_irq();
+    klog(KLOG_CORE, KLOG_INFO, "serial: COM1 interrupt-driven at %u baud\n", serial_get_baud());
+
+    /* Enable interrupts for timer, keyboard and serial */
     asm volatile ("sti");
     
     printf("\n*** NOTE: Type commands in the TERMINAL (not GUI window) ***\n");
     printf("*** Serial console is active and working! ***\n\n");
 
+    /* Console time of the deferred records shows up under `klog` once
+       klogd has written them out; it no longer counts here. */
+    uint64_t boot_end = rdtsc();
+    struct klog_stats ks;
+    klog_get_stats(&ks);
+    printf("boot: %u Mcycles to the shell, %u log records deferred\n",
+           (uint32_t)((boot_end - boot_start) >> 20), ks.records);
+
     /* Start interactive shell */
     extern void shell_run(void);
     shell_run();
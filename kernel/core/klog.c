@@ -0,0 +1,200 @@
+#include <kernel/klog.h>
+#include <kernel/cpu.h>
+#include <kernel/sched.h>
+#include <kernel/pit.h>
+#include <kernel/tty.h>
+#include <kernel/serial.h>
+#include <kernel/stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+/* Writers claim a slot by bumping head atomically and publish it by
+   storing its sequence number last, so an interrupt handler logging in
+   the middle of another klog() gets a slot of its own. The reader copies
+   a record out and checks the sequence again; a slot overwritten under it
+   counts as dropped. When the ring laps the reader the oldest records are
+   lost, not the newest. */
+
+#define KLOG_DRAIN_BATCH 32         /* records per run of the log thread */
+
+struct klog_rec {
+    volatile uint32_t seq;          /* index + 1 once complete, 0 while written */
+    uint32_t ms;
+    uint8_t  level;
+    uint8_t  subsys;
+    uint8_t  len;
+    uint8_t  pad;
+    char     text[KLOG_TEXT];
+};
+
+static struct klog_rec ring[KLOG_RING];
+static volatile uint32_t head;      /* next index to claim */
+static uint32_t cursor;             /* next index to write out */
+static volatile uint32_t draining;
+static uint32_t enabled = (1u << KLOG_NSUBSYS) - 1;
+static int console_level = KLOG_INFO;
+static int log_tid = -1;
+static int kicker = -1;             /* thread the log thread returns to */
+static struct klog_stats stats;
+
+static const char* subsys_names[KLOG_NSUBSYS] = {
+    "core", "mm", "proc", "fs", "elf", "block", "usb"
+};
+static const char* level_names[4] = { "err", "warn", "info", "debug" };
+
+static uint32_t now_ms(void) {
+    uint32_t hz = pit_hz();
+    return hz ? (uint32_t)((pit_ticks() * 1000u) / hz) : 0u;
+}
+
+void klog(int subsys, int level, const char* fmt, ...) {
+    if (subsys < 0 || subsys >= KLOG_NSUBSYS || !(enabled & (1u << subsys))) return;
+    uint32_t idx = __atomic_fetch_add(&head, 1, __ATOMIC_RELAXED);
+    struct klog_rec* r = &ring[idx & (KLOG_RING - 1)];
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(r->text, sizeof(r->text), fmt, args);
+    va_end(args);
+    r->len = (uint8_t)(n < (int)sizeof(r->text) ? n : (int)sizeof(r->text) - 1);
+    r->ms = now_ms();
+    r->level = (uint8_t)level;
+    r->subsys = (uint8_t)subsys;
+    __atomic_store_n(&r->seq, idx + 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&stats.records, 1, __ATOMIC_RELAXED);
+    if (level <= KLOG_WARN) klog_flush();
+}
+
+/* Copy the record at index idx out of the ring; 1 if it was intact. */
+static int snapshot(uint32_t idx, struct klog_rec* out) {
+    const struct klog_rec* r = &ring[idx & (KLOG_RING - 1)];
+    if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != idx + 1) return 0;
+    memcpy(out, (const void*)r, sizeof(*out));
+    return __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) == idx + 1;
+}
+
+static void console_out(const char* s, unsigned len) {
+    for (unsigned i = 0; i < len; i++) serial_putchar(s[i]);
+    terminal_write(s, len);
+}
+
+/* Write out up to max pending records; returns how many were consumed.
+   Only one drain runs at a time; a nested caller leaves it to the first. */
+static uint32_t drain(uint32_t max) {
+    if (__atomic_exchange_n(&draining, 1, __ATOMIC_ACQUIRE)) return 0;
+    uint32_t done = 0;
+    struct klog_rec rec;
+    while (done < max) {
+        uint32_t h = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+        if (cursor == h) break;
+        if (h - cursor > KLOG_RING) {
+            stats.dropped += h - cursor - KLOG_RING;
+            cursor = h - KLOG_RING;
+        }
+        if (!snapshot(cursor, &rec)) {
+            uint32_t s = ring[cursor & (KLOG_RING - 1)].seq;
+            if (s == 0 || s <= cursor) {
+                /* Claimed but not finished: wait for it, unless the ring
+                   lapped us meanwhile. */
+                if (__atomic_load_n(&head, __ATOMIC_ACQUIRE) - cursor > KLOG_RING) continue;
+                break;
+            }
+            stats.dropped++;        /* overwritten by a newer record */
+        } else if (rec.level <= console_level) {
+            console_out(rec.text, rec.len);
+        }
+        cursor++;
+        done++;
+    }
+    __atomic_store_n(&draining, 0, __ATOMIC_RELEASE);
+    return done;
+}
+
+void klog_flush(void) {
+    while (drain(KLOG_RING)) {}
+}
+
+/* Lowest priority: never picked by the scheduler, only switched to from
+   klog_idle, and hands the CPU straight back after one batch. */
+static void log_thread(void* arg) {
+    (void)arg;
+    for (;;) {
+        uint64_t t0 = rdtsc();
+        uint64_t k0 = pit_ticks();
+        uint32_t n = drain(KLOG_DRAIN_BATCH);
+        stats.deferred += n;
+        stats.drain_cycles += rdtsc() - t0;
+        stats.drain_ticks += (uint32_t)(pit_ticks() - k0);
+        sched_switch_to(kicker);
+    }
+}
+
+void klog_init(void) {
+    log_tid = kthread_create_blocked(log_thread, 0, "klogd");
+    if (log_tid < 0) {
+        printf("klog: no log thread, flushing synchronously\n");
+        return;
+    }
+    sched_set_priority(log_tid, SCHED_PRIORITY_BATCH);
+}
+
+void klog_idle(void) {
+    if (log_tid < 0) {
+        klog_flush();
+        return;
+    }
+    if (cursor == head || sched_current() == log_tid || draining) return;
+    uint32_t flags = irq_save();
+    kicker = sched_current();
+    sched_switch_to(log_tid);
+    irq_restore(flags);
+}
+
+void klog_dmesg(int level) {
+    uint32_t h = head;
+    uint32_t from = h > KLOG_RING ? h - KLOG_RING : 0;
+    struct klog_rec rec;
+    char stamp[40];
+    for (uint32_t i = from; i < h; ++i) {
+        if (!snapshot(i, &rec) || rec.level > level) continue;
+        uint32_t frac = rec.ms % 1000u;
+        int n = snprintf(stamp, sizeof(stamp), "[%u.%s%s%u] %s %s: ", rec.ms / 1000u,
+                         frac < 100 ? "0" : "", frac < 10 ? "0" : "", frac,
+                         level_names[rec.level & 3], subsys_names[rec.subsys % KLOG_NSUBSYS]);
+        console_out(stamp, (unsigned)n);
+        console_out(rec.text, rec.len);
+        if (rec.len == 0 || rec.text[rec.len - 1] != '\n') console_out("\n", 1);
+    }
+}
+
+int klog_enable(const char* name, int on) {
+    for (int i = 0; i < KLOG_NSUBSYS; ++i) {
+        if (strcmp(subsys_names[i], name)) continue;
+        if (on) enabled |= 1u << i; else enabled &= ~(1u << i);
+        return 0;
+    }
+    return -1;
+}
+
+void klog_set_console_level(int level) {
+    if (level < KLOG_ERR) level = KLOG_ERR;
+    if (level > KLOG_DEBUG) level = KLOG_DEBUG;
+    console_level = level;
+}
+
+void klog_get_stats(struct klog_stats* out) {
+    *out = stats;
+}
+
+void klog_print_config(void) {
+    printf("klog: console level %s, subsystems:", level_names[console_level]);
+    for (int i = 0; i < KLOG_NSUBSYS; ++i) {
+        printf(" %s%s", subsys_names[i], (enabled & (1u << i)) ? "" : "(off)");
+    }
+    printf("\n");
+    uint32_t hz = pit_hz();
+    printf("klog: %u records, %u dropped, %u written by klogd in %u ms (%u Mcycles)\n",
+           stats.records, stats.dropped, stats.deferred,
+           hz ? (stats.drain_ticks * 1000u) / hz : 0u,
+           (uint32_t)(stats.drain_cycles >> 20));
+}
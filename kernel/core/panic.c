@@ -1,8 +1,11 @@
 #include <kernel/panic.h>
 #include <kernel/stdio.h>
+#include <kernel/serial.h>
+#include <kernel/klog.h>
 #include <stdarg.h>
 
 noreturn void panic(const char* fmt, ...) {
+    klog_flush();
     printf("\n--- KERNEL PANIC ---\n");
     if (fmt) {
         va_list ap; va_start(ap, fmt);
@@ -10,6 +13,7 @@ noreturn void panic(const char* fmt, ...) {
         va_end(ap);
     }
     printf("\nSystem halted.\n");
+    serial_flush();
     for(;;) {
         __asm__ volatile("cli; hlt");
     }
@@ -9,6 +9,12 @@
 #include <kernel/kmalloc.h>
 #include <kernel/vmm.h>
 #include <kernel/htas.h>
+#include <kernel/pagecache.h>
+#include <kernel/elfcache.h>
+#include <kernel/systrace.h>
+#include <kernel/ipc.h>
+#include <kernel/klog.h>
+#include <kernel/ehci.h>
 #include <string.h>
 #include <stdint.h>
 
@@ -84,7 +90,7 @@ static int readline(char* buf, size_t cap) {
             }
         }
         
-        if (key < 0) { __asm__ volatile("hlt"); continue; }
+        if (key < 0) { klog_idle(); __asm__ volatile("hlt"); continue; }
 
     if (key == KEY_PAGE_UP) { terminal_scroll_view(scroll_step); continue; }
     if (key == KEY_PAGE_DOWN) { terminal_scroll_view(-scroll_step); continue; }
@@ -189,9 +195,21 @@ static void cmd_help(void) {
     printf("  userdemo     - run built-in ring3 demo\n");
     printf("  runmod       - load and run first multiboot module (ELF)\n");
     printf("  exec NAME    - run module by name (ELF)\n");
-    printf("  ls           - list files\n");
+    printf("  ls [PATH]    - list a directory\n");
     printf("  cat NAME     - dump a file\n");
+    printf("  pagecache    - show page cache statistics\n");
+    printf("  fsbench [N]  - file create/write/read/unlink benchmark (tmpfs vs ext2)\n");
+    printf("  execbench [PATH [N]] - exec time by binary size, or cold vs repeat exec of PATH\n");
+    printf("  elfcache     - show executable layout cache statistics\n");
+    printf("  strace PATH  - run PATH logging its syscalls, then show log and counts\n");
+    printf("  systrace [PID|log] - syscall counts and latency histograms, or the trace log\n");
+    printf("  serial [BAUD] - COM1 buffer/IRQ statistics, or set the baud rate\n");
+    printf("  ttybench [N] - VGA console cost per line (default 10000 lines)\n");
+    printf("  dmesg [LEVEL] - kernel log with timestamps (0 err .. 3 debug, default 3)\n");
+    printf("  klog [SUBSYS on|off | console LEVEL] - log settings and statistics\n");
+    printf("  ehci - USB 2.0 controller, ports and devices\n");
     printf("  ps           - list kernel threads\n");
+    printf("  ipc          - list IPC endpoints and their call counts\n");
     printf("  spawn        - create a demo thread\n");
     printf("  kdbg         - enter kernel debugger\n");
     printf("\n");
@@ -286,7 +304,7 @@ static void cmd_hexdump(const char* s1, const char* s2) {
 extern void userdemo_run(void);
 extern int  elf_run_first_module(void);
 extern int  elf_run_module_by_name(const char* name);
-extern void fs_list_print(void);
+extern void fs_list_print(const char* path);
 extern int  fs_open(const char* name);
 extern int  fs_read(int fd, void* buf, unsigned len);
 extern int  fs_close(int fd);
@@ -343,8 +361,9 @@ static void execute(char* line) {
         }
         return;
     }
-    if (!kstrcmp(line, "ls")) { fs_list_print(); return; }
+    if (!kstrcmp(line, "ls")) { fs_list_print(arg); return; }
     if (!kstrcmp(line, "ps")) { extern void sched_ps(void); sched_ps(); return; }
+    if (!kstrcmp(line, "ipc")) { ipc_dump(); return; }
     if (!kstrcmp(line, "spawn")) {
         extern int kthread_create(void (*fn)(void*), void*, const char*);
         void demo(void* _){ for(;;){ printf("[thr] tick\n"); for(volatile int i=0;i<1000000;i++); } }
@@ -405,6 +424,123 @@ static void execute(char* line) {
         return;
     }
     
+    if (!kstrcmp(line, "pagecache")) {
+        struct pagecache_stats st;
+        pagecache_get_stats(&st);
+        uint32_t lookups = st.hits + st.misses;
+        printf("pagecache: %u/%u pages (%u KiB) hits=%u misses=%u (%u%% hit) evictions=%u\n",
+               st.pages, st.capacity, st.pages * 4u, st.hits, st.misses,
+               lookups ? (st.hits * 100u) / lookups : 0u, st.evictions);
+        return;
+    }
+
+    if (!kstrcmp(line, "fsbench")) {
+        extern void fsbench_run(unsigned files);
+        uint32_t files = 0;
+        if (arg && *arg && !parse_u32(arg, &files)) { printf("usage: fsbench [N]\n"); return; }
+        fsbench_run(files);
+        return;
+    }
+
+    if (!kstrcmp(line, "execbench")) {
+        extern void execbench_run(void);
+        extern void execbench_repeat(const char* path, unsigned runs);
+        if (!arg || !*arg) { execbench_run(); return; }
+        char* a2 = arg; while (*a2 && *a2 != ' ') a2++;
+        uint32_t runs = 0;
+        if (*a2) { *a2++ = 0; while (*a2 == ' ') a2++; }
+        if (*a2 && !parse_u32(a2, &runs)) { printf("usage: execbench [PATH [N]]\n"); return; }
+        execbench_repeat(arg, runs);
+        return;
+    }
+
+    if (!kstrcmp(line, "elfcache")) {
+        struct elfcache_stats st;
+        elfcache_get_stats(&st);
+        uint32_t lookups = st.hits + st.misses;
+        printf("elfcache: %u/%u entries hits=%u misses=%u (%u%% hit) stale=%u\n",
+               st.entries, st.capacity, st.hits, st.misses,
+               lookups ? (st.hits * 100u) / lookups : 0u, st.stale);
+        return;
+    }
+
+    if (!kstrcmp(line, "strace")) {
+        if (!arg || !*arg) { printf("usage: strace PATH\n"); return; }
+        uint32_t from = systrace_cursor();
+        systrace_arm_exec(1);
+        int rc = elf_run_from_filesystem(arg);
+        systrace_arm_exec(0);
+        int pid = systrace_last_pid();
+        if (pid < 0) { printf("strace: exec failed: rc=%d\n", rc); return; }
+        systrace_print_log(pid, from);
+        systrace_print_stats(pid);
+        return;
+    }
+
+    if (!kstrcmp(line, "systrace")) {
+        uint32_t pid;
+        if (!arg || !*arg) systrace_print_stats(-1);
+        else if (!kstrcmp(arg, "log")) systrace_print_log(-1, 0);
+        else if (parse_u32(arg, &pid)) systrace_print_stats((int)pid);
+        else printf("usage: systrace [PID|log]\n");
+        return;
+    }
+
+    if (!kstrcmp(line, "serial")) {
+        uint32_t baud;
+        if (arg && *arg) {
+            if (!parse_u32(arg, &baud) || serial_set_baud(baud) != 0) {
+                printf("usage: serial [BAUD] (max %u)\n", SERIAL_UART_CLOCK / 16u);
+                return;
+            }
+        }
+        struct serial_stats st;
+        serial_get_stats(&st);
+        printf("serial: %u baud, %s, irqs=%u\n", st.baud, st.irq_mode ? "interrupt-driven" : "polled", st.irqs);
+        printf("  tx: %u bytes, %u queued, ring full %u times\n", st.tx_bytes, st.tx_queued, st.tx_full);
+        printf("  rx: %u bytes, %u dropped\n", st.rx_bytes, st.rx_dropped);
+        return;
+    }
+
+    if (!kstrcmp(line, "ttybench")) {
+        extern void ttybench_run(unsigned lines);
+        uint32_t lines = 0;
+        if (arg && *arg && !parse_u32(arg, &lines)) { printf("usage: ttybench [N]\n"); return; }
+        ttybench_run(lines);
+        return;
+    }
+
+    if (!kstrcmp(line, "dmesg")) {
+        uint32_t level = KLOG_DEBUG;
+        if (arg && *arg && (!parse_u32(arg, &level) || level > KLOG_DEBUG)) {
+            printf("usage: dmesg [0-3]\n");
+            return;
+        }
+        klog_dmesg((int)level);
+        return;
+    }
+
+    if (!kstrcmp(line, "ehci")) {
+        ehci_dump();
+        return;
+    }
+
+    if (!kstrcmp(line, "klog")) {
+        if (arg && *arg) {
+            char* val = arg; while (*val && *val != ' ') val++;
+            if (*val) { *val++ = 0; while (*val == ' ') val++; }
+            uint32_t level;
+            if (!kstrcmp(arg, "console") && parse_u32(val, &level) && level <= KLOG_DEBUG) {
+                klog_set_console_level((int)level);
+            } else if ((kstrcmp(val, "on") && kstrcmp(val, "off")) || klog_enable(arg, !kstrcmp(val, "on")) != 0) {
+                printf("usage: klog [SUBSYS on|off | console 0-3]\n");
+                return;
+            }
+        }
+        klog_print_config();
+        return;
+    }
+
     if (!kstrcmp(line, "cat")) {
         if (!arg || !*arg) { printf("usage: cat NAME\n"); return; }
         int fd = fs_open(arg);
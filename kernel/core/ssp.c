@@ -1,4 +1,5 @@
 #include <kernel/stdio.h>
+#include <kernel/serial.h>
 #include <stdint.h>
 
 /* Simple global canary; in a real system use a randomized value. */
@@ -6,5 +7,6 @@ uintptr_t __stack_chk_guard = 0x595e9fbdU;
 
 void __attribute__((noreturn)) __stack_chk_fail(void) {
     printf("\n[KERNEL] stack smashing detected. Halting.\n");
+    serial_flush();
     for(;;){ __asm__ volatile("cli; hlt"); }
 }
@@ -9,53 +9,68 @@
 
 /* This is a compiler-provided header for va_list */
 #include <stdarg.h> 
+#include <stddef.h>
 
-/**
- * @brief Helper function to print an integer in a given base.
- * @param n The number to print.
- * @param base The base (e.g., 10 for decimal, 16 for hex).
- * @return Returns the number of characters printed.
- */
-static int kernel_print_integer(long n, int base) {
-    const char* digits = "0123456789abcdef";
-    int count = 0;
-    
-    if (base == 10 && n < 0) {
-        terminal_putchar('-');
-        serial_putchar('-');
-        n = -n;
-        count++;
-    }
+/* Formatted output goes through a sink: either a caller's buffer
+   (vsnprintf) or a small staging buffer that is handed to the consoles a
+   run at a time (vprintf), so a printf costs a few terminal_write calls
+   instead of one terminal_putchar per character. */
+struct sink {
+    char*  buf;
+    size_t cap;
+    size_t len;         /* bytes stored in buf */
+    int    console;     /* flush buf to VGA and serial when full */
+    int    count;       /* characters produced in total */
+};
 
-    /* Recurse to print the most significant digits first */
-    /* We use unsigned long to avoid overflow issues with -n */
-    unsigned long un = (unsigned long)n;
-    if (un / base) {
-        count += kernel_print_integer(un / base, base);
+#define CONSOLE_STAGE 128
+
+static void sink_flush(struct sink* s) {
+    if (!s->console || s->len == 0) return;
+    for (size_t i = 0; i < s->len; i++) serial_putchar(s->buf[i]);
+    terminal_write(s->buf, s->len);
+    s->len = 0;
+}
+
+static void sink_put(struct sink* s, const char* p, size_t n) {
+    s->count += (int)n;
+    while (n) {
+        if (s->len + 1 >= s->cap) {
+            if (!s->console) return;    /* truncated; count keeps going */
+            sink_flush(s);
+        }
+        size_t room = s->cap - 1 - s->len;
+        size_t k = n < room ? n : room;
+        for (size_t i = 0; i < k; i++) s->buf[s->len + i] = p[i];
+        s->len += k;
+        p += k;
+        n -= k;
     }
-    
-    /* Print the least significant digit */
-    char ch = digits[un % base];
-    terminal_putchar(ch);
-    serial_putchar(ch);
-    count++;
-    
-    return count;
 }
 
 /**
- * @brief Core formatted print implementation.
+ * @brief Format an unsigned number in a given base (10 or 16).
  */
-int vprintf(const char* format, va_list args) {
-    int count = 0;
-    
+static void sink_number(struct sink* s, unsigned long un, int base, int negative) {
+    const char* digits = "0123456789abcdef";
+    char tmp[12];
+    int i = sizeof(tmp);
+    do {
+        tmp[--i] = digits[un % (unsigned)base];
+        un /= (unsigned)base;
+    } while (un);
+    if (negative) tmp[--i] = '-';
+    sink_put(s, &tmp[i], sizeof(tmp) - (size_t)i);
+}
+
+static void format(struct sink* s, const char* format, va_list args) {
     for (int i = 0; format[i] != '\0'; i++) {
-        /* Handle non-format characters */
+        /* Hand the whole literal run over in one go. */
         if (format[i] != '%') {
-            char ch = format[i];
-            terminal_putchar(ch);
-            serial_putchar(ch);
-            count++;
+            int j = i;
+            while (format[j] != '\0' && format[j] != '%') j++;
+            sink_put(s, &format[i], (size_t)(j - i));
+            i = j - 1;
             continue;
         }
         
@@ -65,50 +80,40 @@ int vprintf(const char* format, va_list args) {
         switch (format[i]) {
             case '\0':
                 /* Reached end of string mid-specifier. */
-                return count;
+                return;
             
             case '%':
                 /* Escaped percent sign */
-                terminal_putchar('%');
-                serial_putchar('%');
-                count++;
+                sink_put(s, "%", 1);
                 break;
             
             case 'c': {
                 /* 'char' is promoted to 'int' when passed via ... */
                 char c = (char)va_arg(args, int);
-                terminal_putchar(c);
-                serial_putchar(c);
-                count++;
+                sink_put(s, &c, 1);
                 break;
             }
                 
             case 's': {
-                const char* s = va_arg(args, const char*);
-                if (s == NULL) {
-                    s = "(null)";
+                const char* str = va_arg(args, const char*);
+                if (str == NULL) {
+                    str = "(null)";
                 }
-                /* Use your existing optimized function */
-                     terminal_writestring(s);
-                     serial_writestring(s);
-                
-                /* FIXME: We don't know how many chars were written
-                   unless terminal_writestring returns it.
-                   For now, we'll just not add to count.
-                   A proper fix is to have terminal_writestring
-                   return a 'size_t' or use strlen. */
+                size_t n = 0;
+                while (str[n]) n++;
+                sink_put(s, str, n);
                 break;
             }
 
             case 'd': {
                 int d = va_arg(args, int);
-                count += kernel_print_integer(d, 10);
+                unsigned long un = d < 0 ? 0ul - (unsigned long)d : (unsigned long)d;
+                sink_number(s, un, 10, d < 0);
                 break;
             }
             case 'u': {
                 unsigned int u = va_arg(args, unsigned int);
-                /* print as unsigned decimal */
-                count += kernel_print_integer((long)u, 10);
+                sink_number(s, u, 10, 0);
                 break;
             }
             
@@ -116,31 +121,55 @@ int vprintf(const char* format, va_list args) {
             case 'X': {
                 /* 'int' and 'unsigned int' are the same size */
                 unsigned int x = va_arg(args, unsigned int);
-                count += kernel_print_integer(x, 16);
+                sink_number(s, x, 16, 0);
                 break;
             }
             
             case 'p': {
                 /* A pointer. Print "0x" then the address in hex */
                 void* p = va_arg(args, void*);
-                terminal_writestring("0x");
-                serial_writestring("0x");
-                count += 2;
-                count += kernel_print_integer((unsigned long)p, 16);
+                sink_put(s, "0x", 2);
+                sink_number(s, (unsigned long)p, 16, 0);
                 break;
             }
 
             default:
                 /* Unrecognized specifier, just print it */
-                terminal_putchar('%');
-                terminal_putchar(format[i]);
-                serial_putchar('%');
-                serial_putchar(format[i]);
-                count += 2;
+                sink_put(s, "%", 1);
+                sink_put(s, &format[i], 1);
                 break;
         }
     }
-    
+}
+
+/**
+ * @brief Core formatted print implementation.
+ */
+int vprintf(const char* format_str, va_list args) {
+    char stage[CONSOLE_STAGE];
+    struct sink s = { stage, sizeof(stage), 0, 1, 0 };
+    format(&s, format_str, args);
+    sink_flush(&s);
+    return s.count;
+}
+
+/**
+ * @brief Format into buf (always NUL-terminated when size > 0).
+ * @return The length the full output would have had.
+ */
+int vsnprintf(char* buf, size_t size, const char* format_str, va_list args) {
+    char dummy;
+    struct sink s = { size ? buf : &dummy, size ? size : 1, 0, 0, 0 };
+    format(&s, format_str, args);
+    s.buf[s.len] = '\0';
+    return s.count;
+}
+
+int snprintf(char* buf, size_t size, const char* format_str, ...) {
+    va_list args;
+    va_start(args, format_str);
+    int count = vsnprintf(buf, size, format_str, args);
+    va_end(args);
     return count;
 }
 
@@ -160,4 +189,4 @@ int printf(const char* format, ...) {
     va_end(args);
     
     return count;
-}
\ No newline at end of file
+}
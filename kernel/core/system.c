@@ -1,11 +1,14 @@
 #include <kernel/system.h>
 #include <kernel/ports.h>
+#include <kernel/serial.h>
 
 void cpu_halt(void) {
+    serial_flush();
     __asm__ volatile ("cli; hlt");
 }
 
 void cpu_reboot(void) {
+    serial_flush();
     /* Try keyboard controller reset */
     /* Wait until input buffer is empty */
     while (inb(0x64) & 0x02) { }
@@ -0,0 +1,84 @@
+/* ttybench - VGA console output cost per line.
+ * Prints the same lines to the VGA console four ways: redrawing the whole
+ * screen after every line (what each newline used to cost), one
+ * terminal_putchar per character, one terminal_write per line, and
+ * terminal_write over 4 KiB batches, where lines that scroll away before
+ * the flush never reach VGA memory. Serial output is left out so the UART
+ * does not set the pace.
+ */
+
+#include <kernel/tty.h>
+#include <kernel/pit.h>
+#include <kernel/cpu.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+#define TTYBENCH_DEFAULT_LINES 10000u
+#define TTYBENCH_BATCH         4096u
+
+enum { MODE_REDRAW, MODE_PUTCHAR, MODE_LINE, MODE_BATCH, MODE_COUNT };
+
+static const char* mode_names[MODE_COUNT] = {
+    "full redraw ", "putchar     ", "write/line  ", "write/4KiB  "
+};
+
+static char g_batch[TTYBENCH_BATCH];
+
+/* "ttybench NNNNN the quick brown fox jumps over the lazy dog\n" */
+static unsigned make_line(char* out, unsigned i) {
+    static const char tail[] = " the quick brown fox jumps over the lazy dog\n";
+    unsigned n = 0;
+    memcpy(out, "ttybench ", 9);
+    n = 9;
+    for (unsigned d = 10000; d; d /= 10) out[n++] = (char)('0' + (i / d) % 10);
+    memcpy(out + n, tail, sizeof(tail) - 1);
+    return n + sizeof(tail) - 1;
+}
+
+static uint64_t run(int mode, unsigned lines) {
+    char line[80];
+    unsigned used = 0;
+    uint64_t t0 = rdtsc();
+    for (unsigned i = 0; i < lines; ++i) {
+        unsigned n = make_line(line, i);
+        switch (mode) {
+            case MODE_REDRAW:
+                terminal_write(line, n);
+                terminal_scroll_to_bottom();
+                break;
+            case MODE_PUTCHAR:
+                for (unsigned k = 0; k < n; ++k) terminal_putchar(line[k]);
+                break;
+            case MODE_LINE:
+                terminal_write(line, n);
+                break;
+            default:
+                if (used + n > TTYBENCH_BATCH) {
+                    terminal_write(g_batch, used);
+                    used = 0;
+                }
+                memcpy(g_batch + used, line, n);
+                used += n;
+                break;
+        }
+    }
+    if (used) terminal_write(g_batch, used);
+    return rdtsc() - t0;
+}
+
+void ttybench_run(unsigned lines) {
+    if (lines == 0) lines = TTYBENCH_DEFAULT_LINES;
+    uint64_t cycles[MODE_COUNT];
+    uint64_t ms[MODE_COUNT];
+    uint32_t hz = pit_hz();
+    for (int m = 0; m < MODE_COUNT; ++m) {
+        uint64_t t0 = pit_ticks();
+        cycles[m] = run(m, lines);
+        ms[m] = hz ? ((pit_ticks() - t0) * 1000u) / hz : 0u;
+    }
+    printf("ttybench: %u lines to VGA\n", lines);
+    for (int m = 0; m < MODE_COUNT; ++m) {
+        printf("  %s %u cycles/line, %u ms\n", mode_names[m],
+               (uint32_t)(cycles[m] / lines), (uint32_t)ms[m]);
+    }
+}
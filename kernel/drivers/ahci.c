@@ -1,6 +1,7 @@
 #include <kernel/ahci.h>
 #include <kernel/pci.h>
 #include <kernel/stdio.h>
+#include <kernel/klog.h>
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <string.h>
@@ -167,7 +168,7 @@ static void stop_cmd(hba_port_t* port) {
     for (int spin = 0; spin < 1000000; ++spin) {
         if (!(port->cmd & (HBA_PxCMD_FR | HBA_PxCMD_CR))) return;
     }
-    printf("ahci: timeout stopping command engine\n");
+    klog(KLOG_BLOCK, KLOG_ERR, "ahci: timeout stopping command engine\n");
 }
 
 static void start_cmd(hba_port_t* port) {
@@ -215,16 +216,16 @@ static int check_drive_type(hba_port_t* port) {
         uint32_t sig = port->sig;
         if (sig != 0 && sig != 0xFFFFFFFF) {
             /* Got a valid signature */
-            printf("ahci: device signature: 0x%x\n", sig);
+            klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: device signature: 0x%x\n", sig);
             if (sig == 0x00000101) {
-                printf("ahci: SATA disk detected\n");
+                klog(KLOG_BLOCK, KLOG_INFO, "ahci: SATA disk detected\n");
                 return 1;
             }
             if (sig == 0xEB140101) {
-                printf("ahci: SATAPI device detected\n");
+                klog(KLOG_BLOCK, KLOG_INFO, "ahci: SATAPI device detected\n");
                 return 1;
             }
-            printf("ahci: unknown device type (sig=0x%x)\n", sig);
+            klog(KLOG_BLOCK, KLOG_WARN, "ahci: unknown device type (sig=0x%x)\n", sig);
             return 0;
         }
     }
@@ -234,11 +235,11 @@ static int check_drive_type(hba_port_t* port) {
     uint8_t det = (uint8_t)(ssts & 0x0F);
     uint8_t ipm = (uint8_t)((ssts >> 8) & 0x0F);
     
-    printf("ahci: check_drive det=%u ipm=%u sig=0x%x (no valid sig)\n", det, ipm, port->sig);
+    klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: check_drive det=%u ipm=%u sig=0x%x (no valid sig)\n", det, ipm, port->sig);
     
     /* Accept if link is up as a fallback (QEMU workaround) */
     if (det == HBA_PORT_DEV_PRESENT && ipm == HBA_PORT_IPM_ACTIVE) {
-        printf("ahci: accepting device despite invalid signature (link is up)\n");
+        klog(KLOG_BLOCK, KLOG_WARN, "ahci: accepting device despite invalid signature (link is up)\n");
         return 1;
     }
     
@@ -343,7 +344,7 @@ static int issue_cmd(hba_port_t* port, uint32_t lba, uint8_t count, int write, v
     for (int spin = 0; spin < 1000000; ++spin) {
         if (!(port->tfd & (0x80 | 0x08))) break;
         if (spin == 999999) {
-            printf("ahci: port busy\n");
+            klog(KLOG_BLOCK, KLOG_ERR, "ahci: port busy\n");
             return -1;
         }
     }
@@ -355,13 +356,13 @@ static int issue_cmd(hba_port_t* port, uint32_t lba, uint8_t count, int write, v
     while (port->ci & (1u << slot)) {
         if (port->is & HBA_PxIS_TFES) {
             uint32_t serr = port->serr;
-            printf("ahci: task file error (tfd=0x%x serr=0x%x)\n", port->tfd, serr);
+            klog(KLOG_BLOCK, KLOG_ERR, "ahci: task file error (tfd=0x%x serr=0x%x)\n", port->tfd, serr);
             port->serr = serr;  /* Clear error bits by writing them back */
             /* DO NOT clear ci or sact - let hardware manage them */
             return -1;
         }
         if (++guard > 1000000) {
-            printf("ahci: command timeout\n");
+            klog(KLOG_BLOCK, KLOG_ERR, "ahci: command timeout\n");
             /* In a real driver, we would reset the port here */
             return -1;
         }
@@ -369,7 +370,7 @@ static int issue_cmd(hba_port_t* port, uint32_t lba, uint8_t count, int write, v
 
     if (port->is & HBA_PxIS_TFES) {
         uint32_t serr = port->serr;
-        printf("ahci: task file error (post tfd=0x%x serr=0x%x)\n", port->tfd, serr);
+        klog(KLOG_BLOCK, KLOG_ERR, "ahci: task file error (post tfd=0x%x serr=0x%x)\n", port->tfd, serr);
         port->serr = serr;
         return -1;
     }
@@ -393,7 +394,7 @@ int ahci_init(void) {
     uint32_t abar = pci_config_read32(dev.bus, dev.slot, dev.function, 0x24);
     if (!(abar & 0xFFFFFFF0u)) {
         /* BAR not assigned - this should be done by BIOS/firmware */
-        printf("ahci: BAR5 not assigned (BIOS/firmware issue)\n");
+        klog(KLOG_BLOCK, KLOG_ERR, "ahci: BAR5 not assigned (BIOS/firmware issue)\n");
         return -1;
     }
     abar &= 0xFFFFFFF0u;
@@ -409,13 +410,13 @@ int ahci_init(void) {
     /* Read initial values before reset */
     uint32_t cap_before = g_hba->cap;
     uint32_t pi_before = g_hba->pi;
-    printf("ahci: cap=0x%x pi=0x%x ghc=0x%x (before reset)\n", cap_before, pi_before, g_hba->ghc);
+    klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: cap=0x%x pi=0x%x ghc=0x%x (before reset)\n", cap_before, pi_before, g_hba->ghc);
     
     g_hba->ghc |= HBA_GHC_HR;
     for (int spin = 0; spin < 1000000; ++spin) {
         if (!(g_hba->ghc & HBA_GHC_HR)) break;
         if (spin == 999999) {
-            printf("ahci: HBA reset timeout\n");
+            klog(KLOG_BLOCK, KLOG_ERR, "ahci: HBA reset timeout\n");
             return -1;
         }
     }
@@ -423,42 +424,42 @@ int ahci_init(void) {
     /* Verify mapping still works after reset */
     uint32_t cap_after = g_hba->cap;
     uint32_t pi_after = g_hba->pi;
-    printf("ahci: cap=0x%x pi=0x%x (after reset)\n", cap_after, pi_after);
+    klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: cap=0x%x pi=0x%x (after reset)\n", cap_after, pi_after);
     
     if (cap_after == 0xFFFFFFFF || pi_after == 0xFFFFFFFF) {
-        printf("ahci: HBA registers unreadable after reset (mapping issue)\n");
+        klog(KLOG_BLOCK, KLOG_ERR, "ahci: HBA registers unreadable after reset (mapping issue)\n");
         return -1;
     }
 
     g_hba->is = 0xFFFFFFFFu;
     g_hba->ghc |= HBA_GHC_AE;
 
-    printf("ahci: abar=0x%x ports=0x%x\n", abar, g_hba->pi);
+    klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: abar=0x%x ports=0x%x\n", abar, g_hba->pi);
 
     uint32_t ports = g_hba->pi;
-    printf("ahci: scanning %u implemented ports\n", __builtin_popcount(ports));
+    klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: scanning %u implemented ports\n", __builtin_popcount(ports));
     for (uint8_t i = 0; i < AHCI_MAX_PORTS; ++i) {
         if (!(ports & (1u << i))) continue;
         volatile hba_port_t* port = &g_hba->ports[i];
-        printf("ahci: checking port %u at offset 0x%x\n", i, (uint32_t)((uintptr_t)port - (uintptr_t)g_hba));
+        klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: checking port %u at offset 0x%x\n", i, (uint32_t)((uintptr_t)port - (uintptr_t)g_hba));
         port_comreset((hba_port_t*)port);
-        printf("ahci: port %u ssts=0x%x sig=0x%x cmd=0x%x\n", i, port->ssts, port->sig, port->cmd);
+        klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: port %u ssts=0x%x sig=0x%x cmd=0x%x\n", i, port->ssts, port->sig, port->cmd);
         if (!check_drive_type((hba_port_t*)port)) {
-            printf("ahci: port %u: no device detected\n", i);
+            klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: port %u: no device detected\n", i);
             continue;
         }
         if (init_port_resources((hba_port_t*)port) != 0) {
-            printf("ahci: port %u: resource init failed\n", i);
+            klog(KLOG_BLOCK, KLOG_ERR, "ahci: port %u: resource init failed\n", i);
             continue;
         }
         g_active_port = (hba_port_t*)port;
         g_port_index = i;
-        printf("ahci: port %u: initialized successfully\n", i);
+        klog(KLOG_BLOCK, KLOG_DEBUG, "ahci: port %u: initialized successfully\n", i);
         break;
     }
 
     if (!g_active_port) {
-        printf("ahci: no usable port found\n");
+        klog(KLOG_BLOCK, KLOG_ERR, "ahci: no usable port found\n");
         return -1;
     }
 
@@ -466,7 +467,7 @@ int ahci_init(void) {
     if (!g_dma_buf_phys) return -1;
     g_dma_buf = (uint8_t*)phys_to_virt(g_dma_buf_phys);
 
-    printf("ahci: using controller %x:%x bus=%u slot=%u func=%u port=%u dma=0x%x\n",
+    klog(KLOG_BLOCK, KLOG_INFO, "ahci: using controller %x:%x bus=%u slot=%u func=%u port=%u dma=0x%x\n",
         dev.vendor_id, dev.device_id, dev.bus, dev.slot, dev.function, g_port_index, g_dma_buf_phys);
 
     g_ahci_ready = 1;
@@ -2,6 +2,7 @@
 #include <kernel/stdio.h>
 #include <kernel/ports.h>
 #include <kernel/serial.h>
+#include <kernel/waitq.h>
 
 #define KBD_BUF_SIZE 128
 static volatile uint16_t buf[KBD_BUF_SIZE];
@@ -12,6 +13,7 @@ static volatile int alt = 0;
 static volatile int e0 = 0;
 static volatile int scroll_override_up = 0;
 static volatile int scroll_override_down = 0;
+static struct wait_queue kbd_wq;
 
 static const char keymap[128] = {
     0,  27, '1','2','3','4','5','6','7','8','9','0','-','=', '\b',
@@ -83,7 +85,7 @@ void keyboard_on_scancode(uint8_t sc) {
             case 0x51: code = KEY_PAGE_DOWN; break;
             default: break;
         }
-        if (code && !buf_full()) { buf[head] = code; head = (uint8_t)(head+1); }
+        if (code && !buf_full()) { buf[head] = code; head = (uint8_t)(head+1); waitq_wake(&kbd_wq); }
         return;
     }
     
@@ -100,7 +102,7 @@ void keyboard_on_scancode(uint8_t sc) {
         ch = shift ? keymap_shift[sc] : keymap[sc];
     }
     if (!ch) return;
-    if (!buf_full()) { buf[head] = (uint16_t)(uint8_t)ch; head = (uint8_t)(head+1); }
+    if (!buf_full()) { buf[head] = (uint16_t)(uint8_t)ch; head = (uint8_t)(head+1); waitq_wake(&kbd_wq); }
 }
 
 int kbd_getch(void) {
@@ -108,3 +110,11 @@ int kbd_getch(void) {
     uint16_t v = buf[tail]; tail = (uint8_t)(tail+1);
     return (int)v;
 }
+
+int kbd_available(void) {
+    return !buf_empty();
+}
+
+struct wait_queue* kbd_waitq(void) {
+    return &kbd_wq;
+}
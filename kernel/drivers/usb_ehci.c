@@ -0,0 +1,807 @@
+#include <kernel/ehci.h>
+#include <kernel/pci.h>
+#include <kernel/irq.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/pit.h>
+#include <kernel/waitq.h>
+#include <kernel/stdio.h>
+#include <kernel/klog.h>
+#include <string.h>
+
+/* EHCI (USB 2.0) Host Controller Driver
+
+   Every endpoint gets a pipe: one low page holding its QH, the setup
+   packet and a pool of qTDs. Pipes stay linked in their schedule for the
+   life of the device; a transfer builds a qTD chain and hands it over by
+   writing the QH overlay's next pointer. A timed-out async transfer is
+   cancelled by unlinking its QH across an async-advance doorbell. qtd[0]
+   is a permanently inactive qTD that IN transfers divert to on a short
+   packet, which parks the queue. The periodic schedule uses the same
+   skeleton tree as the UHCI driver, one QH per interval of 1..128
+   frames. */
+
+#define EHCI_CLASS_CODE     0x0C
+#define EHCI_SUBCLASS       0x03
+#define EHCI_PROG_IF        0x20
+
+#define EHCI_VIRT_BASE      0xFEC10000u   /* after the AHCI window */
+#define EHCI_VIRT_PAGES     2
+
+/* Capability registers */
+#define EHCI_CAPLENGTH      0x00
+#define EHCI_HCSPARAMS      0x04
+#define EHCI_HCCPARAMS      0x08
+
+#define HCS_N_PORTS(x)      ((x) & 0xF)
+#define HCS_PPC             (1u << 4)     /* port power control */
+#define HCS_N_CC(x)         (((x) >> 12) & 0xF)
+#define HCC_EECP(x)         (((x) >> 8) & 0xFF)
+
+/* Operational registers */
+#define EHCI_USBCMD         0x00
+#define EHCI_USBSTS         0x04
+#define EHCI_USBINTR        0x08
+#define EHCI_FRINDEX        0x0C
+#define EHCI_CTRLDSSEGMENT  0x10
+#define EHCI_PERIODICBASE   0x14
+#define EHCI_ASYNCLISTADDR  0x18
+#define EHCI_CONFIGFLAG     0x40
+#define EHCI_PORTSC(n)      (0x44 + 4 * (n))
+
+#define CMD_RS              (1u << 0)
+#define CMD_HCRESET         (1u << 1)
+#define CMD_PSE             (1u << 4)     /* periodic schedule enable */
+#define CMD_ASE             (1u << 5)     /* async schedule enable */
+#define CMD_IAAD            (1u << 6)     /* interrupt on async advance doorbell */
+#define CMD_ITC_1MS         (8u << 16)    /* interrupt threshold: 8 microframes */
+
+#define STS_USBINT          (1u << 0)
+#define STS_ERR             (1u << 1)
+#define STS_PCD             (1u << 2)     /* port change detect */
+#define STS_FLR             (1u << 3)     /* frame list rollover */
+#define STS_HSE             (1u << 4)     /* host system error */
+#define STS_IAA             (1u << 5)
+#define STS_INTMASK         0x3Fu
+#define STS_HALTED          (1u << 12)
+
+#define PORT_CCS            (1u << 0)
+#define PORT_CSC            (1u << 1)
+#define PORT_PE             (1u << 2)
+#define PORT_PEC            (1u << 3)
+#define PORT_OCC            (1u << 5)
+#define PORT_PR             (1u << 8)
+#define PORT_LS_MASK        (3u << 10)
+#define PORT_LS_K           (1u << 10)    /* K-state: low-speed device */
+#define PORT_PP             (1u << 12)
+#define PORT_OWNER          (1u << 13)    /* port belongs to the companion */
+#define PORT_RWC            (PORT_CSC | PORT_PEC | PORT_OCC)
+
+/* Legacy support extended capability (PCI config space at EECP) */
+#define LEGSUP_CAP_ID       0x01
+#define LEGSUP_BIOS_OWNED   (1u << 16)
+#define LEGSUP_OS_OWNED     (1u << 24)
+
+/* Link pointers */
+#define LINK_TERM           1u
+#define LINK_QH             (1u << 1)
+#define LINK_ADDR_MASK      (~0x1Fu)
+
+/* qTD token */
+#define QTD_ACTIVE          (1u << 7)
+#define QTD_HALTED          (1u << 6)
+#define QTD_PID_OUT         (0u << 8)
+#define QTD_PID_IN          (1u << 8)
+#define QTD_PID_SETUP       (2u << 8)
+#define QTD_PID_MASK        (3u << 8)
+#define QTD_CERR3           (3u << 10)
+#define QTD_IOC             (1u << 15)
+#define QTD_LEN_SHIFT       16
+#define QTD_LEN_MASK        0x7FFFu
+#define QTD_TOGGLE          (1u << 31)
+#define QTD_MAX_PAGES       5
+
+/* QH endpoint characteristics / capabilities */
+#define QH_EP_SHIFT         8
+#define QH_EPS_HIGH         (2u << 12)
+#define QH_DTC              (1u << 14)    /* toggle from the qTD (control) */
+#define QH_HEAD             (1u << 15)    /* head of the reclamation list */
+#define QH_MAXP_SHIFT       16
+#define QH_MULT1            (1u << 30)
+
+#define EHCI_NUM_FRAMES     1024
+#define EHCI_SKEL_LEVELS    8             /* intervals 1..128 frames */
+#define EHCI_MAX_PIPES      (EHCI_MAX_DEVICES * 4)
+#define EHCI_PIPE_QTDS      62            /* qTDs in a pipe page, stop qTD included */
+#define EHCI_CTRL_MAX       16384u        /* control data stage: one qTD */
+#define EHCI_TIMEOUT_MS     5000u
+
+typedef struct ehci_qtd {
+    volatile uint32_t next;
+    volatile uint32_t alt_next;
+    volatile uint32_t token;
+    volatile uint32_t buf[QTD_MAX_PAGES];
+    volatile uint32_t buf_hi[QTD_MAX_PAGES];  /* 64-bit layout, kept zero */
+} __attribute__((aligned(32))) ehci_qtd_t;
+
+typedef struct ehci_qh {
+    volatile uint32_t horiz;
+    volatile uint32_t ep_char;
+    volatile uint32_t ep_caps;
+    volatile uint32_t cur_qtd;
+    /* Transfer overlay, laid out like a qTD */
+    volatile uint32_t next;
+    volatile uint32_t alt_next;
+    volatile uint32_t token;
+    volatile uint32_t buf[QTD_MAX_PAGES];
+    volatile uint32_t buf_hi[QTD_MAX_PAGES];
+} __attribute__((aligned(32))) ehci_qh_t;
+
+/* Pipe page layout: QH at 0, setup packet at 96, qTDs from 128 */
+#define PIPE_SETUP_OFF      96
+#define PIPE_QTD_OFF        128
+
+struct ehci_pipe {
+    ehci_qh_t* qh;
+    ehci_qtd_t* qtd;
+    uint8_t* setup;
+    struct ehci_device* dev;
+    uint8_t ep;                 /* endpoint address, direction included */
+    uint8_t control;
+    uint8_t recurring;          /* interrupt pipe: re-armed after each completion */
+    uint8_t busy;
+    uint16_t maxp;
+    uint16_t nqtd;              /* qtd[1..nqtd] make up the transfer in flight */
+    uint16_t qlen[EHCI_PIPE_QTDS];
+    volatile uint32_t done;
+    int result;
+    ehci_done_fn fn;
+    void* arg;
+};
+
+struct ehci_stats {
+    uint32_t irqs;
+    uint32_t transfers;
+    uint32_t bytes;
+    uint32_t errors;
+};
+
+static uint32_t g_op = 0;                 /* operational registers (virtual) */
+static uint32_t g_nports = 0;
+static uint32_t g_ncc = 0;                /* companion controllers */
+static uint32_t* g_frame_list = NULL;
+static ehci_qh_t* g_skel = NULL;          /* g_skel[k]: every 2^k frames */
+static ehci_qh_t* g_async = NULL;         /* reclamation head of the async ring */
+static struct ehci_pipe g_pipes[EHCI_MAX_PIPES];
+static struct ehci_device g_devices[EHCI_MAX_DEVICES];
+static uint8_t g_next_address = 1;
+static uint8_t g_irq_line = 0;
+static struct ehci_stats g_stats;
+static uint8_t g_desc[256];               /* descriptors read during enumeration */
+
+static inline uint32_t op_read(uint32_t reg) {
+    return *(volatile uint32_t*)(uintptr_t)(g_op + reg);
+}
+
+static inline void op_write(uint32_t reg, uint32_t val) {
+    *(volatile uint32_t*)(uintptr_t)(g_op + reg) = val;
+}
+
+/* Low frames are identity mapped, so the controller and the CPU can share
+   addresses for everything the schedule links to. */
+static void* alloc_low(void) {
+    uint32_t phys = pmm_alloc_frame_below(0x01000000u);
+    if (!phys) return NULL;
+    memset((void*)(uintptr_t)phys, 0, 4096);
+    return (void*)(uintptr_t)phys;
+}
+
+static inline uint32_t phys_of(const volatile void* p) {
+    return (uint32_t)(uintptr_t)p;
+}
+
+/* Microframes since the first call, from FRINDEX (125 us per step while
+   the controller runs). Works with interrupts off, unlike the PIT. Must be
+   read at least every 2 s to catch the 14-bit wrap. */
+static uint32_t uframe_clock(void) {
+    static uint32_t last, total;
+    uint32_t now = op_read(EHCI_FRINDEX) & 0x3FFF;
+    total += (now - last) & 0x3FFF;
+    last = now;
+    return total;
+}
+
+static void ehci_delay_ms(uint32_t ms) {
+    uint32_t start = uframe_clock();
+    while (uframe_clock() - start < ms * 8u) { }
+}
+
+static uint32_t map_mmio(uint32_t phys) {
+    uint32_t base = phys & ~0xFFFu;
+    for (uint32_t i = 0; i < EHCI_VIRT_PAGES; i++) {
+        if (vmm_map(EHCI_VIRT_BASE + i * 0x1000u, base + i * 0x1000u, PAGE_WRITE) != 0) {
+            return 0;
+        }
+    }
+    return EHCI_VIRT_BASE + (phys & 0xFFFu);
+}
+
+/* Ask the BIOS to give up the controller (legacy keyboard emulation). */
+static void bios_handoff(struct pci_device* dev, uint32_t hccparams) {
+    uint8_t eecp = (uint8_t)HCC_EECP(hccparams);
+    while (eecp >= 0x40) {
+        uint32_t cap = pci_config_read32(dev->bus, dev->slot, dev->function, eecp);
+        if ((cap & 0xFF) == LEGSUP_CAP_ID) {
+            if (cap & LEGSUP_BIOS_OWNED) {
+                pci_config_write32(dev->bus, dev->slot, dev->function, eecp, cap | LEGSUP_OS_OWNED);
+                for (int i = 0; i < 1000; i++) {
+                    cap = pci_config_read32(dev->bus, dev->slot, dev->function, eecp);
+                    if (!(cap & LEGSUP_BIOS_OWNED)) break;
+                    for (volatile int j = 0; j < 1000; j++) { }
+                }
+                if (cap & LEGSUP_BIOS_OWNED) {
+                    klog(KLOG_USB, KLOG_WARN, "ehci: BIOS did not release the controller\n");
+                }
+            }
+            /* No more SMIs from USB events */
+            pci_config_write32(dev->bus, dev->slot, dev->function, eecp + 4, 0);
+            return;
+        }
+        eecp = (uint8_t)((cap >> 8) & 0xFF);
+    }
+}
+
+static int ehci_reset(void) {
+    op_write(EHCI_USBCMD, op_read(EHCI_USBCMD) & ~CMD_RS);
+    for (int i = 0; i < 1000 && !(op_read(EHCI_USBSTS) & STS_HALTED); i++) {
+        for (volatile int j = 0; j < 1000; j++) { }
+    }
+    op_write(EHCI_USBCMD, CMD_HCRESET);
+    for (int i = 0; i < 1000 && (op_read(EHCI_USBCMD) & CMD_HCRESET); i++) {
+        for (volatile int j = 0; j < 1000; j++) { }
+    }
+    if (op_read(EHCI_USBCMD) & CMD_HCRESET) {
+        klog(KLOG_USB, KLOG_ERR, "ehci: reset timeout\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* A QH the controller visits but never executes. A periodic QH needs a
+   non-zero S-mask, an async one a zero S-mask. */
+static void qh_idle(ehci_qh_t* qh, uint32_t horiz, uint32_t flags, uint32_t smask) {
+    qh->horiz = horiz;
+    qh->ep_char = QH_EPS_HIGH | (64u << QH_MAXP_SHIFT) | flags;
+    qh->ep_caps = QH_MULT1 | smask;
+    qh->next = LINK_TERM;
+    qh->alt_next = LINK_TERM;
+    qh->token = QTD_HALTED;
+}
+
+static int ehci_setup_schedules(void) {
+    g_frame_list = (uint32_t*)alloc_low();
+    uint8_t* page = (uint8_t*)alloc_low();
+    if (!g_frame_list || !page) {
+        klog(KLOG_USB, KLOG_ERR, "ehci: failed to allocate schedules\n");
+        return -1;
+    }
+
+    /* Skeleton QHs: k links on to k-1, interval 1 ends the frame */
+    g_skel = (ehci_qh_t*)page;
+    for (int k = 0; k < EHCI_SKEL_LEVELS; k++) {
+        qh_idle(&g_skel[k], k ? (phys_of(&g_skel[k - 1]) | LINK_QH) : LINK_TERM, 0, 0x01);
+    }
+    for (int i = 0; i < EHCI_NUM_FRAMES; i++) {
+        int k = i ? __builtin_ctz((unsigned)i) : EHCI_SKEL_LEVELS - 1;
+        if (k > EHCI_SKEL_LEVELS - 1) k = EHCI_SKEL_LEVELS - 1;
+        g_frame_list[i] = phys_of(&g_skel[k]) | LINK_QH;
+    }
+
+    /* Async ring: the head points at itself until pipes join */
+    g_async = &g_skel[EHCI_SKEL_LEVELS];
+    qh_idle(g_async, phys_of(g_async) | LINK_QH, QH_HEAD, 0);
+
+    op_write(EHCI_CTRLDSSEGMENT, 0);
+    op_write(EHCI_PERIODICBASE, phys_of(g_frame_list));
+    op_write(EHCI_ASYNCLISTADDR, phys_of(g_async));
+    return 0;
+}
+
+static struct ehci_pipe* pipe_new(struct ehci_device* dev, uint8_t ep, uint16_t maxp, int control) {
+    struct ehci_pipe* p = NULL;
+    for (int i = 0; i < EHCI_MAX_PIPES; i++) {
+        if (!g_pipes[i].qh) { p = &g_pipes[i]; break; }
+    }
+    uint8_t* page = p ? (uint8_t*)alloc_low() : NULL;
+    if (!page) {
+        klog(KLOG_USB, KLOG_ERR, "ehci: out of pipes\n");
+        return NULL;
+    }
+    p->qh = (ehci_qh_t*)page;
+    p->setup = page + PIPE_SETUP_OFF;
+    p->qtd = (ehci_qtd_t*)(page + PIPE_QTD_OFF);
+    p->dev = dev;
+    p->ep = ep;
+    p->maxp = maxp;
+    p->control = (uint8_t)control;
+
+    p->qtd[0].next = LINK_TERM;     /* stop qTD: never active */
+    p->qtd[0].alt_next = LINK_TERM;
+    p->qh->ep_char = dev->address | ((uint32_t)(ep & 0xF) << QH_EP_SHIFT) | QH_EPS_HIGH |
+                     (control ? QH_DTC : 0) | ((uint32_t)maxp << QH_MAXP_SHIFT);
+    p->qh->ep_caps = QH_MULT1;
+    p->qh->next = LINK_TERM;
+    p->qh->alt_next = LINK_TERM;
+    return p;
+}
+
+/* Link p in after head (async head or a periodic skeleton QH); fill the
+   QH first so the controller never sees half of it. */
+static void pipe_link(struct ehci_pipe* p, ehci_qh_t* head) {
+    p->qh->horiz = head->horiz;
+    __sync_synchronize();
+    head->horiz = phys_of(p->qh) | LINK_QH;
+}
+
+/* Take p out of the async ring. Once the doorbell is answered the
+   controller holds no cached copy of the QH, so its overlay may be
+   rewritten. Returns 0 if p was not in the ring. */
+static int pipe_unlink_async(struct ehci_pipe* p) {
+    ehci_qh_t* q = g_async;
+    for (int i = 0; i <= EHCI_MAX_PIPES; i++) {
+        ehci_qh_t* next = (ehci_qh_t*)(uintptr_t)(q->horiz & LINK_ADDR_MASK);
+        if (next == p->qh) {
+            q->horiz = p->qh->horiz;
+            break;
+        }
+        if (next == g_async) return 0;
+        q = next;
+    }
+    if (op_read(EHCI_USBSTS) & STS_HALTED) return 1;
+    __sync_synchronize();
+    op_write(EHCI_USBCMD, op_read(EHCI_USBCMD) | CMD_IAAD);
+    /* The controller drops the doorbell bit as it raises IAA; the IRQ
+       handler may clear IAA first, so watch the doorbell */
+    uint32_t start = uframe_clock();
+    while ((op_read(EHCI_USBCMD) & CMD_IAAD) && uframe_clock() - start < 8u * 8u) { }
+    if (op_read(EHCI_USBCMD) & CMD_IAAD) {
+        klog(KLOG_USB, KLOG_WARN, "ehci: async advance doorbell not answered\n");
+    }
+    op_write(EHCI_USBSTS, STS_IAA);
+    return 1;
+}
+
+/* Unlink (async pipes) and give back the pipe's page. */
+static void pipe_free(struct ehci_pipe* p) {
+    if (!p || !p->qh) return;
+    pipe_unlink_async(p);
+    pmm_free_frame(phys_of(p->qh));
+    memset(p, 0, sizeof(*p));
+}
+
+static void qtd_init(ehci_qtd_t* q, uint32_t pid, uint32_t len, uint32_t toggle) {
+    q->next = LINK_TERM;
+    q->alt_next = LINK_TERM;
+    q->token = QTD_ACTIVE | pid | QTD_CERR3 | (len << QTD_LEN_SHIFT) | (toggle ? QTD_TOGGLE : 0);
+}
+
+/* Point q at up to five pages of buf. Returns the bytes covered, cut to
+   whole packets unless it reaches the end, or 0 if a page is unmapped. */
+static uint32_t qtd_fill(ehci_qtd_t* q, uint8_t* buf, uint32_t left, uint16_t maxp) {
+    uint32_t done = 0;
+    for (int i = 0; i < QTD_MAX_PAGES && done < left; i++) {
+        uint32_t va = (uint32_t)(uintptr_t)buf + done;
+        uint32_t pa = vmm_resolve(va);
+        if (!pa) return 0;
+        q->buf[i] = pa;
+        uint32_t chunk = 0x1000u - (va & 0xFFFu);
+        if (chunk > left - done) chunk = left - done;
+        done += chunk;
+    }
+    if (done < left) done -= done % maxp;
+    return done;
+}
+
+/* Hand qtd[1..nqtd] to the controller. */
+static void pipe_go(struct ehci_pipe* p) {
+    for (uint32_t i = 1; i < p->nqtd; i++) {
+        p->qtd[i].next = phys_of(&p->qtd[i + 1]);
+    }
+    p->qtd[p->nqtd].token |= QTD_IOC;
+    p->done = 0;
+    p->busy = 1;
+    /* Idle overlay: clear a halt from an earlier transfer, keep the toggle */
+    p->qh->token &= QTD_TOGGLE;
+    __sync_synchronize();
+    p->qh->next = phys_of(&p->qtd[1]);
+}
+
+/* 1 once the transfer in flight has ended; p->result gets the bytes
+   moved or -1. */
+static int pipe_finished(struct ehci_pipe* p) {
+    int moved = 0;
+    for (uint32_t i = 1; i <= p->nqtd; i++) {
+        uint32_t tok = p->qtd[i].token;
+        if (tok & QTD_ACTIVE) return 0;
+        if (tok & QTD_HALTED) {
+            klog(KLOG_USB, KLOG_DEBUG, "ehci: ep 0x%x halted (token 0x%x)\n", p->ep, tok);
+            p->result = -1;
+            return 1;
+        }
+        uint32_t left = (tok >> QTD_LEN_SHIFT) & QTD_LEN_MASK;
+        if ((tok & QTD_PID_MASK) != QTD_PID_SETUP) moved += p->qlen[i] - left;
+        /* Short IN packet: the queue parked on the stop qTD. A control
+           transfer diverts to its status stage instead. */
+        if (left && (tok & QTD_PID_MASK) == QTD_PID_IN && !p->control) break;
+    }
+    p->result = moved;
+    return 1;
+}
+
+static void interrupt_rearm(struct ehci_pipe* p) {
+    ehci_qtd_t* q = &p->qtd[1];
+    q->next = LINK_TERM;
+    q->alt_next = phys_of(&p->qtd[0]);
+    q->token = QTD_ACTIVE | QTD_PID_IN | QTD_CERR3 | ((uint32_t)p->qlen[1] << QTD_LEN_SHIFT);
+    pipe_go(p);
+}
+
+/* Retire finished transfers; interrupt handler, or a caller polling with
+   interrupts off. */
+static void ehci_reap(void) {
+    for (int i = 0; i < EHCI_MAX_PIPES; i++) {
+        struct ehci_pipe* p = &g_pipes[i];
+        if (!p->busy || !pipe_finished(p)) continue;
+        p->busy = 0;
+        g_stats.transfers++;
+        if (p->result < 0) g_stats.errors++; else g_stats.bytes += (uint32_t)p->result;
+        if (p->recurring) {
+            if (p->fn) p->fn(p->dev, p->result, p->arg);
+            if (p->result >= 0) interrupt_rearm(p);
+        } else {
+            p->done = 1;
+        }
+    }
+}
+
+static int ehci_irq(void) {
+    uint32_t status = op_read(EHCI_USBSTS) & STS_INTMASK;
+    if (!status) return 0;  /* someone else on a shared line */
+    op_write(EHCI_USBSTS, status);  /* write-1-to-clear */
+    g_stats.irqs++;
+    if (status & STS_HSE) {
+        klog(KLOG_USB, KLOG_ERR, "ehci: host system error, controller halted\n");
+    }
+    if (status & STS_PCD) {
+        klog(KLOG_USB, KLOG_DEBUG, "ehci: port status change (hotplug is not handled)\n");
+    }
+    if (status & (STS_USBINT | STS_ERR)) ehci_reap();
+    return 1;
+}
+
+static int pipe_wait(struct ehci_pipe* p) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0" : "=r"(flags));
+    if (flags & 0x200) {
+        waitq_sleep(&p->done, pit_ticks() + EHCI_TIMEOUT_MS * pit_hz() / 1000u);
+    } else {
+        /* Boot or syscall context: nobody takes the interrupt, look ourselves */
+        uint32_t start = uframe_clock();
+        while (!p->done && uframe_clock() - start < EHCI_TIMEOUT_MS * 8u) ehci_reap();
+    }
+    if (!p->done) {
+        /* The overlay may hold a qTD already fetched, which clearing its
+           token would not stop: unlink the QH, wait for the controller to
+           let go of it, then reset the overlay and put it back */
+        pipe_unlink_async(p);
+        for (uint32_t i = 1; i <= p->nqtd; i++) p->qtd[i].token &= ~QTD_ACTIVE;
+        p->qh->cur_qtd = 0;
+        p->qh->next = LINK_TERM;
+        p->qh->alt_next = LINK_TERM;
+        p->qh->token &= QTD_TOGGLE;
+        pipe_link(p, g_async);
+        p->busy = 0;
+        g_stats.errors++;
+        klog(KLOG_USB, KLOG_ERR, "ehci: transfer timeout on device %u ep 0x%x\n", p->dev->address, p->ep);
+        return -1;
+    }
+    return p->result;
+}
+
+int ehci_control(struct ehci_device* dev, const usb_device_request_t* req, void* data) {
+    struct ehci_pipe* p = dev ? dev->ctrl : NULL;
+    if (!p || p->busy || req->length > EHCI_CTRL_MAX || (req->length && !data)) return -1;
+    int in = (req->request_type & USB_EP_DIR_IN) != 0;
+
+    memcpy(p->setup, req, sizeof(*req));
+    uint32_t n = 1;
+    qtd_init(&p->qtd[n], QTD_PID_SETUP, sizeof(*req), 0);
+    p->qtd[n].buf[0] = phys_of(p->setup);
+    p->qlen[n] = sizeof(*req);
+
+    if (req->length) {
+        n++;
+        ehci_qtd_t* q = &p->qtd[n];
+        qtd_init(q, in ? QTD_PID_IN : QTD_PID_OUT, req->length, 1);
+        if (qtd_fill(q, (uint8_t*)data, req->length, p->maxp) != req->length) return -1;
+        q->alt_next = phys_of(&p->qtd[n + 1]);   /* short read: on to status */
+        p->qlen[n] = req->length;
+    }
+
+    /* Status stage: opposite direction, DATA1 */
+    n++;
+    qtd_init(&p->qtd[n], (in && req->length) ? QTD_PID_OUT : QTD_PID_IN, 0, 1);
+    p->qlen[n] = 0;
+    p->nqtd = (uint16_t)n;
+    pipe_go(p);
+    return pipe_wait(p);
+}
+
+int ehci_bulk(struct ehci_device* dev, uint8_t ep, void* buf, uint32_t len) {
+    if (!dev) return -1;
+    struct ehci_pipe* p = (ep & USB_EP_DIR_IN) ? dev->bulk_in : dev->bulk_out;
+    if (!p || p->ep != ep || p->busy || !len) return -1;
+    int in = (ep & USB_EP_DIR_IN) != 0;
+
+    uint32_t n = 0, done = 0;
+    while (done < len) {
+        if (++n >= EHCI_PIPE_QTDS) return -1;       /* larger than one chain */
+        ehci_qtd_t* q = &p->qtd[n];
+        uint32_t covered = qtd_fill(q, (uint8_t*)buf + done, len - done, p->maxp);
+        if (!covered) return -1;
+        /* The QH keeps the toggle for bulk, the qTD bit is ignored */
+        qtd_init(q, in ? QTD_PID_IN : QTD_PID_OUT, covered, 0);
+        if (in) q->alt_next = phys_of(&p->qtd[0]);
+        p->qlen[n] = (uint16_t)covered;
+        done += covered;
+    }
+    p->nqtd = (uint16_t)n;
+    pipe_go(p);
+    return pipe_wait(p);
+}
+
+int ehci_interrupt_start(struct ehci_device* dev, void* buf, uint16_t len, ehci_done_fn fn, void* arg) {
+    struct ehci_pipe* p = dev ? dev->intr_in : NULL;
+    if (!p || p->recurring || !len || len > EHCI_CTRL_MAX) return -1;
+    if (qtd_fill(&p->qtd[1], (uint8_t*)buf, len, p->maxp) != len) return -1;
+
+    /* High-speed bInterval b polls every 2^(b-1) microframes: below one
+       frame that is an S-mask within every frame, above it a skeleton */
+    uint32_t uframes = 1u << (dev->intr_interval ? dev->intr_interval - 1 : 0);
+    uint32_t level = 0, smask = 0x01;
+    if (uframes < 8) {
+        smask = uframes == 1 ? 0xFF : uframes == 2 ? 0x55 : 0x11;
+    } else {
+        while (level < EHCI_SKEL_LEVELS - 1 && (16u << level) <= uframes) level++;
+    }
+    p->qh->ep_caps = QH_MULT1 | smask;
+    p->qlen[1] = len;
+    p->nqtd = 1;
+    p->fn = fn;
+    p->arg = arg;
+    p->recurring = 1;
+    pipe_link(p, &g_skel[level]);
+    interrupt_rearm(p);
+    klog(KLOG_USB, KLOG_DEBUG, "ehci: device %u interrupt ep 0x%x every %u microframes\n",
+         dev->address, p->ep, uframes);
+    return 0;
+}
+
+static int ctrl_request(struct ehci_device* dev, uint8_t type, uint8_t request,
+                        uint16_t value, uint16_t length, void* data) {
+    usb_device_request_t req = {
+        .request_type = type, .request = request, .value = value, .index = 0, .length = length,
+    };
+    return ehci_control(dev, &req, data);
+}
+
+static int get_descriptor(struct ehci_device* dev, uint8_t type, uint16_t length) {
+    return ctrl_request(dev, USB_EP_DIR_IN, USB_REQ_GET_DESCRIPTOR, (uint16_t)(type << 8), length, g_desc);
+}
+
+/* Pick the first interface's bulk and interrupt endpoints. */
+static int parse_config(struct ehci_device* dev, int total) {
+    int in_first = 0;
+    for (int off = 0; off + 2 <= total && g_desc[off] >= 2; off += g_desc[off]) {
+        if (g_desc[off + 1] == USB_DESC_INTERFACE) {
+            const usb_interface_descriptor_t* d = (const usb_interface_descriptor_t*)&g_desc[off];
+            if (in_first) break;        /* only the first interface */
+            if (d->alternate_setting) continue;
+            in_first = 1;
+            dev->iface_class = d->interface_class;
+            dev->iface_subclass = d->interface_subclass;
+            dev->iface_protocol = d->interface_protocol;
+        } else if (g_desc[off + 1] == USB_DESC_ENDPOINT && in_first) {
+            const usb_endpoint_descriptor_t* e = (const usb_endpoint_descriptor_t*)&g_desc[off];
+            uint8_t type = e->attributes & USB_EP_XFER_MASK;
+            uint16_t maxp = e->max_packet_size & 0x7FF;
+            int in = (e->endpoint_address & USB_EP_DIR_IN) != 0;
+            struct ehci_pipe** slot = NULL;
+            if (type == USB_EP_XFER_BULK) slot = in ? &dev->bulk_in : &dev->bulk_out;
+            else if (type == USB_EP_XFER_INT && in) slot = &dev->intr_in;
+            if (!slot || *slot) continue;
+            *slot = pipe_new(dev, e->endpoint_address, maxp, 0);
+            if (!*slot) return -1;
+            if (type == USB_EP_XFER_BULK) pipe_link(*slot, g_async);
+            else dev->intr_interval = e->interval;
+        }
+    }
+    return in_first ? 0 : -1;
+}
+
+static void ehci_enumerate(uint32_t port) {
+    struct ehci_device* dev = NULL;
+    for (int i = 0; i < EHCI_MAX_DEVICES; i++) {
+        if (!g_devices[i].active) { dev = &g_devices[i]; break; }
+    }
+    if (!dev) {
+        klog(KLOG_USB, KLOG_WARN, "ehci: no free device slots\n");
+        return;
+    }
+    memset(dev, 0, sizeof(*dev));
+    dev->port = (uint8_t)port;
+
+    /* High-speed endpoint 0 always takes 64-byte packets */
+    dev->ctrl = pipe_new(dev, 0, 64, 1);
+    if (!dev->ctrl) return;
+    pipe_link(dev->ctrl, g_async);
+
+    if (get_descriptor(dev, USB_DESC_DEVICE, 8) < 8) goto fail;
+    uint8_t address = g_next_address++;
+    if (ctrl_request(dev, 0, USB_REQ_SET_ADDRESS, address, 0, NULL) < 0) goto fail;
+    dev->address = address;
+    dev->ctrl->qh->ep_char |= address;
+    ehci_delay_ms(2);
+
+    if (get_descriptor(dev, USB_DESC_DEVICE, sizeof(dev->desc)) < (int)sizeof(dev->desc)) goto fail;
+    memcpy(&dev->desc, g_desc, sizeof(dev->desc));
+
+    if (get_descriptor(dev, USB_DESC_CONFIGURATION, sizeof(usb_config_descriptor_t)) <
+        (int)sizeof(usb_config_descriptor_t)) goto fail;
+    const usb_config_descriptor_t* cfg = (const usb_config_descriptor_t*)g_desc;
+    uint16_t total = cfg->total_length < sizeof(g_desc) ? cfg->total_length : sizeof(g_desc);
+    uint8_t value = cfg->configuration_value;
+    int got = get_descriptor(dev, USB_DESC_CONFIGURATION, total);
+    if (got < (int)sizeof(usb_config_descriptor_t) || parse_config(dev, got) != 0) goto fail;
+    if (ctrl_request(dev, 0, USB_REQ_SET_CONFIGURATION, value, 0, NULL) < 0) goto fail;
+
+    dev->active = 1;
+    klog(KLOG_USB, KLOG_INFO, "ehci: port %u: device %u id %x:%x class %x/%x/%x\n",
+         port, dev->address, dev->desc.vendor_id, dev->desc.product_id,
+         dev->iface_class, dev->iface_subclass, dev->iface_protocol);
+    return;
+
+fail:
+    /* Unlink and free the pipes; the slot is free again */
+    pipe_free(dev->ctrl);
+    pipe_free(dev->bulk_in);
+    pipe_free(dev->bulk_out);
+    pipe_free(dev->intr_in);
+    dev->ctrl = dev->bulk_in = dev->bulk_out = dev->intr_in = NULL;
+    klog(KLOG_USB, KLOG_ERR, "ehci: port %u: enumeration failed\n", port);
+}
+
+/* Give a low- or full-speed device to the companion UHCI. */
+static void release_port(uint32_t port, const char* speed) {
+    if (!g_ncc) {
+        klog(KLOG_USB, KLOG_WARN, "ehci: port %u: %s device and no companion controller\n", port, speed);
+        return;
+    }
+    uint32_t sc = op_read(EHCI_PORTSC(port)) & ~PORT_RWC;
+    op_write(EHCI_PORTSC(port), sc | PORT_OWNER);
+    klog(KLOG_USB, KLOG_INFO, "ehci: port %u: %s device, handed to companion\n", port, speed);
+}
+
+static void ehci_scan_ports(void) {
+    for (uint32_t port = 0; port < g_nports; port++) {
+        uint32_t sc = op_read(EHCI_PORTSC(port));
+        if (!(sc & PORT_CCS)) continue;
+        if ((sc & PORT_LS_MASK) == PORT_LS_K) {
+            release_port(port, "low-speed");
+            continue;
+        }
+
+        /* Reset; a high-speed device comes out of it enabled */
+        op_write(EHCI_PORTSC(port), (sc & ~(PORT_RWC | PORT_PE)) | PORT_PR);
+        ehci_delay_ms(50);
+        op_write(EHCI_PORTSC(port), op_read(EHCI_PORTSC(port)) & ~(PORT_RWC | PORT_PR));
+        for (int i = 0; i < 20 && (op_read(EHCI_PORTSC(port)) & PORT_PR); i++) ehci_delay_ms(1);
+        sc = op_read(EHCI_PORTSC(port));
+        if (!(sc & PORT_PE)) {
+            release_port(port, "full-speed");
+            continue;
+        }
+        ehci_delay_ms(10);  /* reset recovery */
+        ehci_enumerate(port);
+    }
+}
+
+struct ehci_device* ehci_device(int n) {
+    if (n < 0 || n >= EHCI_MAX_DEVICES || !g_devices[n].active) return NULL;
+    return &g_devices[n];
+}
+
+int ehci_init(void) {
+    struct pci_device dev;
+    if (pci_find_class(EHCI_CLASS_CODE, EHCI_SUBCLASS, EHCI_PROG_IF, &dev) != 0) {
+        return -1;
+    }
+    klog(KLOG_USB, KLOG_INFO, "ehci: found controller 0x%x:0x%x at bus=%u slot=%u func=%u\n",
+         dev.vendor_id, dev.device_id, dev.bus, dev.slot, dev.function);
+
+    uint32_t bar0 = pci_config_read32(dev.bus, dev.slot, dev.function, 0x10);
+    if ((bar0 & 1) || !(bar0 & 0xFFFFFF00u)) {
+        klog(KLOG_USB, KLOG_ERR, "ehci: BAR0 is not an assigned memory BAR\n");
+        return -1;
+    }
+    uint32_t cmd = pci_config_read16(dev.bus, dev.slot, dev.function, 0x04);
+    cmd |= (1 << 1) | (1 << 2);  /* Memory Space | Bus Master */
+    pci_config_write16(dev.bus, dev.slot, dev.function, 0x04, (uint16_t)cmd);
+
+    uint32_t cap = map_mmio(bar0 & 0xFFFFFF00u);
+    if (!cap) return -1;
+    uint32_t hcsparams = *(volatile uint32_t*)(uintptr_t)(cap + EHCI_HCSPARAMS);
+    uint32_t hccparams = *(volatile uint32_t*)(uintptr_t)(cap + EHCI_HCCPARAMS);
+    g_op = cap + *(volatile uint8_t*)(uintptr_t)(cap + EHCI_CAPLENGTH);
+    g_nports = HCS_N_PORTS(hcsparams);
+    g_ncc = HCS_N_CC(hcsparams);
+
+    bios_handoff(&dev, hccparams);
+    if (ehci_reset() != 0 || ehci_setup_schedules() != 0) {
+        return -1;
+    }
+
+    op_write(EHCI_USBSTS, STS_INTMASK);
+    op_write(EHCI_USBINTR, STS_USBINT | STS_ERR | STS_PCD | STS_HSE);
+    op_write(EHCI_USBCMD, CMD_RS | CMD_ASE | CMD_PSE | CMD_ITC_1MS);
+    /* Route every port to us; low/full-speed ones are released per port */
+    op_write(EHCI_CONFIGFLAG, 1);
+    if (hcsparams & HCS_PPC) {
+        for (uint32_t port = 0; port < g_nports; port++) {
+            op_write(EHCI_PORTSC(port), (op_read(EHCI_PORTSC(port)) & ~PORT_RWC) | PORT_PP);
+        }
+    }
+    ehci_delay_ms(100);  /* power good and connect detection */
+    klog(KLOG_USB, KLOG_DEBUG, "ehci: %u ports, %u companion controllers\n", g_nports, g_ncc);
+
+    ehci_scan_ports();
+
+    /* Interrupt line as assigned by the BIOS; without one, the timer
+       carries the handler */
+    g_irq_line = pci_config_read8(dev.bus, dev.slot, dev.function, 0x3C);
+    if (g_irq_line == 0 || g_irq_line >= IRQ_LINES) {
+        klog(KLOG_USB, KLOG_WARN, "ehci: no interrupt line routed, servicing from the timer\n");
+        g_irq_line = 0;
+    }
+    if (irq_register(g_irq_line, ehci_irq) != 0) {
+        return -1;
+    }
+    klog(KLOG_USB, KLOG_INFO, "ehci: completions on IRQ %u\n", g_irq_line);
+    return 0;
+}
+
+void ehci_dump(void) {
+    if (!g_op) {
+        printf("ehci: no controller\n");
+        return;
+    }
+    printf("ehci: %u ports, %u companions, IRQ %u\n", g_nports, g_ncc, g_irq_line);
+    printf("  irqs=%u transfers=%u bytes=%u errors=%u\n",
+           g_stats.irqs, g_stats.transfers, g_stats.bytes, g_stats.errors);
+    for (uint32_t port = 0; port < g_nports; port++) {
+        uint32_t sc = op_read(EHCI_PORTSC(port));
+        printf("  port %u: %s%s%s\n", port,
+               (sc & PORT_CCS) ? "connected" : "empty",
+               (sc & PORT_PE) ? ", enabled" : "",
+               (sc & PORT_OWNER) ? ", companion" : "");
+    }
+    for (int i = 0; i < EHCI_MAX_DEVICES; i++) {
+        struct ehci_device* d = &g_devices[i];
+        if (!d->active) continue;
+        printf("  dev %u (port %u): %x:%x class %x/%x/%x bulk in=%x out=%x intr=%x\n",
+               d->address, d->port, d->desc.vendor_id, d->desc.product_id,
+               d->iface_class, d->iface_subclass, d->iface_protocol,
+               d->bulk_in ? d->bulk_in->ep : 0, d->bulk_out ? d->bulk_out->ep : 0,
+               d->intr_in ? d->intr_in->ep : 0);
+    }
+}
@@ -1,11 +1,20 @@
 #include <kernel/usb.h>
 #include <kernel/pci.h>
+#include <kernel/irq.h>
 #include <kernel/stdio.h>
+#include <kernel/klog.h>
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <string.h>
 
-/* UHCI (USB 1.1) Host Controller Driver */
+/* UHCI (USB 1.1) Host Controller Driver
+
+   Interrupt endpoints hang off a tree of skeleton QHs, one per polling
+   interval 1, 2, 4 ... 128 ms. Frame i enters at the skeleton for the
+   largest power of two dividing i, which links on to every shorter
+   interval, so an endpoint queued behind skeleton k is visited every
+   2^k frames. Completions come in on the controller's PCI interrupt; the
+   timer only carries the handler when no line is routed. */
 
 #define UHCI_CLASS_CODE     0x0C
 #define UHCI_SUBCLASS       0x03
@@ -51,8 +60,20 @@
 #define UHCI_PORT_PR        (1 << 9)  /* Port Reset */
 #define UHCI_PORT_SUSP      (1 << 12) /* Suspend */
 
+/* USBINTR bits */
+#define UHCI_INTR_TIMEOUT   (1 << 0)  /* Timeout/CRC */
+#define UHCI_INTR_RESUME    (1 << 1)
+#define UHCI_INTR_IOC       (1 << 2)  /* Interrupt on Complete */
+#define UHCI_INTR_SP        (1 << 3)  /* Short Packet */
+
+/* PCI legacy support register: clear SMI routing, let PIRQ through */
+#define UHCI_PCI_LEGSUP     0xC0
+#define UHCI_LEGSUP_RWC     0x8F00
+#define UHCI_LEGSUP_PIRQ    0x2000
+
 #define UHCI_NUM_FRAMES     1024
 #define UHCI_MAX_PORTS      8
+#define UHCI_SKEL_LEVELS    8         /* intervals 1..128 ms */
 
 /* UHCI Transfer Descriptor */
 typedef struct uhci_td {
@@ -84,6 +105,8 @@ typedef struct uhci_qh {
 #define TD_CTRL_NAK       (1 << 19)  /* NAK Received */
 #define TD_CTRL_CRCTO     (1 << 18)  /* CRC/Timeout Error */
 #define TD_CTRL_BITSTUFF  (1 << 17)  /* Bitstuff Error */
+#define TD_CTRL_ACTLEN_MASK 0x7FF     /* Actual length - 1 */
+#define TD_CTRL_ERRORS    (TD_CTRL_STALLED | TD_CTRL_BABBLE | TD_CTRL_CRCTO | TD_CTRL_BITSTUFF)
 
 /* TD Token bits */
 #define TD_TOKEN_PID_MASK   0xFF
@@ -94,10 +117,15 @@ typedef struct uhci_qh {
 #define TD_TOKEN_DEVADDR_SHIFT 8
 #define TD_TOKEN_ENDPOINT_SHIFT 15
 #define TD_TOKEN_MAXLEN_SHIFT 21
+#define TD_TOKEN_TOGGLE     (1u << 19)  /* DATA0/DATA1 */
+
+/* Boot keyboards are not enumerated, so their endpoint descriptor is
+   never read; 10 ms is the bInterval they report in practice. */
+#define USB_KBD_INTERVAL    10
 
 static uint16_t g_uhci_iobase = 0;
 static uint32_t* g_frame_list = NULL;
-static int g_uhci_ready = 0;
+static uhci_qh_t* g_skel = NULL;      /* g_skel[k]: every 2^k frames */
 
 /* Per-device state */
 #define MAX_USB_DEVICES 8
@@ -106,6 +134,8 @@ typedef struct {
     int port;
     int address;
     int low_speed;
+    int interval;           /* bInterval of the interrupt endpoint, ms */
+    int toggle;             /* DATA0/DATA1 expected next */
     uhci_qh_t* interrupt_qh;
     uhci_td_t* interrupt_td;
     uint32_t interrupt_buffer_phys;
@@ -141,7 +171,7 @@ static inline void uhci_write32(uint16_t reg, uint32_t val) {
 }
 
 static int uhci_reset(void) {
-    printf("uhci: resetting controller\n");
+    klog(KLOG_USB, KLOG_DEBUG, "uhci: resetting controller\n");
     
     /* Stop the controller */
     uhci_write16(UHCI_USBCMD, 0);
@@ -166,11 +196,11 @@ static int uhci_reset(void) {
     }
     
     if (uhci_read16(UHCI_USBCMD) & UHCI_CMD_HCRESET) {
-        printf("uhci: reset timeout\n");
+        klog(KLOG_USB, KLOG_ERR, "uhci: reset timeout\n");
         return -1;
     }
     
-    printf("uhci: reset complete\n");
+    klog(KLOG_USB, KLOG_DEBUG, "uhci: reset complete\n");
     return 0;
 }
 
@@ -178,18 +208,21 @@ static int uhci_init_controller(struct pci_device* dev) {
     /* Get I/O base address from BAR4 */
     uint32_t bar4 = pci_config_read32(dev->bus, dev->slot, dev->function, 0x20);
     if (!(bar4 & 1)) {
-        printf("uhci: BAR4 is not I/O space\n");
+        klog(KLOG_USB, KLOG_ERR, "uhci: BAR4 is not I/O space\n");
         return -1;
     }
     
     g_uhci_iobase = bar4 & 0xFFF0;
-    printf("uhci: I/O base = 0x%x\n", g_uhci_iobase);
+    klog(KLOG_USB, KLOG_DEBUG, "uhci: I/O base = 0x%x\n", g_uhci_iobase);
     
     /* Enable PCI bus mastering and I/O space */
     uint16_t cmd = pci_config_read16(dev->bus, dev->slot, dev->function, 0x04);
     cmd |= (1 << 0) | (1 << 2);  /* I/O Space | Bus Master */
     pci_config_write16(dev->bus, dev->slot, dev->function, 0x04, cmd);
     
+    /* Take the controller away from BIOS legacy emulation (SMI) */
+    pci_config_write16(dev->bus, dev->slot, dev->function, UHCI_PCI_LEGSUP, UHCI_LEGSUP_RWC);
+
     /* Reset the controller */
     if (uhci_reset() != 0) {
         return -1;
@@ -198,16 +231,30 @@ static int uhci_init_controller(struct pci_device* dev) {
     /* Allocate frame list (1024 entries * 4 bytes, 4KB aligned) */
     uint32_t frame_list_phys = pmm_alloc_frame_below(0x01000000);
     if (!frame_list_phys) {
-        printf("uhci: failed to allocate frame list\n");
+        klog(KLOG_USB, KLOG_ERR, "uhci: failed to allocate frame list\n");
         return -1;
     }
     
     g_frame_list = (uint32_t*)(uintptr_t)frame_list_phys;
-    memset(g_frame_list, 0, 4096);
-    
-    /* Mark all frames as invalid initially */
+
+    /* Skeleton QHs: k links on to k-1, interval 1 ends the frame */
+    uint32_t skel_phys = pmm_alloc_frame_below(0x01000000);
+    if (!skel_phys) {
+        klog(KLOG_USB, KLOG_ERR, "uhci: failed to allocate skeleton QHs\n");
+        return -1;
+    }
+    g_skel = (uhci_qh_t*)(uintptr_t)skel_phys;
+    memset(g_skel, 0, 4096);
+    for (int k = 0; k < UHCI_SKEL_LEVELS; k++) {
+        g_skel[k].head_ptr = k ? ((uint32_t)(uintptr_t)&g_skel[k - 1] | 0x2) : 1;
+        g_skel[k].element_ptr = 1;  /* no TDs of its own */
+    }
+
+    /* Frame i starts at the longest interval that divides it */
     for (int i = 0; i < UHCI_NUM_FRAMES; i++) {
-        g_frame_list[i] = 1;  /* T-bit set = invalid */
+        int k = i ? __builtin_ctz((unsigned)i) : UHCI_SKEL_LEVELS - 1;
+        if (k > UHCI_SKEL_LEVELS - 1) k = UHCI_SKEL_LEVELS - 1;
+        g_frame_list[i] = (uint32_t)(uintptr_t)&g_skel[k] | 0x2;
     }
     
     /* Set frame list base address */
@@ -219,13 +266,14 @@ static int uhci_init_controller(struct pci_device* dev) {
     /* Clear status register */
     uhci_write16(UHCI_USBSTS, 0xFFFF);
     
-    /* Enable interrupts */
-    uhci_write16(UHCI_USBINTR, 0x0F);  /* All interrupts */
+    /* Completions and transfer errors; host errors interrupt regardless */
+    uhci_write16(UHCI_USBINTR, UHCI_INTR_TIMEOUT | UHCI_INTR_IOC | UHCI_INTR_SP);
     
     /* Start the controller */
     uhci_write16(UHCI_USBCMD, UHCI_CMD_RS | UHCI_CMD_CF | UHCI_CMD_MAXP);
+    pci_config_write16(dev->bus, dev->slot, dev->function, UHCI_PCI_LEGSUP, UHCI_LEGSUP_PIRQ);
     
-    printf("uhci: controller started\n");
+    klog(KLOG_USB, KLOG_INFO, "uhci: controller started\n");
     
     return 0;
 }
@@ -263,12 +311,12 @@ static uhci_td_t* uhci_build_interrupt_td(uint8_t devaddr, uint8_t endpoint,
 
 /* Helper: Setup interrupt transfer for keyboard */
 static int uhci_setup_keyboard_interrupt(usb_device_t* dev) {
-    printf("uhci: setting up interrupt transfer for device at address %d\n", dev->address);
+    klog(KLOG_USB, KLOG_DEBUG, "uhci: setting up interrupt transfer for device at address %d\n", dev->address);
     
     /* Allocate buffer for keyboard reports (8 bytes) */
     dev->interrupt_buffer_phys = pmm_alloc_frame_below(0x01000000);
     if (!dev->interrupt_buffer_phys) {
-        printf("uhci: failed to allocate interrupt buffer\n");
+        klog(KLOG_USB, KLOG_ERR, "uhci: failed to allocate interrupt buffer\n");
         return -1;
     }
     dev->interrupt_buffer = (uint8_t*)(uintptr_t)dev->interrupt_buffer_phys;
@@ -277,7 +325,7 @@ static int uhci_setup_keyboard_interrupt(usb_device_t* dev) {
     /* Allocate Queue Head */
     uint32_t qh_phys = pmm_alloc_frame_below(0x01000000);
     if (!qh_phys) {
-        printf("uhci: failed to allocate QH\n");
+        klog(KLOG_USB, KLOG_ERR, "uhci: failed to allocate QH\n");
         return -1;
     }
     dev->interrupt_qh = (uhci_qh_t*)(uintptr_t)qh_phys;
@@ -288,42 +336,42 @@ static int uhci_setup_keyboard_interrupt(usb_device_t* dev) {
                                                 dev->interrupt_buffer_phys, 8,
                                                 dev->low_speed);
     if (!dev->interrupt_td) {
-        printf("uhci: failed to build interrupt TD\n");
+        klog(KLOG_USB, KLOG_ERR, "uhci: failed to build interrupt TD\n");
         return -1;
     }
     
-    /* Setup QH */
-    dev->interrupt_qh->head_ptr = 1;  /* T-bit: terminate */
+    /* Queue behind the skeleton for the longest interval not above
+       bInterval; link the QH up before the controller can reach it */
+    int level = 0;
+    while (level < UHCI_SKEL_LEVELS - 1 && (2 << level) <= dev->interval) level++;
+    uhci_qh_t* skel = &g_skel[level];
     dev->interrupt_qh->element_ptr = (uint32_t)(uintptr_t)dev->interrupt_td;
+    dev->interrupt_qh->head_ptr = skel->head_ptr;
+    skel->head_ptr = qh_phys | 0x2;  /* QH pointer, bit 1 set */
     
-    /* Add QH to frame list (every 8ms = every 8 frames) */
-    uint32_t qh_phys_link = qh_phys | 0x2;  /* QH pointer, bit 1 set */
-    for (int i = 0; i < UHCI_NUM_FRAMES; i += 8) {
-        g_frame_list[i] = qh_phys_link;
-    }
-    
-    printf("uhci: interrupt transfer configured (polling every 8ms)\n");
+    klog(KLOG_USB, KLOG_DEBUG, "uhci: interrupt transfer configured (bInterval %d, polled every %d ms)\n",
+         dev->interval, 1 << level);
     return 0;
 }
 
 static void uhci_check_ports(void) {
-    printf("uhci: checking ports\n");
+    klog(KLOG_USB, KLOG_DEBUG, "uhci: checking ports\n");
     
     for (int port = 0; port < 2; port++) {  /* UHCI typically has 2 ports */
         uint16_t reg = UHCI_PORTSC1 + (port * 2);
         uint16_t status = uhci_read16(reg);
         
-        printf("uhci: port %d status = 0x%x\n", port, status);
+        klog(KLOG_USB, KLOG_DEBUG, "uhci: port %d status = 0x%x\n", port, status);
         
         if (status & UHCI_PORT_CCS) {
-            printf("uhci: port %d: device connected\n", port);
+            klog(KLOG_USB, KLOG_INFO, "uhci: port %d: device connected\n", port);
             
             /* Check if low-speed device */
             int low_speed = (status & UHCI_PORT_LSDA) ? 1 : 0;
-            printf("uhci: port %d: %s speed\n", port, low_speed ? "low" : "full");
+            klog(KLOG_USB, KLOG_DEBUG, "uhci: port %d: %s speed\n", port, low_speed ? "low" : "full");
             
             /* Reset the port */
-            printf("uhci: port %d: resetting\n", port);
+            klog(KLOG_USB, KLOG_DEBUG, "uhci: port %d: resetting\n", port);
             uhci_write16(reg, status | UHCI_PORT_PR);
             
             /* Wait 50ms for reset */
@@ -336,7 +384,7 @@ static void uhci_check_ports(void) {
             for (int i = 0; i < 100; i++) {
                 status = uhci_read16(reg);
                 if (status & UHCI_PORT_PED) {
-                    printf("uhci: port %d: enabled\n", port);
+                    klog(KLOG_USB, KLOG_DEBUG, "uhci: port %d: enabled\n", port);
                     break;
                 }
                 for (volatile int j = 0; j < 1000; j++) { }
@@ -352,7 +400,7 @@ static void uhci_check_ports(void) {
             }
             
             if (!dev) {
-                printf("uhci: no free device slots\n");
+                klog(KLOG_USB, KLOG_WARN, "uhci: no free device slots\n");
                 continue;
             }
             
@@ -361,6 +409,7 @@ static void uhci_check_ports(void) {
             dev->port = port;
             dev->address = g_next_address++;
             dev->low_speed = low_speed;
+            dev->interval = USB_KBD_INTERVAL;
             
             /* For boot keyboards, we skip full enumeration and assume:
              * - Device responds to address 0
@@ -380,7 +429,7 @@ static void uhci_check_ports(void) {
             
             /* Setup interrupt transfer */
             if (uhci_setup_keyboard_interrupt(dev) != 0) {
-                printf("uhci: failed to setup keyboard interrupt\n");
+                klog(KLOG_USB, KLOG_ERR, "uhci: failed to setup keyboard interrupt\n");
                 dev->active = 0;
                 continue;
             }
@@ -392,11 +441,53 @@ static void uhci_check_ports(void) {
     }
 }
 
+/* Give a finished TD back to the controller for the next report. */
+static void uhci_rearm(usb_device_t* dev) {
+    uhci_td_t* td = dev->interrupt_td;
+    td->token = (td->token & ~TD_TOKEN_TOGGLE) | (dev->toggle ? TD_TOKEN_TOGGLE : 0);
+    td->status = TD_CTRL_ACTIVE | TD_CTRL_IOC | (3 << 27);
+    if (dev->low_speed) {
+        td->status |= TD_CTRL_LS;
+    }
+    /* The controller advanced the QH past the TD when it retired it */
+    dev->interrupt_qh->element_ptr = (uint32_t)(uintptr_t)td;
+}
+
+static int uhci_irq(void) {
+    uint16_t status = uhci_read16(UHCI_USBSTS);
+    if (!(status & (UHCI_STS_USBINT | UHCI_STS_ERROR | UHCI_STS_HSE | UHCI_STS_HCPE))) {
+        return 0;  /* someone else on a shared line */
+    }
+    uhci_write16(UHCI_USBSTS, status & 0x1F);  /* write-1-to-clear */
+    if (status & (UHCI_STS_HSE | UHCI_STS_HCPE)) {
+        klog(KLOG_USB, KLOG_ERR, "uhci: host controller error (status 0x%x)\n", status);
+    }
+    
+    for (int i = 0; i < MAX_USB_DEVICES; i++) {
+        usb_device_t* dev = &g_usb_devices[i];
+        if (!dev->active || !dev->interrupt_td) continue;
+        uint32_t td_status = dev->interrupt_td->status;
+        if (td_status & TD_CTRL_ACTIVE) continue;
+        
+        /* A failed transaction did not consume the toggle; retry as is */
+        if (!(td_status & TD_CTRL_ERRORS)) {
+            int len = (int)((td_status + 1) & TD_CTRL_ACTLEN_MASK);
+            dev->toggle ^= 1;
+            if (len) {
+                extern void usb_keyboard_process_report(const uint8_t* data, int len);
+                usb_keyboard_process_report(dev->interrupt_buffer, len);
+            }
+        }
+        uhci_rearm(dev);
+    }
+    return 1;
+}
+
 int usb_init(void) {
-    printf("usb: initializing UHCI driver\n");
+    klog(KLOG_USB, KLOG_DEBUG, "usb: initializing UHCI driver\n");
     
     /* Debug: List all PCI devices to find USB controller */
-    printf("usb: scanning PCI for USB controllers (class 0x0C subclass 0x03)...\n");
+    klog(KLOG_USB, KLOG_DEBUG, "usb: scanning PCI for USB controllers (class 0x0C subclass 0x03)...\n");
     int usb_found = 0;
     for (uint16_t bus = 0; bus < 256; bus++) {
         for (uint8_t slot = 0; slot < 32; slot++) {
@@ -410,12 +501,12 @@ int usb_init(void) {
             
             /* Print all devices for debugging */
             if (bus < 2) {  /* Only print bus 0 and 1 to avoid spam */
-                printf("pci: %u:%u.0 vendor=0x%x device=0x%x class=0x%x:0x%x:0x%x\n",
+                klog(KLOG_USB, KLOG_DEBUG, "pci: %u:%u.0 vendor=0x%x device=0x%x class=0x%x:0x%x:0x%x\n",
                        bus, slot, vendor, device, class, subclass, prog_if);
             }
             
             if (class == 0x0C && subclass == 0x03) {
-                printf("usb: found USB controller at %u:%u.0 vendor=0x%x device=0x%x prog_if=0x%x\n",
+                klog(KLOG_USB, KLOG_DEBUG, "usb: found USB controller at %u:%u.0 vendor=0x%x device=0x%x prog_if=0x%x\n",
                        bus, slot, vendor, device, prog_if);
                 usb_found = 1;
             }
@@ -423,7 +514,7 @@ int usb_init(void) {
     }
     
     if (!usb_found) {
-        printf("usb: no USB controllers found in PCI scan\n");
+        klog(KLOG_USB, KLOG_DEBUG, "usb: no USB controllers found in PCI scan\n");
     }
     
     struct pci_device dev;
@@ -431,14 +522,19 @@ int usb_init(void) {
     if (pci_find_class(UHCI_CLASS_CODE, UHCI_SUBCLASS, UHCI_PROG_IF, &dev) != 0) {
         /* Try with wildcard prog_if - some controllers don't report correctly */
         if (pci_find_class(UHCI_CLASS_CODE, UHCI_SUBCLASS, 0xFF, &dev) != 0) {
-            printf("usb: no UHCI controller found\n");
+            klog(KLOG_USB, KLOG_DEBUG, "usb: no UHCI controller found\n");
+            return -1;
+        }
+        uint8_t prog_if = pci_config_read8(dev.bus, dev.slot, dev.function, 0x09);
+        klog(KLOG_USB, KLOG_DEBUG, "usb: found USB controller with wildcard match (prog_if=0x%x)\n", prog_if);
+        /* OHCI, EHCI and xHCI report themselves correctly; not ours */
+        if (prog_if == 0x10 || prog_if == 0x20 || prog_if == 0x30) {
+            klog(KLOG_USB, KLOG_DEBUG, "usb: no UHCI controller found\n");
             return -1;
         }
-        printf("usb: found USB controller with wildcard match (prog_if=0x%02x)\n",
-               pci_config_read8(dev.bus, dev.slot, dev.function, 0x09));
     }
     
-    printf("usb: found UHCI controller 0x%x:0x%x at bus=%u slot=%u func=%u\n",
+    klog(KLOG_USB, KLOG_INFO, "usb: found UHCI controller 0x%x:0x%x at bus=%u slot=%u func=%u\n",
            dev.vendor_id, dev.device_id, dev.bus, dev.slot, dev.function);
     
     if (uhci_init_controller(&dev) != 0) {
@@ -448,50 +544,16 @@ int usb_init(void) {
     /* Check for connected devices */
     uhci_check_ports();
     
-    g_uhci_ready = 1;
-    return 0;
-}
-
-void usb_poll(void) {
-    if (!g_uhci_ready) return;
-    
-    /* Check USB status */
-    uint16_t status = uhci_read16(UHCI_USBSTS);
-    if (status & UHCI_STS_USBINT) {
-        /* Clear interrupt */
-        uhci_write16(UHCI_USBSTS, UHCI_STS_USBINT);
+    /* Interrupt line as assigned by the BIOS; without one, the timer
+       carries the handler */
+    uint8_t line = pci_config_read8(dev.bus, dev.slot, dev.function, 0x3C);
+    if (line == 0 || line >= IRQ_LINES) {
+        klog(KLOG_USB, KLOG_WARN, "uhci: no interrupt line routed, servicing from the timer\n");
+        line = 0;
     }
-    
-    /* Poll all active devices */
-    for (int i = 0; i < MAX_USB_DEVICES; i++) {
-        usb_device_t* dev = &g_usb_devices[i];
-        if (!dev->active || !dev->interrupt_td) continue;
-        
-        /* Check if TD completed */
-        if (!(dev->interrupt_td->status & TD_CTRL_ACTIVE)) {
-            /* Check for errors */
-            if (dev->interrupt_td->status & (TD_CTRL_STALLED | TD_CTRL_BABBLE | 
-                                            TD_CTRL_CRCTO | TD_CTRL_BITSTUFF)) {
-                /* Error occurred - re-activate TD */
-                dev->interrupt_td->status = TD_CTRL_ACTIVE | TD_CTRL_IOC | (3 << 27);
-                if (dev->low_speed) {
-                    dev->interrupt_td->status |= TD_CTRL_LS;
-                }
-                continue;
-            }
-            
-            /* Transfer completed successfully */
-            /* Process keyboard report */
-            extern void usb_keyboard_process_report(const uint8_t* data, int len);
-            usb_keyboard_process_report(dev->interrupt_buffer, 8);
-            
-            /* Re-activate TD for next transfer */
-            dev->interrupt_td->status = TD_CTRL_ACTIVE | TD_CTRL_IOC | (3 << 27);
-            if (dev->low_speed) {
-                dev->interrupt_td->status |= TD_CTRL_LS;
-            }
-            
-            /* Toggle data toggle (should be done properly, but for boot protocol it often works without) */
-        }
+    if (irq_register(line, uhci_irq) != 0) {
+        return -1;
     }
+    klog(KLOG_USB, KLOG_INFO, "uhci: completions on IRQ %u\n", line);
+    return 0;
 }
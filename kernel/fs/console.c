@@ -0,0 +1,70 @@
+#include <kernel/console.h>
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/serial.h>
+#include <kernel/tty.h>
+#include <kernel/keyboard.h>
+#include <kernel/poll.h>
+
+/* Character-device inode for the console so that generic VFS paths
+   (sendfile, fd-based read/write) treat it like any other file. Every
+   process starts with it on fds 0, 1 and 2. */
+
+static int console_write(struct vfs_inode* inode, uint32_t off, const void* buf, unsigned len) {
+    (void)inode; (void)off;
+    const char* s = (const char*)buf;
+    for (unsigned i = 0; i < len; ++i) {
+        serial_putchar(s[i]);
+    }
+    terminal_write(s, len);
+    return (int)len;
+}
+
+/* Line-buffered keyboard read with echo; returns after a newline or when
+   len bytes have been typed. */
+static int console_read(struct vfs_inode* inode, uint32_t off, void* buf, unsigned len) {
+    (void)inode; (void)off;
+    char* dst = (char*)buf;
+    unsigned n = 0;
+    /* Sleep on the keyboard wait queue between keys. waitq_sleep re-enables
+       interrupts, which the syscall gate had cleared, so IRQ1 can wake us. */
+    volatile uint32_t woken = 0;
+    struct waiter w = { 0, &woken };
+    waitq_add(kbd_waitq(), &w);
+    while (n < len) {
+        int ch = kbd_getch();
+        if (ch < 0) { waitq_sleep(&woken, 0); woken = 0; continue; }
+        if (ch == '\r') ch = '\n';
+        if (ch == '\b') {
+            if (n > 0) { n--; terminal_putchar('\b'); terminal_putchar(' '); terminal_putchar('\b'); }
+            continue;
+        }
+        dst[n++] = (char)ch;
+        terminal_putchar((char)ch);
+        if (ch == '\n') break;
+    }
+    waitq_remove(kbd_waitq(), &w);
+    return (int)n;
+}
+
+static uint32_t console_poll(struct vfs_inode* inode, struct poll_table* pt) {
+    (void)inode;
+    poll_wait(pt, kbd_waitq());
+    return POLLOUT | (kbd_available() ? POLLIN : 0);
+}
+
+static const struct vfs_file_ops console_fops = {
+    .read = console_read, .write = console_write, .poll = console_poll,
+};
+
+static struct vfs_super console_sb = { .fstype = "console" };
+static struct vfs_inode console_inode = {
+    .sb = &console_sb,
+    .type = FS_DT_CHR,
+    .valid = 1,
+    .refs = 1,
+    .fops = &console_fops,
+};
+static struct vfs_file console = { .inode = &console_inode, .refs = 1 };
+
+struct vfs_file* console_file(void) { return &console; }
@@ -0,0 +1,205 @@
+#include <kernel/devfs.h>
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/console.h>
+#include <kernel/block.h>
+#include <kernel/ext2.h>
+#include <kernel/serial.h>
+#include <kernel/poll.h>
+#include <string.h>
+
+/* Device nodes so that devices can be opened by path and driven through
+   ordinary fds: /dev/console is the keyboard/screen console, /dev/ttyS0 the
+   raw COM1 line and /dev/disk the raw block device, addressed in bytes.
+   The table is fixed. */
+
+#define DEVFS_ROOT_INO    1
+#define DEVFS_CONSOLE_INO 2
+#define DEVFS_DISK_INO    3
+#define DEVFS_TTYS0_INO   4
+
+#define SECTOR_SIZE    512u
+#define BOUNCE_SECTORS 8u
+
+struct devfs_node {
+    const char* name;
+    uint32_t ino;
+    uint8_t type;
+};
+
+static const struct devfs_node dev_nodes[] = {
+    { "console", DEVFS_CONSOLE_INO, FS_DT_CHR },
+    { "ttyS0",   DEVFS_TTYS0_INO,   FS_DT_CHR },
+    { "disk",    DEVFS_DISK_INO,    FS_DT_BLK },
+};
+#define DEVFS_NODES (sizeof(dev_nodes) / sizeof(dev_nodes[0]))
+
+static struct vfs_super devfs_sb;
+static uint8_t g_bounce[BOUNCE_SECTORS * SECTOR_SIZE];
+
+static int node_present(const struct devfs_node* n) {
+    return n->ino != DEVFS_DISK_INO || block_is_ready();
+}
+
+static int devfs_lookup(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* ino) {
+    (void)dir;
+    if (len == 2 && name[0] == '.' && name[1] == '.') { *ino = DEVFS_ROOT_INO; return 0; }
+    for (unsigned i = 0; i < DEVFS_NODES; ++i) {
+        const struct devfs_node* n = &dev_nodes[i];
+        if (node_present(n) && strlen(n->name) == len && memcmp(n->name, name, len) == 0) {
+            *ino = n->ino;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int devfs_getdents(struct vfs_inode* dir, uint32_t* cookie, void* buf, unsigned len) {
+    (void)dir;
+    uint8_t* out = (uint8_t*)buf;
+    unsigned n = 0;
+    uint32_t i = *cookie;
+    for (; i < DEVFS_NODES; ++i) {
+        const struct devfs_node* c = &dev_nodes[i];
+        if (!node_present(c)) continue;
+        unsigned namlen = (unsigned)strlen(c->name);
+        unsigned reclen = (unsigned)(sizeof(struct fs_dirent) + namlen + 1 + 3) & ~3u;
+        if (n + reclen > len) {
+            if (n == 0) return -1;
+            break;
+        }
+        struct fs_dirent* d = (struct fs_dirent*)(out + n);
+        d->d_ino = c->ino;
+        d->d_off = i + 1;
+        d->d_reclen = (uint16_t)reclen;
+        d->d_type = c->type;
+        d->d_namlen = (uint8_t)namlen;
+        memcpy(d->d_name, c->name, namlen + 1);
+        n += reclen;
+    }
+    *cookie = i;
+    return (int)n;
+}
+
+/* Raw disk: whole sectors go through a small bounce buffer so callers may
+   use any byte offset and length; partial sectors are read-modify-write.
+   Writes are refused while ext2 is mounted from the disk: its block
+   cache, in-memory superblock and the page cache would all go stale. */
+static int disk_read(struct vfs_inode* inode, uint32_t off, void* buf, unsigned len) {
+    (void)inode;
+    unsigned done = 0;
+    while (done < len) {
+        uint32_t lba = off / SECTOR_SIZE;
+        uint32_t skip = off % SECTOR_SIZE;
+        unsigned want = len - done + skip;
+        unsigned count = (want + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        if (count > BOUNCE_SECTORS) count = BOUNCE_SECTORS;
+        if (block_read(lba, (uint8_t)count, g_bounce) != 0) break;
+        unsigned n = count * SECTOR_SIZE - skip;
+        if (n > len - done) n = len - done;
+        memcpy((uint8_t*)buf + done, g_bounce + skip, n);
+        done += n;
+        off += n;
+    }
+    return (done || len == 0) ? (int)done : -1;
+}
+
+static int disk_write(struct vfs_inode* inode, uint32_t off, const void* buf, unsigned len) {
+    (void)inode;
+    if (ext2_on_disk()) return -1;
+    unsigned done = 0;
+    while (done < len) {
+        uint32_t lba = off / SECTOR_SIZE;
+        uint32_t skip = off % SECTOR_SIZE;
+        unsigned want = len - done + skip;
+        unsigned count = (want + SECTOR_SIZE - 1) / SECTOR_SIZE;
+        if (count > BOUNCE_SECTORS) count = BOUNCE_SECTORS;
+        unsigned n = count * SECTOR_SIZE - skip;
+        if (n > len - done) n = len - done;
+        if (skip || (skip + n) % SECTOR_SIZE) {
+            if (block_read(lba, (uint8_t)count, g_bounce) != 0) break;
+        }
+        memcpy(g_bounce + skip, (const uint8_t*)buf + done, n);
+        if (block_write(lba, (uint8_t)count, g_bounce) != 0) break;
+        done += n;
+        off += n;
+    }
+    return (done || len == 0) ? (int)done : -1;
+}
+
+/* COM1 without line discipline: a read sleeps until at least one byte is
+   in, then returns what is buffered. */
+static int ttys_read(struct vfs_inode* inode, uint32_t off, void* buf, unsigned len) {
+    (void)inode; (void)off;
+    uint8_t* dst = (uint8_t*)buf;
+    unsigned n = 0;
+    if (len == 0) return 0;
+    volatile uint32_t woken = 0;
+    struct waiter w = { 0, &woken };
+    waitq_add(serial_rx_waitq(), &w);
+    for (;;) {
+        int c;
+        while (n < len && (c = serial_getchar()) >= 0) dst[n++] = (uint8_t)c;
+        if (n) break;
+        waitq_sleep(&woken, 0);
+        woken = 0;
+    }
+    waitq_remove(serial_rx_waitq(), &w);
+    return (int)n;
+}
+
+static int ttys_write(struct vfs_inode* inode, uint32_t off, const void* buf, unsigned len) {
+    (void)inode; (void)off;
+    const char* s = (const char*)buf;
+    for (unsigned i = 0; i < len; ++i) serial_putchar(s[i]);
+    return (int)len;
+}
+
+static uint32_t ttys_poll(struct vfs_inode* inode, struct poll_table* pt) {
+    (void)inode;
+    poll_wait(pt, serial_rx_waitq());
+    if (pt && (pt->key & POLLOUT)) poll_wait(pt, serial_tx_waitq());
+    return (serial_available() ? POLLIN : 0) | (serial_tx_room() ? POLLOUT : 0);
+}
+
+static const struct vfs_inode_ops devfs_dir_iops = { .lookup = devfs_lookup };
+static const struct vfs_file_ops devfs_dir_fops = { .getdents = devfs_getdents };
+static const struct vfs_file_ops disk_fops = { .read = disk_read, .write = disk_write };
+static const struct vfs_file_ops ttys_fops = { .read = ttys_read, .write = ttys_write, .poll = ttys_poll };
+
+static int devfs_read_inode(struct vfs_super* sb, struct vfs_inode* inode) {
+    (void)sb;
+    switch (inode->ino) {
+        case DEVFS_ROOT_INO:
+            inode->type = FS_DT_DIR;
+            inode->iops = &devfs_dir_iops;
+            inode->fops = &devfs_dir_fops;
+            return 0;
+        case DEVFS_CONSOLE_INO:
+            inode->type = FS_DT_CHR;
+            inode->fops = console_file()->inode->fops;
+            return 0;
+        case DEVFS_TTYS0_INO:
+            inode->type = FS_DT_CHR;
+            inode->fops = &ttys_fops;
+            return 0;
+        case DEVFS_DISK_INO:
+            if (!block_is_ready()) return -1;
+            inode->type = FS_DT_BLK;
+            inode->fops = &disk_fops;
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static const struct vfs_super_ops devfs_sops = { .read_inode = devfs_read_inode };
+
+struct vfs_super* devfs_create_super(void) {
+    if (devfs_sb.dev) return &devfs_sb;
+    devfs_sb.fstype = "devfs";
+    devfs_sb.dev = vfs_alloc_dev();
+    devfs_sb.root_ino = DEVFS_ROOT_INO;
+    devfs_sb.ops = &devfs_sops;
+    return &devfs_sb;
+}
@@ -0,0 +1,306 @@
+#include <kernel/dynlink.h>
+#include <kernel/elf.h>
+#include <kernel/process.h>
+#include <kernel/syscall.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+/* All object data is read and patched in place through the process's own
+   mappings, so callers run with proc's page directory loaded and proc
+   current: the first touch of a shared page faults it in from the page
+   cache and a relocation write takes the usual copy-on-write path. */
+
+#define DL_USER_LO   0x00001000u
+#define DL_USER_TOP  0xC0000000u
+#define DL_MAX_DYN   256           /* entries scanned in one PT_DYNAMIC */
+
+/* Called by a PLT entry with [esp] = GOT[1] (object index) and [esp+4] =
+   relocation offset pushed by the entry; returns into the bound target.
+       push eax; push ecx; push edx; push ebx
+       mov ebx, [esp+16]     ; obj
+       mov ecx, [esp+20]     ; reloc_off
+       mov eax, SYS_dl_resolve
+       int 0x80
+       mov [esp+16], eax     ; replace obj with the target
+       pop ebx; pop edx; pop ecx; pop eax
+       ret 4                 ; jump to target, drop reloc_off  */
+static const uint8_t trampoline_code[] = {
+    0x50, 0x51, 0x52, 0x53,
+    0x8b, 0x5c, 0x24, 0x10,
+    0x8b, 0x4c, 0x24, 0x14,
+    0xb8, SYS_dl_resolve, 0x00, 0x00, 0x00,
+    0xcd, 0x80,
+    0x89, 0x44, 0x24, 0x10,
+    0x5b, 0x5a, 0x59, 0x58,
+    0xc2, 0x04, 0x00,
+};
+
+static uint32_t trampoline_phys; /* one frame shared by every process */
+
+static int user_range_ok(uint32_t addr, uint32_t len) {
+    return addr >= DL_USER_LO && addr < DL_USER_TOP && len <= DL_USER_TOP - addr;
+}
+
+/* A kernel store to [addr, addr+len) must not fault past the page-fault
+   handler: every page has to lie in a writable mapping (faulted in or
+   copied on write) or be present, user and writable already. */
+static int user_writable(struct process* proc, uint32_t addr, uint32_t len) {
+    if (!user_range_ok(addr, len) || !len) return 0;
+    for (uint32_t page = addr & ~0xFFFu; page < addr + len; page += 0x1000u) {
+        const struct vm_area* v = 0;
+        for (int i = 0; i < PROC_MAX_VMAS && !v; ++i) {
+            const struct vm_area* c = &proc->vmas[i];
+            if (c->start != c->end && page >= c->start && page < c->end) v = c;
+        }
+        if (v) {
+            if (!(v->prot & PROT_WRITE)) return 0;
+            continue;
+        }
+        const uint32_t want = PAGE_PRESENT | PAGE_USER | PAGE_WRITE;
+        if ((vmm_get_pte(page) & want) != want) return 0;
+    }
+    return 1;
+}
+
+static const char* user_str(uint32_t addr) {
+    if (!user_range_ok(addr, 1)) return 0;
+    const char* s = (const char*)addr;
+    for (uint32_t i = 0; i <= DL_NAME_MAX * 4; ++i) {
+        if (!user_range_ok(addr + i, 1)) return 0;
+        if (!s[i]) return s;
+    }
+    return 0;
+}
+
+static int parse_dynamic(struct dl_object* o) {
+    const Elf32_Dyn* d = (const Elf32_Dyn*)o->dynamic;
+    if (!user_range_ok(o->dynamic, DL_MAX_DYN * sizeof(Elf32_Dyn))) return -1;
+    for (int i = 0; i < DL_MAX_DYN && d[i].d_tag != DT_NULL; ++i) {
+        uint32_t v = d[i].d_val;
+        switch (d[i].d_tag) {
+            case DT_SYMTAB:   o->symtab = v + o->bias; break;
+            case DT_STRTAB:   o->strtab = v + o->bias; break;
+            case DT_HASH:     o->hash = v + o->bias; break;
+            case DT_REL:      o->rel = v + o->bias; break;
+            case DT_RELSZ:    o->relsz = v; break;
+            case DT_JMPREL:   o->jmprel = v + o->bias; break;
+            case DT_PLTRELSZ: o->pltrelsz = v; break;
+            case DT_PLTGOT:   o->pltgot = v + o->bias; break;
+            default: break;
+        }
+    }
+    if (!o->symtab || !o->strtab || !o->hash) {
+        printf("dl: object without symbol table or DT_HASH\n");
+        return -1;
+    }
+    /* The hash header is read once here; lookups trust these copies, not
+       whatever the process writes over the table later. nchain is also
+       the number of symbols in DT_SYMTAB. */
+    if (!user_range_ok(o->hash, 8)) return -1;
+    const uint32_t* ht = (const uint32_t*)o->hash;
+    o->nbucket = ht[0];
+    o->nchain = ht[1];
+    if (o->nbucket > DL_USER_TOP / 4 || o->nchain > DL_USER_TOP / 4 - o->nbucket ||
+        !user_range_ok(o->hash, (2 + o->nbucket + o->nchain) * 4) ||
+        o->nchain > DL_USER_TOP / sizeof(Elf32_Sym) ||
+        !user_range_ok(o->symtab, o->nchain * sizeof(Elf32_Sym)) ||
+        !user_range_ok(o->strtab, 1)) {
+        printf("dl: bad symbol or hash table\n");
+        return -1;
+    }
+    return 0;
+}
+
+static uint32_t elf_hash(const char* name) {
+    uint32_t h = 0;
+    while (*name) {
+        h = (h << 4) + (uint8_t)*name++;
+        uint32_t g = h & 0xF0000000u;
+        if (g) h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+/* Defined global or weak symbol in o, or 0. */
+static const Elf32_Sym* lookup_in(const struct dl_object* o, const char* name, uint32_t h) {
+    const uint32_t* ht = (const uint32_t*)o->hash;
+    uint32_t nbucket = o->nbucket, nchain = o->nchain;
+    if (!nbucket) return 0;
+    const uint32_t* chain = ht + 2 + nbucket;
+    const Elf32_Sym* syms = (const Elf32_Sym*)o->symtab;
+    uint32_t steps = 0;
+    for (uint32_t i = ht[2 + h % nbucket]; i && i < nchain && steps < nchain; i = chain[i], ++steps) {
+        const Elf32_Sym* s = &syms[i];
+        uint32_t bind = ELF32_ST_BIND(s->st_info);
+        if (s->st_shndx == 0 || (bind != STB_GLOBAL && bind != STB_WEAK)) continue;
+        const char* sname = user_str(o->strtab + s->st_name);
+        if (sname && !strcmp(sname, name)) return s;
+    }
+    return 0;
+}
+
+/* Address of symbol `sym` of object `from`, searched in load order. */
+static uint32_t resolve_sym(const struct dl_state* dl, const struct dl_object* from, uint32_t sym) {
+    if (sym >= from->nchain) {
+        printf("dl: symbol index %u out of range\n", sym);
+        return 0xFFFFFFFFu;
+    }
+    const Elf32_Sym* s = &((const Elf32_Sym*)from->symtab)[sym];
+    const char* name = user_str(from->strtab + s->st_name);
+    if (!name) return 0xFFFFFFFFu;
+    uint32_t h = elf_hash(name);
+    for (uint32_t i = 0; i < dl->nobjs; ++i) {
+        const Elf32_Sym* d = lookup_in(&dl->objs[i], name, h);
+        if (d) return d->st_value + dl->objs[i].bias;
+    }
+    if (ELF32_ST_BIND(s->st_info) == STB_WEAK) return 0;
+    printf("dl: unresolved symbol %s\n", name);
+    return 0xFFFFFFFFu;
+}
+
+static int relocate(struct process* proc, uint32_t index) {
+    const struct dl_state* dl = &proc->dl;
+    const struct dl_object* o = &dl->objs[index];
+    const Elf32_Rel* r = (const Elf32_Rel*)o->rel;
+    if (o->relsz && !user_range_ok(o->rel, o->relsz)) return -1;
+    for (uint32_t i = 0; i < o->relsz / sizeof(Elf32_Rel); ++i) {
+        uint32_t* where = (uint32_t*)(r[i].r_offset + o->bias);
+        if (!user_writable(proc, (uint32_t)where, 4)) {
+            printf("dl: relocation target 0x%x not writable\n", (uint32_t)where);
+            return -1;
+        }
+        uint32_t type = ELF32_R_TYPE(r[i].r_info);
+        uint32_t s;
+        switch (type) {
+            case R_386_RELATIVE:
+                *where += o->bias;
+                break;
+            case R_386_GLOB_DAT:
+            case R_386_32:
+                s = resolve_sym(dl, o, ELF32_R_SYM(r[i].r_info));
+                if (s == 0xFFFFFFFFu) return -1;
+                if (type == R_386_GLOB_DAT) *where = s; else *where += s;
+                break;
+            default:
+                printf("dl: unsupported relocation type %u\n", type);
+                return -1;
+        }
+    }
+
+    /* Lazy binding: slots keep pointing back into their PLT entry (rebased
+       for a library) until the first call goes through the trampoline. */
+    const Elf32_Rel* j = (const Elf32_Rel*)o->jmprel;
+    if (o->pltrelsz && !user_range_ok(o->jmprel, o->pltrelsz)) return -1;
+    for (uint32_t i = 0; i < o->pltrelsz / sizeof(Elf32_Rel); ++i) {
+        uint32_t* where = (uint32_t*)(j[i].r_offset + o->bias);
+        if (!user_writable(proc, (uint32_t)where, 4) || ELF32_R_TYPE(j[i].r_info) != R_386_JMP_SLOT) {
+            printf("dl: bad PLT relocation\n");
+            return -1;
+        }
+        *where += o->bias;
+    }
+    if (o->pltgot && o->pltrelsz) {
+        if (!user_writable(proc, o->pltgot, 12)) return -1;
+        uint32_t* got = (uint32_t*)o->pltgot;
+        got[1] = index;
+        got[2] = DL_TRAMPOLINE;
+    }
+    return 0;
+}
+
+static int map_trampoline(void) {
+    if (!trampoline_phys) {
+        trampoline_phys = pmm_alloc_frame();
+        if (!trampoline_phys) return -1;
+        uint8_t* p = (uint8_t*)vmm_phys_to_virt(trampoline_phys);
+        memset(p, 0xCC, 4096);
+        memcpy(p, trampoline_code, sizeof(trampoline_code));
+    }
+    if (vmm_get_pte(DL_TRAMPOLINE) & PAGE_USER) return 0;
+    pmm_ref_frame(trampoline_phys); /* dropped with the address space */
+    if (vmm_map(DL_TRAMPOLINE, trampoline_phys, PAGE_USER) != 0) {
+        pmm_unref_frame(trampoline_phys);
+        return -1;
+    }
+    return 0;
+}
+
+static int loaded(const struct dl_state* dl, const char* name) {
+    for (uint32_t i = 1; i < dl->nobjs; ++i) {
+        if (!strcmp(dl->objs[i].name, name)) return 1;
+    }
+    return 0;
+}
+
+/* Map the library `name` (a DT_NEEDED string) as the next object. */
+static int load_needed(struct process* proc, const char* name) {
+    struct dl_state* dl = &proc->dl;
+    if (dl->nobjs >= DL_MAX_OBJS) {
+        printf("dl: too many libraries (max %u)\n", DL_MAX_OBJS - 1);
+        return -1;
+    }
+    size_t len = strlen(name);
+    if (len == 0 || len > DL_NAME_MAX) return -1;
+    char path[DL_NAME_MAX + 6];
+    uint32_t bias = DL_LIB_BASE + (dl->nobjs - 1) * DL_LIB_STRIDE;
+    memcpy(path, "/lib/", 5);
+    memcpy(path + 5, name, len + 1);
+    uint32_t dyn = elf_load_library(proc, path, bias);
+    if (dyn == 0xFFFFFFFFu) dyn = elf_load_library(proc, path + 4, bias);
+    if (dyn == 0xFFFFFFFFu || dyn == 0) {
+        printf("dl: cannot load %s\n", name);
+        return -1;
+    }
+    struct dl_object* o = &dl->objs[dl->nobjs];
+    memset(o, 0, sizeof(*o));
+    o->bias = bias;
+    memcpy(o->name, name, len + 1);
+    o->dynamic = dyn;
+    if (parse_dynamic(o) != 0) return -1;
+    dl->nobjs++;
+    return 0;
+}
+
+int dl_link(struct process* proc, uint32_t dynamic) {
+    struct dl_state* dl = &proc->dl;
+    memset(dl, 0, sizeof(*dl));
+    dl->objs[0].dynamic = dynamic;
+    if (parse_dynamic(&dl->objs[0]) != 0) return -1;
+    dl->nobjs = 1;
+
+    /* Breadth first over DT_NEEDED, so the search order is the load order. */
+    for (uint32_t i = 0; i < dl->nobjs; ++i) {
+        const struct dl_object* o = &dl->objs[i];
+        const Elf32_Dyn* d = (const Elf32_Dyn*)o->dynamic;
+        for (int k = 0; k < DL_MAX_DYN && d[k].d_tag != DT_NULL; ++k) {
+            if (d[k].d_tag != DT_NEEDED) continue;
+            const char* name = user_str(o->strtab + d[k].d_val);
+            if (!name) return -1;
+            if (loaded(dl, name)) continue;
+            if (load_needed(proc, name) != 0) return -1;
+        }
+    }
+
+    if (map_trampoline() != 0) return -1;
+    for (uint32_t i = dl->nobjs; i-- > 0; ) {
+        if (relocate(proc, i) != 0) return -1;
+    }
+    return 0;
+}
+
+uint32_t dl_resolve(struct process* proc, uint32_t obj, uint32_t reloc_off) {
+    if (!proc || obj >= proc->dl.nobjs) return 0;
+    const struct dl_object* o = &proc->dl.objs[obj];
+    if (reloc_off % sizeof(Elf32_Rel) || reloc_off >= o->pltrelsz) return 0;
+    if (!user_range_ok(o->jmprel + reloc_off, sizeof(Elf32_Rel))) return 0;
+    const Elf32_Rel* r = (const Elf32_Rel*)(o->jmprel + reloc_off);
+    uint32_t where = r->r_offset + o->bias;
+    if (!user_writable(proc, where, 4) || ELF32_R_TYPE(r->r_info) != R_386_JMP_SLOT) return 0;
+    uint32_t s = resolve_sym(&proc->dl, o, ELF32_R_SYM(r->r_info));
+    if (s == 0 || s == 0xFFFFFFFFu) return 0;
+    *(uint32_t*)where = s;
+    return s;
+}
@@ -3,12 +3,30 @@
 #include <kernel/bootinfo.h>
 #include <kernel/vmm.h>
 #include <kernel/pmm.h>
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/process.h>
+#include <kernel/mmap.h>
+#include <kernel/elfcache.h>
+#include <kernel/dynlink.h>
+#include <kernel/systrace.h>
+#include <kernel/pagecache.h>
+#include <kernel/cpu.h>
 #include <kernel/stdio.h>
+#include <kernel/klog.h>
 #include <stdint.h>
 #include <string.h>
 
 extern void enter_user_mode(void* entry, uint32_t user_stack);
 
+#define ELF_USER_TOP  0xC0000000u
+
+static inline uint32_t read_cr3(void) {
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3,%0":"=r"(cr3));
+    return cr3;
+}
+
 static int map_user_range(uint32_t va_start, uint32_t size, const uint8_t* src, uint32_t src_len) {
     uint32_t page = va_start & ~0xFFFu;
     uint32_t end  = (va_start + size + 0xFFFu) & ~0xFFFu;
@@ -16,26 +34,22 @@ static int map_user_range(uint32_t va_start, uint32_t size, const uint8_t* src,
         uint32_t phys = pmm_alloc_frame();
         if (!phys) return -1;
         if (vmm_map(a, phys, PAGE_WRITE|PAGE_USER) != 0) return -2;
-        /* zero page */
-        uint8_t* vp = (uint8_t*)a;
-        for (int i=0;i<4096;i++) vp[i]=0;
+        memset((void*)a, 0, 4096);
     }
     /* copy in file portion */
-    if (src && src_len) {
-        for (uint32_t i=0; i<src_len; ++i) ((uint8_t*)(va_start))[i] = src[i];
-    }
+    if (src && src_len) memcpy((void*)va_start, src, src_len);
     return 0;
 }
 
 int elf_run_first_module(void) {
     void* img; uint32_t size;
     int r = bootinfo_first_module(&img, &size);
-    if (r != 0) { printf("no module: %d\n", r); return r; }
-    if (size < sizeof(Elf32_Ehdr)) { printf("module too small\n"); return -10; }
+    if (r != 0) { klog(KLOG_ELF, KLOG_ERR, "no module: %d\n", r); return r; }
+    if (size < sizeof(Elf32_Ehdr)) { klog(KLOG_ELF, KLOG_ERR, "module too small\n"); return -10; }
     Elf32_Ehdr* eh = (Elf32_Ehdr*)img;
-    if (!(eh->e_ident[0]==0x7F && eh->e_ident[1]=='E' && eh->e_ident[2]=='L' && eh->e_ident[3]=='F')) { printf("not ELF\n"); return -11; }
-    if (eh->e_machine != 3 /* EM_386 */) { printf("bad machine\n"); return -12; }
-    if (eh->e_phoff == 0 || eh->e_phnum == 0) { printf("no phdrs\n"); return -13; }
+    if (!(eh->e_ident[0]==0x7F && eh->e_ident[1]=='E' && eh->e_ident[2]=='L' && eh->e_ident[3]=='F')) { klog(KLOG_ELF, KLOG_ERR, "not ELF\n"); return -11; }
+    if (eh->e_machine != 3 /* EM_386 */) { klog(KLOG_ELF, KLOG_ERR, "bad machine\n"); return -12; }
+    if (eh->e_phoff == 0 || eh->e_phnum == 0) { klog(KLOG_ELF, KLOG_ERR, "no phdrs\n"); return -13; }
     /* map all PT_LOAD segments */
     uint32_t first_load_vaddr = 0;
     for (uint16_t i=0;i<eh->e_phnum;i++) {
@@ -45,7 +59,7 @@ int elf_run_first_module(void) {
         const uint8_t* src = (uint8_t*)img + ph->p_offset;
         uint32_t src_len = ph->p_filesz;
         int mr = map_user_range(ph->p_vaddr, ph->p_memsz, src, src_len);
-        if (mr != 0) { printf("map seg fail %d\n", mr); return -20; }
+        if (mr != 0) { klog(KLOG_ELF, KLOG_ERR, "map seg fail %d\n", mr); return -20; }
         if (!first_load_vaddr) first_load_vaddr = ph->p_vaddr;
     }
     /* map a user stack (16 KiB) */
@@ -57,7 +71,7 @@ int elf_run_first_module(void) {
     }
     uint32_t entry = eh->e_entry;
     if (!entry) entry = first_load_vaddr ? first_load_vaddr : 0x00410000u;
-    printf("ELF entry=0x%x\n", entry);
+    klog(KLOG_ELF, KLOG_DEBUG, "ELF entry=0x%x\n", entry);
     (void)run_user_and_wait((void*)(uintptr_t)entry, USTACK_BASE + 4*4096);
     return 0;
 }
@@ -78,11 +92,11 @@ int elf_run_module_by_name(const char* name) {
         if (bootinfo_get_module(i, &img, &size, &nm) != 0) continue;
         if (nm && name_match(nm, name)==0) {
             /* Treat this image like first_module path, but use this img/size */
-            if (size < sizeof(Elf32_Ehdr)) { printf("module too small\n"); return -10; }
+            if (size < sizeof(Elf32_Ehdr)) { klog(KLOG_ELF, KLOG_ERR, "module too small\n"); return -10; }
             Elf32_Ehdr* eh = (Elf32_Ehdr*)img;
-            if (!(eh->e_ident[0]==0x7F && eh->e_ident[1]=='E' && eh->e_ident[2]=='L' && eh->e_ident[3]=='F')) { printf("not ELF\n"); return -11; }
-            if (eh->e_machine != 3) { printf("bad machine\n"); return -12; }
-            if (eh->e_phoff == 0 || eh->e_phnum == 0) { printf("no phdrs\n"); return -13; }
+            if (!(eh->e_ident[0]==0x7F && eh->e_ident[1]=='E' && eh->e_ident[2]=='L' && eh->e_ident[3]=='F')) { klog(KLOG_ELF, KLOG_ERR, "not ELF\n"); return -11; }
+            if (eh->e_machine != 3) { klog(KLOG_ELF, KLOG_ERR, "bad machine\n"); return -12; }
+            if (eh->e_phoff == 0 || eh->e_phnum == 0) { klog(KLOG_ELF, KLOG_ERR, "no phdrs\n"); return -13; }
             uint32_t first_load_vaddr = 0;
             for (uint16_t j=0;j<eh->e_phnum;j++) {
                 Elf32_Phdr* ph = (Elf32_Phdr*)((uint8_t*)img + eh->e_phoff + j*eh->e_phentsize);
@@ -91,147 +105,276 @@ int elf_run_module_by_name(const char* name) {
                 const uint8_t* src = (uint8_t*)img + ph->p_offset;
                 uint32_t src_len = ph->p_filesz;
                 int mr = map_user_range(ph->p_vaddr, ph->p_memsz, src, src_len);
-                if (mr != 0) { printf("map seg fail %d\n", mr); return -20; }
+                if (mr != 0) { klog(KLOG_ELF, KLOG_ERR, "map seg fail %d\n", mr); return -20; }
                 if (!first_load_vaddr) first_load_vaddr = ph->p_vaddr;
             }
             /* stack */
             const uint32_t USTACK_BASE = 0x00400000u;
             for (int s=0;s<4;s++) { uint32_t phys = pmm_alloc_frame(); if (!phys) return -30; if (vmm_map(USTACK_BASE + s*4096, phys, PAGE_WRITE|PAGE_USER) != 0) return -31; uint8_t* p=(uint8_t*)(USTACK_BASE + s*4096); for(int k=0;k<4096;k++) p[k]=0; }
             uint32_t entry = eh->e_entry; if (!entry) entry = first_load_vaddr ? first_load_vaddr : 0x00410000u;
-            printf("ELF entry=0x%x\n", entry);
+            klog(KLOG_ELF, KLOG_DEBUG, "ELF entry=0x%x\n", entry);
             (void)run_user_and_wait((void*)(uintptr_t)entry, USTACK_BASE + 4*4096);
             return 0;
         }
     }
-    printf("no module by name: %s\n", name);
+    klog(KLOG_ELF, KLOG_ERR, "no module by name: %s\n", name);
     return -1;
 }
 
-/* New function: Load and run ELF from filesystem */
-int elf_run_from_filesystem(const char* path) {
-    extern int fs_open(const char* path);
-    extern int fs_read(int fd, void* buf, unsigned len);
-    extern int fs_close(int fd);
-    
-    printf("Loading ELF from filesystem: %s\n", path);
-    
-    /* Open the file */
-    int fd = fs_open(path);
-    if (fd < 0) {
-        printf("Failed to open: %s (fd=%d)\n", path, fd);
-        return -1;
+struct load_stats {
+    uint32_t shared_pages;   /* mapped from the page cache */
+    uint32_t prefaulted;     /* of those, already cached and mapped at exec */
+    uint32_t private_pages;  /* allocated and filled now */
+};
+
+/* Load one PT_LOAD segment. Pages wholly covered by file data become a
+   private file mapping: read faults map the page-cache frame itself, so
+   every process running the same executable shares it, and a write fault
+   (data segments only) takes a copy. The remaining pages (partial first or
+   last page, bss) get fresh frames; their file bytes are streamed straight
+   in and only the rest is zeroed. A page already mapped by an earlier
+   segment of this image (text and data sharing a page) is reused. */
+static int load_segment(process_t* proc, struct vfs_file* f, const Elf32_Phdr* ph, uint32_t bias,
+                        struct load_stats* st) {
+    uint32_t va = ph->p_vaddr + bias;
+    uint32_t file_end = va + ph->p_filesz;
+    uint32_t mem_end = va + ph->p_memsz;
+
+    /* Shareable run of whole pages: needs the file and memory offsets to be
+       congruent modulo the page size and a backend that exposes its cache. */
+    uint32_t share_lo = (va + 0xFFFu) & ~0xFFFu;
+    uint32_t share_hi = file_end & ~0xFFFu;
+    if (!f->inode->fops->get_page || ((va - ph->p_offset) & 0xFFFu) || share_hi <= share_lo) {
+        share_lo = share_hi = 0;
+    } else {
+        uint32_t prot = PROT_READ;
+        if (ph->p_flags & PF_W) prot |= PROT_WRITE;
+        if (ph->p_flags & PF_X) prot |= PROT_EXEC;
+        uint32_t pgoff = (ph->p_offset + (share_lo - va)) / 4096;
+        if (mmap_add_vma(proc, share_lo, share_hi, prot, MAP_PRIVATE, f->inode, pgoff) != 0) {
+            share_lo = share_hi = 0; /* out of VMA slots: load it all eagerly */
+        } else {
+            st->shared_pages += (share_hi - share_lo) / 4096;
+            /* Map what is already cached now rather than take a fault per
+               page; the rest faults in on first touch. */
+            for (uint32_t page = share_lo; page < share_hi; page += 4096) {
+                uint32_t phys = pagecache_peek(f->inode, pgoff + (page - share_lo) / 4096);
+                if (!phys) continue;
+                pmm_ref_frame(phys);
+                if (vmm_map(page, phys, PAGE_USER) != 0) { pmm_unref_frame(phys); continue; }
+                st->prefaulted++;
+            }
+        }
+    }
+
+    for (uint32_t page = va & ~0xFFFu; page < mem_end; page += 4096) {
+        if (page >= share_lo && page < share_hi) continue;
+        uint8_t* vp = (uint8_t*)page;
+        /* File-backed slice of this page: [lo, hi) as page offsets. */
+        uint32_t lo = (va > page) ? va - page : 0;
+        uint32_t hi = (file_end > page) ? file_end - page : 0;
+        if (hi > 4096) hi = 4096;
+        if (hi < lo) hi = lo;
+
+        if (!(vmm_get_pte(page) & PAGE_USER)) {
+            uint32_t phys = pmm_alloc_frame();
+            if (!phys) return -2;
+            if (vmm_map(page, phys, PAGE_WRITE|PAGE_USER) != 0) { pmm_free_frame(phys); return -2; }
+            memset(vp, 0, lo);
+            memset(vp + hi, 0, 4096 - hi);
+            st->private_pages++;
+        } else {
+            /* Shared with the previous segment: clear only our bss. */
+            uint32_t bss_lo = hi;
+            uint32_t bss_hi = (mem_end - page < 4096) ? mem_end - page : 4096;
+            if (bss_hi > bss_lo) memset(vp + bss_lo, 0, bss_hi - bss_lo);
+        }
+        if (hi > lo) {
+            uint32_t off = ph->p_offset + (page + lo - va);
+            if (vfs_pread(f, vp + lo, hi - lo, off) != (int)(hi - lo)) return -3;
+        }
     }
-    
-    printf("Opened file, fd=%d\n", fd);
-    
-    /* Allocate a temporary buffer for the ELF file (max 64KB) */
-    #define MAX_ELF_SIZE (64*1024)
-    static uint8_t elf_buffer[MAX_ELF_SIZE];
-    
-    /* Read the entire file */
-    int total_read = 0;
-    while (total_read < MAX_ELF_SIZE) {
-        int n = fs_read(fd, elf_buffer + total_read, MAX_ELF_SIZE - total_read);
-        printf("fs_read returned %d bytes (total so far: %d)\n", n, total_read + (n > 0 ? n : 0));
-        if (n <= 0) break;
-        total_read += n;
-    }
-    fs_close(fd);
-    
-    if (total_read < (int)sizeof(Elf32_Ehdr)) {
-        printf("File too small to be ELF: %d bytes\n", total_read);
+    return 0;
+}
+
+/* Read the ELF and program headers and check every PT_LOAD segment. The
+   result depends only on the file, so it is cached per inode. */
+static int parse_image(struct vfs_file* f, struct elf_image* img) {
+    Elf32_Ehdr eh;
+    if (vfs_pread(f, &eh, sizeof(eh), 0) != (int)sizeof(eh)) {
+        klog(KLOG_ELF, KLOG_ERR, "File too small to be ELF\n");
         return -10;
     }
-    
-    printf("Read %d bytes from %s\n", total_read, path);
-    
-    /* Debug: show first 32 bytes */
-    printf("First 32 bytes: ");
-    for (int i = 0; i < 32 && i < total_read; i++) {
-        printf("%02x ", elf_buffer[i]);
-    }
-    printf("\n");
-    
-    /* Parse and load the ELF */
-    Elf32_Ehdr* eh = (Elf32_Ehdr*)elf_buffer;
-    
-    /* Verify ELF magic */
-    if (!(eh->e_ident[0]==0x7F && eh->e_ident[1]=='E' && 
-          eh->e_ident[2]=='L' && eh->e_ident[3]=='F')) {
-        printf("Not a valid ELF file\n");
+    if (!(eh.e_ident[0]==0x7F && eh.e_ident[1]=='E' &&
+          eh.e_ident[2]=='L' && eh.e_ident[3]=='F')) {
+        klog(KLOG_ELF, KLOG_ERR, "Not a valid ELF file\n");
         return -11;
     }
-    
-    if (eh->e_machine != 3 /* EM_386 */) {
-        printf("Wrong architecture (expected i386)\n");
+    if (eh.e_machine != 3 /* EM_386 */) {
+        klog(KLOG_ELF, KLOG_ERR, "Wrong architecture (expected i386)\n");
         return -12;
     }
-    
-    if (eh->e_phoff == 0 || eh->e_phnum == 0) {
-        printf("No program headers\n");
+    if (eh.e_type != ET_EXEC && eh.e_type != ET_DYN) {
+        klog(KLOG_ELF, KLOG_ERR, "Not an executable or shared object\n");
+        return -14;
+    }
+    if (eh.e_phoff == 0 || eh.e_phnum == 0 || eh.e_phnum > ELF_MAX_PHDRS ||
+        eh.e_phentsize < sizeof(Elf32_Phdr)) {
+        klog(KLOG_ELF, KLOG_ERR, "No usable program headers\n");
         return -13;
     }
-    
-    printf("ELF valid: entry=0x%x, %d program headers\n", eh->e_entry, eh->e_phnum);
-    
-    /* Map all PT_LOAD segments */
-    uint32_t first_load_vaddr = 0;
-    for (uint16_t i = 0; i < eh->e_phnum; i++) {
-        Elf32_Phdr* ph = (Elf32_Phdr*)(elf_buffer + eh->e_phoff + i * eh->e_phentsize);
-        
-        if (ph->p_type != PT_LOAD) continue;
-        if (ph->p_memsz == 0) continue;
-        
-        printf("Loading segment %d: vaddr=0x%x memsz=%u filesz=%u\n",
-               i, ph->p_vaddr, ph->p_memsz, ph->p_filesz);
-        
-        const uint8_t* src = elf_buffer + ph->p_offset;
-        uint32_t src_len = ph->p_filesz;
-        
-        int mr = map_user_range(ph->p_vaddr, ph->p_memsz, src, src_len);
+
+    memset(img, 0, sizeof(*img));
+    img->type = eh.e_type;
+    uint32_t size = f->inode->size;
+    for (uint16_t i = 0; i < eh.e_phnum; i++) {
+        Elf32_Phdr ph;
+        uint32_t off = eh.e_phoff + (uint32_t)i * eh.e_phentsize;
+        if (vfs_pread(f, &ph, sizeof(ph), off) != (int)sizeof(ph)) {
+            klog(KLOG_ELF, KLOG_ERR, "Truncated program header %d\n", i);
+            return -13;
+        }
+        if (ph.p_type == PT_INTERP) img->interp = 1;
+        if (ph.p_type == PT_DYNAMIC) img->dynamic = ph.p_vaddr;
+        if (ph.p_type != PT_LOAD || ph.p_memsz == 0) continue;
+        uint32_t mem_end = ph.p_vaddr + ph.p_memsz;
+        if (ph.p_filesz > ph.p_memsz || mem_end < ph.p_vaddr || mem_end > ELF_USER_TOP ||
+            ph.p_vaddr < 0x1000u || ph.p_offset > size || ph.p_filesz > size - ph.p_offset) {
+            klog(KLOG_ELF, KLOG_ERR, "Bad segment %d\n", i);
+            return -20;
+        }
+        img->segs[img->nsegs++] = ph;
+        img->file_bytes += ph.p_filesz;
+        img->bss_bytes += ph.p_memsz - ph.p_filesz;
+    }
+
+    img->entry = eh.e_entry;
+    if (!img->entry) img->entry = img->nsegs ? img->segs[0].p_vaddr : 0x00410000u;
+    return 0;
+}
+
+static int load_image(process_t* proc, struct vfs_file* f, const struct elf_image* img, uint32_t bias,
+                      struct load_stats* st) {
+    for (uint32_t i = 0; i < img->nsegs; i++) {
+        int mr = load_segment(proc, f, &img->segs[i], bias, st);
         if (mr != 0) {
-            printf("Failed to map segment %d (error %d)\n", i, mr);
+            klog(KLOG_ELF, KLOG_ERR, "Failed to load segment %u (error %d)\n", i, mr);
             return -20;
         }
-        
-        if (!first_load_vaddr) {
-            first_load_vaddr = ph->p_vaddr;
+    }
+    return 0;
+}
+
+uint32_t elf_load_library(process_t* proc, const char* path, uint32_t bias) {
+    struct vfs_file* f = vfs_open(path, 0);
+    if (!f) return 0xFFFFFFFFu;
+    static struct elf_image lib;  /* exec is not reentrant */
+    int rc = 0;
+    if (f->inode->type != FS_DT_REG) rc = -10;
+    if (rc == 0 && elfcache_lookup(f->inode, &lib) != 0) {
+        rc = parse_image(f, &lib);
+        if (rc == 0) elfcache_insert(f->inode, &lib);
+    }
+    if (rc == 0 && lib.type != ET_DYN) {
+        klog(KLOG_ELF, KLOG_ERR, "Not a shared object: %s\n", path);
+        rc = -14;
+    }
+    struct load_stats st = { 0, 0, 0 };
+    if (rc == 0) rc = load_image(proc, f, &lib, bias, &st);
+    vfs_close(f);
+    if (rc != 0) return 0xFFFFFFFFu;
+    klog(KLOG_ELF, KLOG_DEBUG, "Loaded %s at 0x%x: %u KiB shared via page cache, %u KiB private\n",
+           path, bias, st.shared_pages * 4u, st.private_pages * 4u);
+    return lib.dynamic ? lib.dynamic + bias : 0;
+}
+
+static uint64_t last_load_cycles;
+
+uint64_t elf_last_load_cycles(void) { return last_load_cycles; }
+
+/* Load and run an ELF from the filesystem */
+int elf_run_from_filesystem(const char* path) {
+    struct vfs_file* f = vfs_open(path, 0);
+    if (!f) {
+        klog(KLOG_ELF, KLOG_ERR, "Failed to open: %s\n", path);
+        return -1;
+    }
+    if (f->inode->type != FS_DT_REG) {
+        vfs_close(f);
+        klog(KLOG_ELF, KLOG_ERR, "Not a regular file: %s\n", path);
+        return -10;
+    }
+
+    int pid = process_create(0);
+    process_t* proc = pid < 0 ? 0 : process_find(pid);
+    if (!proc) {
+        vfs_close(f);
+        klog(KLOG_ELF, KLOG_ERR, "Failed to create process\n");
+        return -1;
+    }
+    proc->page_dir = read_cr3(); /* so a failed load is unmapped on destroy */
+
+    static struct elf_image img;  /* exec is not reentrant */
+    struct load_stats st = { 0, 0, 0 };
+    uint64_t t0 = rdtsc();
+    int cached = elfcache_lookup(f->inode, &img) == 0;
+    int rc = 0;
+    if (!cached) {
+        rc = parse_image(f, &img);
+        if (rc == 0) elfcache_insert(f->inode, &img);
+    }
+    if (rc == 0 && img.type != ET_EXEC) {
+        klog(KLOG_ELF, KLOG_ERR, "Not an executable (shared object?): %s\n", path);
+        rc = -14;
+    }
+    if (rc == 0) rc = load_image(proc, f, &img, 0, &st);
+    last_load_cycles = rdtsc() - t0;
+    vfs_close(f);
+    if (rc != 0) {
+        process_destroy(pid);
+        return rc;
+    }
+    uint32_t entry = img.entry;
+    systrace_on_exec(proc);
+    if (img.dynamic) {
+        /* Relocation writes fault pages in, which needs proc current. */
+        int prev = process_get_current_pid();
+        uint32_t dynamic = img.dynamic;
+        process_set_current(pid);
+        rc = dl_link(proc, dynamic);
+        process_set_current(prev);
+        if (rc != 0) {
+            klog(KLOG_ELF, KLOG_ERR, "Dynamic linking failed: %s\n", path);
+            process_destroy(pid);
+            return -40;
         }
     }
-    
+    /* Shared pages cost nothing for each further instance until written. */
+    klog(KLOG_ELF, KLOG_DEBUG, "Loaded %s%s: entry=0x%x, %u KiB shared via page cache (%u KiB already cached), %u KiB private\n",
+           path, cached ? " (cached layout)" : "", entry, st.shared_pages * 4u,
+           st.prefaulted * 4u, st.private_pages * 4u);
+
     /* Map user stack (16 KiB at 0x400000) */
     const uint32_t USTACK_BASE = 0x00400000u;
     for (int i = 0; i < 4; i++) {
         uint32_t phys = pmm_alloc_frame();
         if (!phys) {
-            printf("Failed to allocate stack frame\n");
+            klog(KLOG_ELF, KLOG_ERR, "Failed to allocate stack frame\n");
+            process_destroy(pid);
             return -30;
         }
-        
         if (vmm_map(USTACK_BASE + i*4096, phys, PAGE_WRITE|PAGE_USER) != 0) {
-            printf("Failed to map stack\n");
+            klog(KLOG_ELF, KLOG_ERR, "Failed to map stack\n");
+            pmm_free_frame(phys);
+            process_destroy(pid);
             return -31;
         }
-        
-        /* Zero the stack page */
-        uint8_t* p = (uint8_t*)(USTACK_BASE + i*4096);
-        for (int j = 0; j < 4096; j++) {
-            p[j] = 0;
-        }
-    }
-    
-    /* Determine entry point */
-    uint32_t entry = eh->e_entry;
-    if (!entry) {
-        entry = first_load_vaddr ? first_load_vaddr : 0x00410000u;
+        memset((void*)(USTACK_BASE + i*4096), 0, 4096);
     }
-    
-    printf("Starting ELF at entry=0x%x, stack=0x%x\n", entry, USTACK_BASE + 4*4096);
-    
+
     /* Run the program */
-    (void)run_user_and_wait((void*)(uintptr_t)entry, USTACK_BASE + 4*4096);
-    
+    (void)run_process_and_wait(pid, (void*)(uintptr_t)entry, USTACK_BASE + 4*4096);
+
     printf("Program exited\n");
     return 0;
 }
-
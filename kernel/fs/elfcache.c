@@ -0,0 +1,75 @@
+#include <kernel/elfcache.h>
+#include <kernel/vfs.h>
+#include <string.h>
+
+/* Small fully associative table with LRU replacement; exec is rare enough
+   that a linear scan costs nothing next to the page mapping it saves. */
+
+struct elfcache_ent {
+    uint32_t dev, ino, mtime, size;   /* dev == 0: unused */
+    uint32_t last_use;
+    struct elf_image img;
+};
+
+static struct elfcache_ent cache[ELFCACHE_MAX];
+static uint32_t use_clock;
+static struct elfcache_stats stats = { 0, ELFCACHE_MAX, 0, 0, 0 };
+
+static struct elfcache_ent* find(uint32_t dev, uint32_t ino) {
+    if (!dev) return 0; /* no device: never cached */
+    for (int i = 0; i < ELFCACHE_MAX; ++i) {
+        if (cache[i].dev == dev && cache[i].ino == ino) return &cache[i];
+    }
+    return 0;
+}
+
+static void drop(struct elfcache_ent* e) {
+    e->dev = 0;
+    stats.entries--;
+}
+
+int elfcache_lookup(struct vfs_inode* inode, struct elf_image* out) {
+    struct elfcache_ent* e = find(inode->sb->dev, inode->ino);
+    if (e && (e->mtime != inode->mtime || e->size != inode->size)) {
+        drop(e);
+        stats.stale++;
+        e = 0;
+    }
+    if (!e) { stats.misses++; return -1; }
+    e->last_use = ++use_clock;
+    memcpy(out, &e->img, sizeof(*out));
+    stats.hits++;
+    return 0;
+}
+
+void elfcache_insert(struct vfs_inode* inode, const struct elf_image* img) {
+    struct elfcache_ent* e = find(inode->sb->dev, inode->ino);
+    if (!e) {
+        for (int i = 0; i < ELFCACHE_MAX; ++i) {
+            if (!cache[i].dev) { e = &cache[i]; break; }
+            if (!e || cache[i].last_use < e->last_use) e = &cache[i];
+        }
+        if (!e->dev) stats.entries++;
+    }
+    e->dev = inode->sb->dev;
+    e->ino = inode->ino;
+    e->mtime = inode->mtime;
+    e->size = inode->size;
+    e->last_use = ++use_clock;
+    memcpy(&e->img, img, sizeof(*img));
+}
+
+void elfcache_forget(uint32_t dev, uint32_t ino) {
+    struct elfcache_ent* e = find(dev, ino);
+    if (e) drop(e);
+}
+
+void elfcache_flush(void) {
+    for (int i = 0; i < ELFCACHE_MAX; ++i) {
+        if (cache[i].dev) drop(&cache[i]);
+    }
+}
+
+void elfcache_get_stats(struct elfcache_stats* out) {
+    *out = stats;
+}
@@ -0,0 +1,128 @@
+/* execbench - exec latency for 32 KiB, 1 MiB and 8 MiB executables, and
+ * cold versus repeat exec of one program (execbench PATH [N]).
+ * Each image is a synthetic ELF in /tmp: one PT_LOAD segment of the target
+ * size whose first bytes are a stub that calls exit(0). The files are
+ * sparse (header page plus last byte), so even the 8 MiB case fits next
+ * to a 4 MiB root filesystem. Whole pages of the image are mapped from the
+ * page cache on first touch, so "load" is the eager part of exec only and
+ * "exec" includes the faults the stub takes.
+ */
+
+#include <kernel/elf.h>
+#include <kernel/elfcache.h>
+#include <kernel/pagecache.h>
+#include <kernel/vfs.h>
+#include <kernel/pit.h>
+#include <kernel/vdso.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+#define EXECBENCH_PATH  "/tmp/execbench.elf"
+#define EXECBENCH_VADDR 0x00410000u
+
+static const struct { uint32_t size; unsigned runs; const char* label; } sizes[] = {
+    { 32u * 1024u,        8, "32 KiB" },
+    { 1024u * 1024u,      4, "1 MiB" },
+    { 8u * 1024u * 1024u, 2, "8 MiB" },
+};
+
+static int write_image(uint32_t size) {
+    /* exit(0): mov $2,%eax; xor %ebx,%ebx; int $0x80; hlt */
+    static const uint8_t stub[] = { 0xB8, 0x02, 0x00, 0x00, 0x00, 0x31, 0xDB, 0xCD, 0x80, 0xF4 };
+    uint8_t hdr[sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr) + sizeof(stub)];
+    memset(hdr, 0, sizeof(hdr));
+    Elf32_Ehdr* eh = (Elf32_Ehdr*)hdr;
+    Elf32_Phdr* ph = (Elf32_Phdr*)(hdr + sizeof(Elf32_Ehdr));
+    eh->e_ident[0] = 0x7F; eh->e_ident[1] = 'E'; eh->e_ident[2] = 'L'; eh->e_ident[3] = 'F';
+    eh->e_ident[4] = 1;                 /* ELFCLASS32 */
+    eh->e_ident[5] = 1;                 /* little endian */
+    eh->e_ident[6] = 1;
+    eh->e_type = 2;                     /* ET_EXEC */
+    eh->e_machine = 3;                  /* EM_386 */
+    eh->e_version = 1;
+    eh->e_entry = EXECBENCH_VADDR + sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr);
+    eh->e_phoff = sizeof(Elf32_Ehdr);
+    eh->e_ehsize = sizeof(Elf32_Ehdr);
+    eh->e_phentsize = sizeof(Elf32_Phdr);
+    eh->e_phnum = 1;
+    ph->p_type = PT_LOAD;
+    ph->p_vaddr = ph->p_paddr = EXECBENCH_VADDR;
+    ph->p_filesz = ph->p_memsz = size;
+    ph->p_flags = 5;                    /* R+X */
+    ph->p_align = 4096;
+    memcpy(hdr + sizeof(Elf32_Ehdr) + sizeof(Elf32_Phdr), stub, sizeof(stub));
+
+    struct vfs_file* f = vfs_open(EXECBENCH_PATH, VFS_O_CREAT | VFS_O_TRUNC);
+    if (!f) return -1;
+    uint8_t last = 0;
+    int ok = vfs_pwrite(f, hdr, sizeof(hdr), 0) == (int)sizeof(hdr) &&
+             vfs_pwrite(f, &last, 1, size - 1) == 1;
+    vfs_close(f);
+    return ok ? 0 : -1;
+}
+
+static uint32_t cycles_to_us(uint64_t cycles, uint32_t per_ms) {
+    return per_ms ? (uint32_t)((cycles * 1000u) / per_ms) : 0u;
+}
+
+/* Exec path once with nothing cached (no layout, no file pages), then runs
+   more times warm. */
+void execbench_repeat(const char* path, unsigned runs) {
+    if (runs == 0) runs = 8;
+    uint32_t per_ms = vdso_tsc_per_ms();
+    struct vfs_inode* inode = vfs_lookup(path);
+    if (!inode) { printf("execbench: %s not found\n", path); return; }
+    elfcache_flush();
+    pagecache_drop_inode(inode->sb->dev, inode->ino);
+    vfs_iput(inode);
+
+    struct elfcache_stats before, after;
+    elfcache_get_stats(&before);
+    if (elf_run_from_filesystem(path) != 0) { printf("execbench: exec %s failed\n", path); return; }
+    uint64_t cold = elf_last_load_cycles();
+
+    uint64_t warm = 0;
+    uint64_t t0 = pit_ticks();
+    for (unsigned r = 0; r < runs; ++r) {
+        if (elf_run_from_filesystem(path) != 0) { printf("execbench: exec %s failed\n", path); return; }
+        warm += elf_last_load_cycles();
+    }
+    uint64_t ticks = pit_ticks() - t0;
+    elfcache_get_stats(&after);
+    uint32_t hz = pit_hz();
+    printf("execbench: %s: cold load %u us, warm load %u us, warm exec %u ms (%u runs)\n",
+           path, cycles_to_us(cold, per_ms), cycles_to_us(warm / runs, per_ms),
+           hz ? (uint32_t)((ticks * 1000u) / ((uint64_t)hz * runs)) : 0u, runs);
+    printf("execbench: layout cache %u hits, %u misses during the run\n",
+           after.hits - before.hits, after.misses - before.misses);
+}
+
+void execbench_run(void) {
+    uint32_t per_ms = vdso_tsc_per_ms();
+    printf("execbench: %u TSC cycles/ms\n", per_ms);
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        if (write_image(sizes[i].size) != 0) {
+            printf("execbench: cannot create %s\n", EXECBENCH_PATH);
+            return;
+        }
+        uint64_t load = 0;
+        uint64_t t0 = pit_ticks();
+        for (unsigned r = 0; r < sizes[i].runs; ++r) {
+            if (elf_run_from_filesystem(EXECBENCH_PATH) != 0) {
+                printf("execbench: exec of %s image failed\n", sizes[i].label);
+                vfs_unlink(EXECBENCH_PATH);
+                return;
+            }
+            load += elf_last_load_cycles();
+        }
+        uint64_t ticks = pit_ticks() - t0;
+        uint32_t hz = pit_hz();
+        uint32_t load_us = cycles_to_us(load / sizes[i].runs, per_ms);
+        uint32_t exec_ms = hz ? (uint32_t)((ticks * 1000u) / ((uint64_t)hz * sizes[i].runs)) : 0u;
+        uint32_t kib = sizes[i].size / 1024u;
+        printf("execbench: %s: load %u us (%u KiB/ms), exec %u ms, %u runs\n",
+               sizes[i].label, load_us, load_us ? (kib * 1000u) / load_us : 0u,
+               exec_ms, sizes[i].runs);
+    }
+    vfs_unlink(EXECBENCH_PATH);
+}
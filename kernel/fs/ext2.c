@@ -1,17 +1,31 @@
 #include <kernel/ext2.h>
+#include <kernel/fs.h>
 #include <kernel/stdio.h>
+#include <kernel/klog.h>
 #include <kernel/block.h>
 #include <kernel/kmalloc.h>
+#include <kernel/pagecache.h>
+#include <kernel/vmm.h>
+#include <kernel/vfs.h>
+#include <kernel/pit.h>
 #include <string.h>
 #include <stdint.h>
 #include <stddef.h>
 
-/* Read-only ext2 driver backed by a memory buffer (Multiboot module).
-   Supports: mount, list root directory, open/read/close regular files.
-   Limitations: direct blocks only (no indirect), paths limited to /name (no subdirs). */
+/* ext2 VFS backend over a memory buffer (Multiboot module) or the block
+   device. Supports: lookup through subdirectories, read/write of regular
+   files (growing them block by block), create/unlink/truncate of regular
+   files, and streaming directory entries via getdents. File data is read
+   through the shared page cache; block maps follow single, double and
+   triple indirect blocks (allocation stops at double indirect). */
 
 #define MIN(a,b) ((a)<(b)?(a):(b))
 
+#define EXT2_ROOT_INO 2
+#define EXT2_S_IFMT   0xF000
+#define EXT2_S_IFDIR  0x4000
+#define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002
+
 #pragma pack(push,1)
 struct ext2_super_block {
     uint32_t s_inodes_count;
@@ -107,10 +121,10 @@ static int g_use_disk = 0;
 static uint8_t g_block_cache[EXT2_MAX_BLOCK_SIZE];
 static uint32_t g_block_cache_num = 0xFFFFFFFFu;
 
-/* Simple fd table: map to inode number and file position */
-#define EXT2_MAX_FD 16
-struct ext2_fd { int used; uint32_t ino; uint32_t pos; };
-static struct ext2_fd fds[EXT2_MAX_FD];
+/* Scratch block for bitmap and directory updates (kept off the stack). */
+static uint8_t g_scratch[EXT2_MAX_BLOCK_SIZE];
+
+static struct vfs_super ext2_sb;
 
 static inline uint32_t block_offset_bytes(uint32_t blk) {
     return blk * g_block_size;
@@ -127,7 +141,7 @@ static const uint8_t* get_block(uint32_t blk) {
     if (g_block_cache_num != blk) {
         uint32_t lba = blk * g_sectors_per_block;
         if (block_read(lba, (uint8_t)g_sectors_per_block, g_block_cache) != 0) {
-            printf("ext2: failed to read block %u\n", blk);
+            klog(KLOG_FS, KLOG_ERR, "ext2: failed to read block %u\n", blk);
             return 0;
         }
         g_block_cache_num = blk;
@@ -147,7 +161,7 @@ static int write_block(uint32_t blk, const uint8_t* data) {
     if (g_block_size > EXT2_MAX_BLOCK_SIZE) return -1;
     uint32_t lba = blk * g_sectors_per_block;
     if (block_write(lba, (uint8_t)g_sectors_per_block, data) != 0) {
-        printf("ext2: failed to write block %u\n", blk);
+        klog(KLOG_FS, KLOG_ERR, "ext2: failed to write block %u\n", blk);
         return -1;
     }
     g_block_cache_num = 0xFFFFFFFFu;
@@ -212,19 +226,43 @@ static int read_inode(uint32_t ino, struct ext2_inode* out) {
     return 0;
 }
 
+/* Read entry idx of an indirect block (0 if absent). */
+static uint32_t block_entry(uint32_t blk, uint32_t idx) {
+    uint32_t v = 0;
+    if (!blk || copy_from_block(blk, idx * 4u, &v, sizeof(v)) != 0) return 0;
+    return v;
+}
+
+/* Map a file block index to its on-disk block number (0 = hole). */
+static uint32_t inode_block(const struct ext2_inode* ino, uint32_t index) {
+    uint32_t per = g_block_size / 4u;
+    if (index < 12) return ino->i_block[index];
+    index -= 12;
+    if (index < per) return block_entry(ino->i_block[12], index);
+    index -= per;
+    if (index < per * per) {
+        return block_entry(block_entry(ino->i_block[13], index / per), index % per);
+    }
+    index -= per * per;
+    uint32_t l1 = block_entry(ino->i_block[14], index / (per * per));
+    return block_entry(block_entry(l1, (index / per) % per), index % per);
+}
+
 static int read_file_direct(const struct ext2_inode* ino, uint32_t offset, void* buf, unsigned len) {
     unsigned copied = 0;
     while (len && offset < ino->i_size) {
-        uint32_t blk_index = (offset / g_block_size);
-        if (blk_index >= 12) break; /* only direct blocks */
-        uint32_t blk = ino->i_block[blk_index];
-        const uint8_t* data = get_block(blk);
-        if (!data) break;
+        uint32_t blk = inode_block(ino, offset / g_block_size);
         uint32_t blk_off = offset % g_block_size;
         unsigned n = MIN(len, g_block_size - blk_off);
         unsigned remaining = ino->i_size - offset;
         if (n > remaining) n = remaining;
-        memcpy((uint8_t*)buf + copied, data + blk_off, n);
+        if (blk) {
+            const uint8_t* data = get_block(blk);
+            if (!data) break;
+            memcpy((uint8_t*)buf + copied, data + blk_off, n);
+        } else {
+            memset((uint8_t*)buf + copied, 0, n); /* sparse hole */
+        }
         copied += n;
         offset += n;
         len -= n;
@@ -232,6 +270,22 @@ static int read_file_direct(const struct ext2_inode* ino, uint32_t offset, void*
     return (int)copied;
 }
 
+/* Page cache fill callback: one page of file data, zero past EOF. */
+static int ext2_fill_page(struct vfs_inode* inode, uint32_t index, void* page) {
+    struct ext2_inode rec;
+    if (read_inode(inode->ino, &rec) < 0) return -1;
+    uint32_t off = index * PAGECACHE_PAGE_SIZE;
+    int n = 0;
+    if (off < rec.i_size) {
+        n = read_file_direct(&rec, off, page, PAGECACHE_PAGE_SIZE);
+        if (n < 0) return -1;
+    }
+    memset((uint8_t*)page + n, 0, PAGECACHE_PAGE_SIZE - (uint32_t)n);
+    return 0;
+}
+
+static void ext2_sb_reset(void);
+
 int ext2_mount_from_module(const void* start, uint32_t size) {
     if (!start || size < 2048) return -1;
     g_img = (const uint8_t*)start;
@@ -242,12 +296,12 @@ int ext2_mount_from_module(const void* start, uint32_t size) {
     /* Superblock at offset 1024 */
     memcpy(&sb, g_img + 1024, sizeof(sb));
     if (sb.s_magic != 0xEF53) {
-        printf("ext2: bad magic 0x%x\n", sb.s_magic);
+        klog(KLOG_FS, KLOG_ERR, "ext2: bad magic 0x%x\n", sb.s_magic);
         g_img = 0; g_img_size = 0; g_block_size = 0; g_gdt = 0; return -1;
     }
     g_block_size = 1024u << sb.s_log_block_size;
     if (g_block_size == 0 || g_block_size > EXT2_MAX_BLOCK_SIZE) {
-        printf("ext2: unsupported block size %u\n", g_block_size);
+        klog(KLOG_FS, KLOG_ERR, "ext2: unsupported block size %u\n", g_block_size);
         g_img = 0; g_img_size = 0; g_block_size = 0; g_gdt = 0; return -1;
     }
     g_sectors_per_block = g_block_size / 512;
@@ -260,19 +314,19 @@ int ext2_mount_from_module(const void* start, uint32_t size) {
     uint32_t gdt_off = (g_block_size == 1024) ? (2 * 1024) : g_block_size;
     size_t gdt_bytes = g_groups * sizeof(struct ext2_group_desc);
     if (gdt_off + gdt_bytes > g_img_size) {
-        printf("ext2: truncated group descriptor table\n");
+        klog(KLOG_FS, KLOG_ERR, "ext2: truncated group descriptor table\n");
         g_img = 0; g_img_size = 0; g_block_size = 0; g_gdt = 0; return -1;
     }
     if (g_gdt) { kfree(g_gdt); g_gdt = 0; }
     g_gdt = (struct ext2_group_desc*)kmalloc(gdt_bytes);
     if (!g_gdt) {
-        printf("ext2: failed to allocate GDT\n");
+        klog(KLOG_FS, KLOG_ERR, "ext2: failed to allocate GDT\n");
         g_img = 0; g_img_size = 0; g_block_size = 0; g_gdt = 0; return -1;
     }
     memcpy(g_gdt, g_img + gdt_off, gdt_bytes);
 
-    for (int i=0;i<EXT2_MAX_FD;i++) fds[i].used=0;
-    printf("ext2: mounted (module) block_size=%u inodes=%u groups=%u\n", g_block_size, sb.s_inodes_count, g_groups);
+    ext2_sb_reset();
+    klog(KLOG_FS, KLOG_INFO, "ext2: mounted (module) block_size=%u inodes=%u groups=%u\n", g_block_size, sb.s_inodes_count, g_groups);
     return 0;
 }
 
@@ -281,18 +335,18 @@ int ext2_mount_from_disk(void) {
     g_block_cache_num = 0xFFFFFFFFu;
     uint8_t super_buf[1024];
     if (block_read(2, 2, super_buf) != 0) {
-        printf("ext2: failed to read superblock from disk\n");
+        klog(KLOG_FS, KLOG_ERR, "ext2: failed to read superblock from disk\n");
         return -1;
     }
     memcpy(&sb, super_buf, sizeof(sb));
     if (sb.s_magic != 0xEF53) {
-        printf("ext2: disk magic mismatch 0x%x\n", sb.s_magic);
+        klog(KLOG_FS, KLOG_ERR, "ext2: disk magic mismatch 0x%x\n", sb.s_magic);
         g_block_size = 0;
         return -1;
     }
     g_block_size = 1024u << sb.s_log_block_size;
     if (g_block_size == 0 || g_block_size > EXT2_MAX_BLOCK_SIZE) {
-        printf("ext2: disk block size %u unsupported\n", g_block_size);
+        klog(KLOG_FS, KLOG_ERR, "ext2: disk block size %u unsupported\n", g_block_size);
         g_block_size = 0;
         return -1;
     }
@@ -306,7 +360,7 @@ int ext2_mount_from_disk(void) {
     if (g_gdt) { kfree(g_gdt); g_gdt = 0; }
     g_gdt = (struct ext2_group_desc*)kmalloc(gdt_bytes);
     if (!g_gdt) {
-        printf("ext2: failed to allocate GDT\n");
+        klog(KLOG_FS, KLOG_ERR, "ext2: failed to allocate GDT\n");
         g_block_size = 0;
         return -1;
     }
@@ -318,7 +372,7 @@ int ext2_mount_from_disk(void) {
     while (remaining) {
         size_t chunk = remaining < g_block_size ? remaining : g_block_size;
         if (block_read(gdt_block * g_sectors_per_block, (uint8_t)g_sectors_per_block, temp) != 0) {
-            printf("ext2: failed to read GDT block %u\n", gdt_block);
+            klog(KLOG_FS, KLOG_ERR, "ext2: failed to read GDT block %u\n", gdt_block);
             kfree(g_gdt);
             g_gdt = 0;
             g_block_size = 0;
@@ -336,115 +390,463 @@ int ext2_mount_from_disk(void) {
     g_img_size = 0;
     g_use_disk = 1;
     g_block_cache_num = 0xFFFFFFFFu;
-    for (int i=0;i<EXT2_MAX_FD;i++) fds[i].used=0;
-    printf("ext2: mounted (disk) block_size=%u inodes=%u groups=%u\n", g_block_size, sb.s_inodes_count, g_groups);
+    ext2_sb_reset();
+    klog(KLOG_FS, KLOG_INFO, "ext2: mounted (disk) block_size=%u inodes=%u groups=%u\n", g_block_size, sb.s_inodes_count, g_groups);
     return 0;
 }
 
 int ext2_is_mounted(void){ return g_gdt != 0 && g_block_size != 0; }
+int ext2_on_disk(void){ return ext2_is_mounted() && g_use_disk; }
+
+static uint8_t mode_to_dtype(uint16_t mode) {
+    switch (mode & EXT2_S_IFMT) {
+        case 0x8000: return FS_DT_REG;
+        case 0x4000: return FS_DT_DIR;
+        case 0x2000: return FS_DT_CHR;
+        case 0x6000: return FS_DT_BLK;
+        case 0x1000: return FS_DT_FIFO;
+        case 0xC000: return FS_DT_SOCK;
+        case 0xA000: return FS_DT_LNK;
+        default:     return FS_DT_UNKNOWN;
+    }
+}
+
+static uint32_t ext2_now(void) {
+    uint32_t hz = pit_hz();
+    return hz ? (uint32_t)(pit_ticks() / hz) : 0u;
+}
+
+/* --- Metadata write-back --- */
+
+static int write_inode(uint32_t ino, const struct ext2_inode* rec) {
+    if (ino == 0) return -1;
+    uint32_t idx = ino - 1;
+    uint32_t group = idx / g_inodes_per_group;
+    if (group >= g_groups) return -1;
+    uint32_t off = (idx % g_inodes_per_group) * g_inode_size;
+    uint32_t blk = g_gdt[group].bg_inode_table + off / g_block_size;
+    return copy_to_block(blk, off % g_block_size, rec, sizeof(*rec));
+}
+
+/* Persist one group descriptor and the superblock counters. */
+static void write_group_meta(uint32_t group) {
+    uint32_t gdt_block = (g_block_size == 1024) ? 2 : 1;
+    uint32_t off = group * sizeof(struct ext2_group_desc);
+    copy_to_block(gdt_block + off / g_block_size, off % g_block_size,
+                  &g_gdt[group], sizeof(struct ext2_group_desc));
+    copy_to_block(1024 / g_block_size, 1024 % g_block_size, &sb, sizeof(sb));
+}
+
+/* Find and set the first clear bit of a bitmap block; -1 if full. */
+static int bitmap_claim(uint32_t bitmap_blk, uint32_t nbits) {
+    if (read_block_into(bitmap_blk, g_scratch) != 0) return -1;
+    for (uint32_t i = 0; i < nbits; ++i) {
+        if (g_scratch[i >> 3] & (1u << (i & 7))) continue;
+        g_scratch[i >> 3] |= (uint8_t)(1u << (i & 7));
+        if (write_block(bitmap_blk, g_scratch) != 0) return -1;
+        return (int)i;
+    }
+    return -1;
+}
+
+static int bitmap_release(uint32_t bitmap_blk, uint32_t bit) {
+    if (read_block_into(bitmap_blk, g_scratch) != 0) return -1;
+    g_scratch[bit >> 3] &= (uint8_t)~(1u << (bit & 7));
+    return write_block(bitmap_blk, g_scratch);
+}
+
+/* Allocate a zeroed data block; 0 when the filesystem is full. */
+static uint32_t alloc_block(void) {
+    for (uint32_t g = 0; g < g_groups; ++g) {
+        if (!g_gdt[g].bg_free_blocks_count) continue;
+        uint32_t first = sb.s_first_data_block + g * sb.s_blocks_per_group;
+        uint32_t nbits = sb.s_blocks_per_group;
+        if (first + nbits > sb.s_blocks_count) nbits = sb.s_blocks_count - first;
+        int bit = bitmap_claim(g_gdt[g].bg_block_bitmap, nbits);
+        if (bit < 0) continue;
+        g_gdt[g].bg_free_blocks_count--;
+        if (sb.s_free_blocks_count) sb.s_free_blocks_count--;
+        write_group_meta(g);
+        uint32_t blk = first + (uint32_t)bit;
+        memset(g_scratch, 0, g_block_size);
+        if (write_block(blk, g_scratch) != 0) return 0;
+        return blk;
+    }
+    return 0;
+}
+
+static void free_block(uint32_t blk) {
+    if (!blk || blk < sb.s_first_data_block) return;
+    uint32_t rel = blk - sb.s_first_data_block;
+    uint32_t g = rel / sb.s_blocks_per_group;
+    if (g >= g_groups) return;
+    if (bitmap_release(g_gdt[g].bg_block_bitmap, rel % sb.s_blocks_per_group) != 0) return;
+    g_gdt[g].bg_free_blocks_count++;
+    sb.s_free_blocks_count++;
+    write_group_meta(g);
+}
+
+static uint32_t alloc_inode(void) {
+    uint32_t first_ino = sb.s_rev_level ? sb.s_first_ino : 11;
+    for (uint32_t g = 0; g < g_groups; ++g) {
+        if (!g_gdt[g].bg_free_inodes_count) continue;
+        if (read_block_into(g_gdt[g].bg_inode_bitmap, g_scratch) != 0) continue;
+        for (uint32_t i = 0; i < g_inodes_per_group; ++i) {
+            uint32_t ino = g * g_inodes_per_group + i + 1;
+            if (ino < first_ino || (g_scratch[i >> 3] & (1u << (i & 7)))) continue;
+            g_scratch[i >> 3] |= (uint8_t)(1u << (i & 7));
+            if (write_block(g_gdt[g].bg_inode_bitmap, g_scratch) != 0) return 0;
+            g_gdt[g].bg_free_inodes_count--;
+            if (sb.s_free_inodes_count) sb.s_free_inodes_count--;
+            write_group_meta(g);
+            return ino;
+        }
+    }
+    return 0;
+}
+
+static void free_inode(uint32_t ino) {
+    uint32_t g = (ino - 1) / g_inodes_per_group;
+    if (g >= g_groups) return;
+    if (bitmap_release(g_gdt[g].bg_inode_bitmap, (ino - 1) % g_inodes_per_group) != 0) return;
+    g_gdt[g].bg_free_inodes_count++;
+    sb.s_free_inodes_count++;
+    write_group_meta(g);
+}
+
+/* --- Block maps with allocation --- */
+
+static uint32_t alloc_slot(uint32_t* slot, struct ext2_inode* rec) {
+    if (!*slot) {
+        *slot = alloc_block();
+        if (*slot) rec->i_blocks += g_block_size / 512u;
+    }
+    return *slot;
+}
+
+static uint32_t alloc_entry(uint32_t blk, uint32_t idx, struct ext2_inode* rec) {
+    uint32_t v = block_entry(blk, idx);
+    if (v) return v;
+    v = alloc_block();
+    if (!v) return 0;
+    if (copy_to_block(blk, idx * 4u, &v, sizeof(v)) != 0) { free_block(v); return 0; }
+    rec->i_blocks += g_block_size / 512u;
+    return v;
+}
+
+/* Like inode_block, but allocates missing data and indirect blocks. */
+static uint32_t inode_block_alloc(struct ext2_inode* rec, uint32_t index) {
+    uint32_t per = g_block_size / 4u;
+    if (index < 12) return alloc_slot(&rec->i_block[index], rec);
+    index -= 12;
+    if (index < per) {
+        uint32_t ind = alloc_slot(&rec->i_block[12], rec);
+        return ind ? alloc_entry(ind, index, rec) : 0;
+    }
+    index -= per;
+    if (index < per * per) {
+        uint32_t dind = alloc_slot(&rec->i_block[13], rec);
+        uint32_t ind = dind ? alloc_entry(dind, index / per, rec) : 0;
+        return ind ? alloc_entry(ind, index % per, rec) : 0;
+    }
+    return 0;
+}
+
+static void free_tree(uint32_t blk, int depth) {
+    if (!blk) return;
+    if (depth > 0) {
+        uint32_t per = g_block_size / 4u;
+        for (uint32_t i = 0; i < per; ++i) free_tree(block_entry(blk, i), depth - 1);
+    }
+    free_block(blk);
+}
+
+static void free_all_blocks(struct ext2_inode* rec) {
+    for (int i = 0; i < 12; ++i) free_block(rec->i_block[i]);
+    free_tree(rec->i_block[12], 1);
+    free_tree(rec->i_block[13], 2);
+    free_tree(rec->i_block[14], 3);
+    memset(rec->i_block, 0, sizeof(rec->i_block));
+    rec->i_blocks = 0;
+    rec->i_size = 0;
+}
+
+/* --- Directories --- */
 
-static int path_basename(const char* path, const char** base){
-    if (!path || !*path) return -1;
-    const char* p = path; const char* last = path;
-    while (*p){ if (*p=='/'||*p=='\\') last = p+1; p++; }
-    *base = last; return 0;
-}
-
-int ext2_list(char* out, unsigned len){
-    if (!ext2_is_mounted()) return -1;
-    struct ext2_inode root;
-    if (read_inode(2, &root) < 0) return -1;
-    printf("[ext2_list] root inode: mode=0x%x size=%u blocks=%u\n", root.i_mode, root.i_size, root.i_blocks);
-    printf("[ext2_list] root i_block[0]=0x%x i_block[1]=0x%x\n", root.i_block[0], root.i_block[1]);
-    unsigned n=0;
-    for (int i=0;i<12;i++){
-        uint32_t blk = root.i_block[i]; if (!blk) continue;
+static int lookup_in_dir(const struct ext2_inode* dir, const char* name, unsigned name_len, uint32_t* out_ino){
+    uint32_t nblocks = (dir->i_size + g_block_size - 1) / g_block_size;
+    for (uint32_t i=0;i<nblocks;i++){
+        uint32_t blk = inode_block(dir, i); if (!blk) continue;
         const uint8_t* data = get_block(blk); if (!data) continue;
-        printf("[ext2_list] scanning block %d: blk_num=%u\n", i, blk);
         unsigned off=0;
         while (off + 8 <= g_block_size){
             const struct ext2_dir_entry* de = (const struct ext2_dir_entry*)(data + off);
-            printf("[ext2_list] off=%u: inode=%u rec_len=%u name_len=%u\n", 
-                   off, de->inode, de->rec_len, de->name_len);
             if (de->rec_len < 8 || de->rec_len > g_block_size - off) break;
-            if (de->inode && de->name_len){
-                printf("[ext2_list] found entry: ino=%u name_len=%u\n", de->inode, de->name_len);
-                const char* name = (const char*)de->name;
-                for (int j=0;j<de->name_len && n+1<len; j++) out[n++]=name[j];
-                if (n<len) out[n++]='\n';
+            if (de->inode && de->name_len == name_len && memcmp(de->name, name, name_len)==0) {
+                *out_ino = de->inode; return 0;
             }
-            if (de->rec_len==0) break;
             off += de->rec_len;
         }
-        printf("[ext2_list] returning %u bytes\n", n);
     }
-    return (int)n;
+    return -1;
 }
 
-static int lookup_in_root(const char* name, uint32_t* out_ino){
-    struct ext2_inode root; if (read_inode(2,&root)<0) return -1;
-    for (int i=0;i<12;i++){
-        uint32_t blk = root.i_block[i]; if (!blk) continue;
-        const uint8_t* data = get_block(blk); if (!data) continue;
-        unsigned off=0;
+static inline uint32_t dirent_size(unsigned name_len) { return (8u + name_len + 3u) & ~3u; }
+
+/* Insert an entry, splitting slack in an existing record or growing the
+   directory by one block. */
+static int dir_add(uint32_t dir_ino, const char* name, unsigned len, uint32_t ino, uint8_t ftype){
+    struct ext2_inode dir; if (read_inode(dir_ino,&dir)<0) return -1;
+    int have_ftype = (sb.s_feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE) != 0;
+    uint32_t need = dirent_size(len);
+    uint32_t nblocks = dir.i_size / g_block_size;
+    struct ext2_dir_entry* nd = 0;
+    uint32_t blk = 0;
+    for (uint32_t i=0; i<nblocks && !nd; i++){
+        blk = inode_block(&dir, i); if (!blk) continue;
+        if (read_block_into(blk, g_scratch) != 0) return -1;
+        unsigned off = 0;
         while (off + 8 <= g_block_size){
-            const struct ext2_dir_entry* de = (const struct ext2_dir_entry*)(data + off);
+            struct ext2_dir_entry* de = (struct ext2_dir_entry*)(g_scratch + off);
             if (de->rec_len < 8 || de->rec_len > g_block_size - off) break;
-            if (de->inode && de->name_len){
-                if (de->name_len == strlen(name) && memcmp(de->name, name, de->name_len)==0) { *out_ino = de->inode; return 0; }
+            uint32_t used = de->inode ? dirent_size(de->name_len) : 0;
+            if (de->rec_len >= used + need) {
+                if (used) {
+                    nd = (struct ext2_dir_entry*)(g_scratch + off + used);
+                    nd->rec_len = (uint16_t)(de->rec_len - used);
+                    de->rec_len = (uint16_t)used;
+                } else {
+                    nd = de;
+                }
+                break;
             }
-            if (de->rec_len==0) break;
             off += de->rec_len;
         }
     }
-    return -1;
+    if (!nd) {
+        blk = inode_block_alloc(&dir, nblocks);
+        if (!blk) return -1;
+        memset(g_scratch, 0, g_block_size);
+        nd = (struct ext2_dir_entry*)g_scratch;
+        nd->rec_len = (uint16_t)g_block_size;
+        dir.i_size += g_block_size;
+    }
+    nd->inode = ino;
+    nd->name_len = (uint8_t)len;
+    nd->file_type = have_ftype ? ftype : 0;
+    memcpy(nd->name, name, len);
+    if (write_block(blk, g_scratch) != 0) return -1;
+    dir.i_mtime = dir.i_ctime = ext2_now();
+    return write_inode(dir_ino, &dir);
 }
 
-int ext2_open(const char* path){
-    if (!ext2_is_mounted()) return -1;
-    const char* base; if (path_basename(path,&base)<0) return -1;
-    uint32_t ino; if (lookup_in_root(base,&ino)<0) return -1;
-    /* ensure it's a regular file or dir; for now allow regular files only */
-    struct ext2_inode ino_rec; if (read_inode(ino,&ino_rec)<0) return -1;
-    if ((ino_rec.i_mode & 0xF000) == 0x4000) { /* directory */ return -1; }
-    for (int fd=3; fd<EXT2_MAX_FD; ++fd){ if (!fds[fd].used){ fds[fd].used=1; fds[fd].ino=ino; fds[fd].pos=0; return fd; } }
+/* Remove an entry by merging it into its predecessor (or clearing it when
+   it opens the block). */
+static int dir_remove(uint32_t dir_ino, const char* name, unsigned len){
+    struct ext2_inode dir; if (read_inode(dir_ino,&dir)<0) return -1;
+    uint32_t nblocks = dir.i_size / g_block_size;
+    for (uint32_t i=0; i<nblocks; i++){
+        uint32_t blk = inode_block(&dir, i); if (!blk) continue;
+        if (read_block_into(blk, g_scratch) != 0) return -1;
+        unsigned off = 0;
+        struct ext2_dir_entry* prev = 0;
+        while (off + 8 <= g_block_size){
+            struct ext2_dir_entry* de = (struct ext2_dir_entry*)(g_scratch + off);
+            if (de->rec_len < 8 || de->rec_len > g_block_size - off) break;
+            if (de->inode && de->name_len == len && memcmp(de->name, name, len) == 0) {
+                if (prev) prev->rec_len = (uint16_t)(prev->rec_len + de->rec_len);
+                else de->inode = 0;
+                if (write_block(blk, g_scratch) != 0) return -1;
+                dir.i_mtime = dir.i_ctime = ext2_now();
+                return write_inode(dir_ino, &dir);
+            }
+            prev = de;
+            off += de->rec_len;
+        }
+    }
     return -1;
 }
 
-int ext2_read(int fd, void* buf, unsigned len){
-    if (fd < 0 || fd >= EXT2_MAX_FD || !fds[fd].used) return -1;
-    struct ext2_inode ino; if (read_inode(fds[fd].ino,&ino)<0) return -1;
-    int r = read_file_direct(&ino, fds[fd].pos, buf, len);
-    if (r > 0) fds[fd].pos += (unsigned)r;
-    return r;
+/* --- VFS operations --- */
+
+static int ext2_lookup(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* ino){
+    struct ext2_inode rec; if (read_inode(dir->ino,&rec)<0) return -1;
+    return lookup_in_dir(&rec, name, len, ino);
 }
 
-int ext2_close(int fd){ if (fd<0||fd>=EXT2_MAX_FD||!fds[fd].used) return -1; fds[fd].used=0; return 0; }
+static int ext2_create(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* out_ino){
+    uint32_t existing;
+    if (ext2_lookup(dir, name, len, &existing) == 0) return -1;
+    uint32_t ino = alloc_inode();
+    if (!ino) { klog(KLOG_FS, KLOG_ERR, "ext2: no free inodes\n"); return -1; }
+    struct ext2_inode rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.i_mode = 0x81A4; /* regular, 0644 */
+    rec.i_links_count = 1;
+    rec.i_atime = rec.i_ctime = rec.i_mtime = ext2_now();
+    if (write_inode(ino, &rec) != 0 || dir_add(dir->ino, name, len, ino, FS_DT_REG) != 0) {
+        free_inode(ino);
+        return -1;
+    }
+    *out_ino = ino;
+    return 0;
+}
 
-/* Minimal write support: overwrite existing bytes only (no growth, no allocation). */
-static int write_file_direct(const struct ext2_inode* ino, uint32_t offset, const void* buf, unsigned len){
+static int ext2_unlink(struct vfs_inode* dir, const char* name, unsigned len){
+    uint32_t ino;
+    if (ext2_lookup(dir, name, len, &ino) != 0) return -1;
+    struct ext2_inode rec; if (read_inode(ino,&rec)<0) return -1;
+    if ((rec.i_mode & EXT2_S_IFMT) == EXT2_S_IFDIR) return -1;
+    if (dir_remove(dir->ino, name, len) != 0) return -1;
+    if (rec.i_links_count) rec.i_links_count--;
+    if (rec.i_links_count == 0) {
+        free_all_blocks(&rec);
+        rec.i_dtime = ext2_now();
+        write_inode(ino, &rec);
+        free_inode(ino);
+        return 0;
+    }
+    return write_inode(ino, &rec);
+}
+
+static int ext2_truncate(struct vfs_inode* inode){
+    struct ext2_inode rec; if (read_inode(inode->ino,&rec)<0) return -1;
+    free_all_blocks(&rec);
+    rec.i_mtime = rec.i_ctime = ext2_now();
+    if (write_inode(inode->ino, &rec) != 0) return -1;
+    inode->size = 0;
+    inode->mtime = rec.i_mtime;
+    return 0;
+}
+
+/* Stream directory entries as fs_dirent records. The cookie is the byte
+   offset of the next ext2 entry, so successive calls resume where the
+   previous one stopped. Returns bytes produced, 0 at end, -1 on error. */
+static int ext2_getdents(struct vfs_inode* inode, uint32_t* cookie, void* buf, unsigned len){
+    struct ext2_inode dir; if (read_inode(inode->ino,&dir)<0) return -1;
+    int have_ftype = (sb.s_feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE) != 0;
+    uint8_t* out = (uint8_t*)buf;
+    unsigned n = 0;
+    uint32_t pos = *cookie;
+    while (pos < dir.i_size){
+        uint32_t blk_start = pos - (pos % g_block_size);
+        uint32_t off = pos - blk_start;
+        uint32_t blk = inode_block(&dir, pos / g_block_size);
+        const uint8_t* data = blk ? get_block(blk) : 0;
+        if (!data || off + 8 > g_block_size) { pos = blk_start + g_block_size; continue; }
+        const struct ext2_dir_entry* de = (const struct ext2_dir_entry*)(data + off);
+        if (de->rec_len < 8 || de->rec_len > g_block_size - off) { pos = blk_start + g_block_size; continue; }
+        uint32_t next = pos + de->rec_len;
+        if (de->inode && de->name_len){
+            unsigned reclen = (unsigned)(sizeof(struct fs_dirent) + de->name_len + 1 + 3) & ~3u;
+            if (n + reclen > len) {
+                if (n == 0) return -1; /* buffer cannot hold a single entry */
+                break;
+            }
+            struct fs_dirent* d = (struct fs_dirent*)(out + n);
+            uint32_t ino = de->inode;
+            uint8_t ftype = have_ftype ? de->file_type : FS_DT_UNKNOWN;
+            d->d_ino = ino;
+            d->d_off = next;
+            d->d_reclen = (uint16_t)reclen;
+            d->d_namlen = de->name_len;
+            memcpy(d->d_name, de->name, de->name_len);
+            d->d_name[de->name_len] = 0;
+            /* Old revisions carry no type in the entry; ask the inode (this
+               may evict the cached block, so it runs after the copy). */
+            if (!have_ftype || ftype > FS_DT_LNK) {
+                struct ext2_inode child;
+                ftype = (read_inode(ino,&child) == 0) ? mode_to_dtype(child.i_mode) : FS_DT_UNKNOWN;
+            }
+            d->d_type = ftype;
+            n += reclen;
+        }
+        pos = next;
+    }
+    *cookie = pos;
+    return (int)n;
+}
+
+static int ext2_read(struct vfs_inode* inode, uint32_t pos, void* buf, unsigned len){
+    unsigned copied = 0;
+    while (copied < len && pos < inode->size) {
+        uint32_t phys = pagecache_get(inode, pos / PAGECACHE_PAGE_SIZE, ext2_fill_page);
+        if (!phys) break;
+        uint32_t off = pos % PAGECACHE_PAGE_SIZE;
+        unsigned n = MIN(len - copied, PAGECACHE_PAGE_SIZE - off);
+        if (n > inode->size - pos) n = inode->size - pos;
+        memcpy((uint8_t*)buf + copied, (const uint8_t*)vmm_phys_to_virt(phys) + off, n);
+        copied += n;
+        pos += n;
+    }
+    return (int)copied;
+}
+
+/* Write through to disk, allocating blocks as the file grows. Cached pages
+   are patched in place so readers and shared mappings see the new data. */
+static int ext2_write(struct vfs_inode* inode, uint32_t offset, const void* buf, unsigned len){
+    struct ext2_inode rec; if (read_inode(inode->ino,&rec)<0) return -1;
+    uint32_t old_blocks = rec.i_blocks;
     unsigned written = 0;
-    while (len && offset < ino->i_size) {
-        uint32_t blk_index = (offset / g_block_size);
-        if (blk_index >= 12) break; /* direct only */
-        uint32_t blk = ino->i_block[blk_index];
+    while (written < len) {
+        uint32_t blk = inode_block_alloc(&rec, offset / g_block_size);
         if (!blk) break;
         uint32_t blk_off = offset % g_block_size;
-        unsigned n = MIN(len, g_block_size - blk_off);
-        unsigned remaining = ino->i_size - offset;
-        if (n > remaining) n = remaining;
+        unsigned n = MIN(len - written, g_block_size - blk_off);
         if (copy_to_block(blk, blk_off, (const uint8_t*)buf + written, n) != 0) break;
+        pagecache_update(inode, offset / PAGECACHE_PAGE_SIZE, offset % PAGECACHE_PAGE_SIZE,
+                         (const uint8_t*)buf + written, n);
         written += n;
         offset += n;
-        len -= n;
     }
-    return (int)written;
+    if (offset > rec.i_size || rec.i_blocks != old_blocks || written) {
+        if (offset > rec.i_size) rec.i_size = offset;
+        rec.i_mtime = ext2_now();
+        write_inode(inode->ino, &rec);
+        inode->size = rec.i_size;
+        inode->mtime = rec.i_mtime;
+    }
+    return written ? (int)written : -1;
+}
+
+static uint32_t ext2_get_page(struct vfs_inode* inode, uint32_t index){
+    return pagecache_get(inode, index, ext2_fill_page);
+}
+
+static const struct vfs_inode_ops ext2_iops = {
+    .lookup = ext2_lookup,
+    .create = ext2_create,
+    .unlink = ext2_unlink,
+    .truncate = ext2_truncate,
+};
+
+static const struct vfs_file_ops ext2_fops = {
+    .read = ext2_read,
+    .write = ext2_write,
+    .getdents = ext2_getdents,
+    .get_page = ext2_get_page,
+};
+
+static int ext2_read_inode(struct vfs_super* s, struct vfs_inode* inode){
+    (void)s;
+    struct ext2_inode rec; if (read_inode(inode->ino,&rec)<0) return -1;
+    inode->type = mode_to_dtype(rec.i_mode);
+    inode->size = rec.i_size;
+    inode->mtime = rec.i_mtime;
+    inode->iops = &ext2_iops;
+    inode->fops = &ext2_fops;
+    return 0;
 }
 
-int ext2_write(int fd, const void* buf, unsigned len){
-    if (fd < 0 || fd >= EXT2_MAX_FD || !fds[fd].used) return -1;
-    struct ext2_inode ino; if (read_inode(fds[fd].ino,&ino)<0) return -1;
-    int r = write_file_direct(&ino, fds[fd].pos, buf, len);
-    if (r > 0) fds[fd].pos += (unsigned)r;
-    return r;
+static const struct vfs_super_ops ext2_sops = { .read_inode = ext2_read_inode };
+
+/* (Re)mounting switches the backing store: cached pages are stale. */
+static void ext2_sb_reset(void){
+    if (!ext2_sb.dev) ext2_sb.dev = vfs_alloc_dev();
+    ext2_sb.fstype = "ext2";
+    ext2_sb.root_ino = EXT2_ROOT_INO;
+    ext2_sb.ops = &ext2_sops;
+    pagecache_invalidate_dev(ext2_sb.dev);
 }
+
+struct vfs_super* ext2_super(void){ return ext2_is_mounted() ? &ext2_sb : 0; }
@@ -0,0 +1,102 @@
+#include <kernel/fdtable.h>
+#include <kernel/vfs.h>
+#include <kernel/console.h>
+#include <kernel/kmalloc.h>
+#include <string.h>
+
+static void fdt_reset(struct fd_table* t) {
+    memset(t->inline_files, 0, sizeof(t->inline_files));
+    memset(t->inline_used, 0, sizeof(t->inline_used));
+    t->files = t->inline_files;
+    t->used = t->inline_used;
+    t->size = FDT_INLINE;
+    t->count = 0;
+    t->hint = 0;
+}
+
+void fdt_init(struct fd_table* t) {
+    fdt_reset(t);
+    for (int fd = 0; fd < 3; ++fd) {
+        struct vfs_file* con = console_file();
+        vfs_file_ref(con);
+        fdt_alloc(t, con);
+    }
+}
+
+static int fdt_grow(struct fd_table* t) {
+    if (t->size >= FDT_MAX) return -1;
+    uint32_t size = t->size * 2;
+    struct vfs_file** files = (struct vfs_file**)kcalloc(size, sizeof(*files));
+    uint32_t* used = (uint32_t*)kcalloc(size / 32, sizeof(*used));
+    if (!files || !used) {
+        if (files) kfree(files);
+        if (used) kfree(used);
+        return -1;
+    }
+    memcpy(files, t->files, t->size * sizeof(*files));
+    memcpy(used, t->used, (t->size / 32) * sizeof(*used));
+    if (t->files != t->inline_files) { kfree(t->files); kfree(t->used); }
+    t->files = files;
+    t->used = used;
+    t->size = size;
+    return 0;
+}
+
+int fdt_alloc(struct fd_table* t, struct vfs_file* f) {
+    if (!f) return -1;
+    for (;;) {
+        for (uint32_t w = t->hint; w < t->size / 32; ++w) {
+            if (t->used[w] == 0xFFFFFFFFu) continue;
+            uint32_t bit = (uint32_t)__builtin_ctz(~t->used[w]);
+            uint32_t fd = w * 32 + bit;
+            t->used[w] |= 1u << bit;
+            t->files[fd] = f;
+            t->hint = w;
+            t->count++;
+            return (int)fd;
+        }
+        t->hint = t->size / 32;
+        if (fdt_grow(t) != 0) { vfs_close(f); return -1; }
+    }
+}
+
+struct vfs_file* fdt_get(struct fd_table* t, int fd) {
+    if (!t || fd < 0 || (uint32_t)fd >= t->size) return 0;
+    return t->files[fd];
+}
+
+int fdt_close(struct fd_table* t, int fd) {
+    struct vfs_file* f = fdt_get(t, fd);
+    if (!f) return -1;
+    t->files[fd] = 0;
+    t->used[fd / 32] &= ~(1u << (fd % 32));
+    if ((uint32_t)fd / 32 < t->hint) t->hint = (uint32_t)fd / 32;
+    t->count--;
+    return vfs_close(f);
+}
+
+void fdt_close_all(struct fd_table* t) {
+    if (!t->files) return;
+    for (uint32_t fd = 0; fd < t->size && t->count; ++fd) {
+        if (t->files[fd]) fdt_close(t, (int)fd);
+    }
+    if (t->files != t->inline_files) { kfree(t->files); kfree(t->used); }
+    fdt_reset(t);
+}
+
+int fdt_clone(struct fd_table* dst, const struct fd_table* src) {
+    fdt_close_all(dst);
+    while (dst->size < src->size) {
+        if (fdt_grow(dst) != 0) return -1;
+    }
+    for (uint32_t fd = 0; fd < src->size; ++fd) {
+        struct vfs_file* f = src->files[fd];
+        if (!f) continue;
+        vfs_file_ref(f);
+        dst->files[fd] = f;
+        dst->used[fd / 32] |= 1u << (fd % 32);
+        dst->count++;
+    }
+    dst->hint = src->hint;
+    return 0;
+}
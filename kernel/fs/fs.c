@@ -5,13 +5,30 @@
 #include <string.h>
 #include <stdint.h>
 #include <kernel/ext2.h>
+#include <kernel/tmpfs.h>
+#include <kernel/devfs.h>
+#include <kernel/vfs.h>
+#include <kernel/fdtable.h>
+#include <kernel/pipe.h>
+#include <kernel/process.h>
 
-/* 
- * Simplified filesystem layer: ext2 ONLY.
- * All operations delegate directly to ext2 driver.
- * Read and write operations are supported.
+/*
+ * Filesystem front end: mounts ext2 at "/", tmpfs at "/tmp" and devfs at
+ * "/dev" in the VFS and maps the small integer fds used by syscalls onto VFS
+ * open files via the current process's fd table (the kernel shell has its
+ * own).
  */
 
+static struct fd_table kernel_fdt;
+static int kernel_fdt_ready = 0;
+
+static struct fd_table* cur_fdt(void) {
+    process_t* p = process_current();
+    if (p) return &p->fdt;
+    if (!kernel_fdt_ready) { fdt_init(&kernel_fdt); kernel_fdt_ready = 1; }
+    return &kernel_fdt;
+}
+
 static int copy_module_to_disk(const uint8_t* data, uint32_t size) {
     if (!data || !size) return -1;
     uint32_t sectors = (size + 511u) / 512u;
@@ -88,42 +105,126 @@ void fs_init(void) {
 
     if (!mounted) {
         printf("fs: WARNING - no ext2 filesystem found!\n");
+    } else {
+        vfs_mount("/", ext2_super());
     }
+    vfs_mount("/tmp", tmpfs_create_super());
+    vfs_mount("/dev", devfs_create_super());
+}
+
+static struct vfs_file* fd_file(int fd) {
+    return fdt_get(cur_fdt(), fd);
 }
 
-void fs_list_print(void) {
-    if (!ext2_is_mounted()) {
-        printf("(no filesystem mounted)\n");
+static int fd_install(struct vfs_file* f) {
+    return fdt_alloc(cur_fdt(), f);
+}
+
+void fs_list_print(const char* path) {
+    struct vfs_file* f = vfs_open(path && *path ? path : "/", 0);
+    if (!f) {
+        printf("ls: cannot open %s\n", path ? path : "/");
         return;
     }
-    char buf[512];
-    int m = ext2_list(buf, sizeof(buf)-1);
-    if (m < 0) m = 0;
-    buf[m] = 0;
-    printf("%s", buf);
+    uint32_t buf[128];
+    int n;
+    while ((n = vfs_getdents(f, buf, sizeof(buf))) > 0) {
+        for (int off = 0; off < n; ) {
+            const struct fs_dirent* d = (const struct fs_dirent*)((const uint8_t*)buf + off);
+            printf("%s%s\n", d->d_name, d->d_type == FS_DT_DIR ? "/" : "");
+            off += d->d_reclen;
+        }
+    }
+    vfs_close(f);
 }
 
 int fs_dump_list(char* buf, unsigned len) {
-    if (!ext2_is_mounted()) return 0;
-    return ext2_list(buf, len);
+    struct vfs_file* f = vfs_open("/", 0);
+    if (!f) return 0;
+    uint32_t ents[64];
+    unsigned n = 0;
+    int got;
+    while ((got = vfs_getdents(f, ents, sizeof(ents))) > 0) {
+        for (int off = 0; off < got; ) {
+            const struct fs_dirent* d = (const struct fs_dirent*)((const uint8_t*)ents + off);
+            for (unsigned j = 0; j < d->d_namlen && n + 1 < len; j++) buf[n++] = d->d_name[j];
+            if (n < len) buf[n++] = '\n';
+            off += d->d_reclen;
+        }
+    }
+    vfs_close(f);
+    return (int)n;
+}
+
+int fs_getdents(int fd, void* buf, unsigned len) {
+    return vfs_getdents(fd_file(fd), buf, len);
 }
 
 int fs_open(const char* name) {
-    if (!ext2_is_mounted()) return -1;
-    return ext2_open(name);
+    return fd_install(vfs_open(name, 0));
+}
+
+int fs_create(const char* name) {
+    return fd_install(vfs_open(name, VFS_O_CREAT | VFS_O_TRUNC));
+}
+
+int fs_pipe(int fds[2]) {
+    struct vfs_file *rd, *wr;
+    if (pipe_create(&rd, &wr) != 0) return -1;
+    int r = fd_install(rd);
+    if (r < 0) { vfs_close(wr); return -1; }
+    int w = fd_install(wr);
+    if (w < 0) { fs_close(r); return -1; }
+    fds[0] = r;
+    fds[1] = w;
+    return 0;
+}
+
+int fs_unlink(const char* name) {
+    return vfs_unlink(name);
 }
 
 int fs_read(int fd, void* buf, unsigned len) {
-    if (!ext2_is_mounted()) return -1;
-    return ext2_read(fd, buf, len);
+    return vfs_read(fd_file(fd), buf, len);
 }
 
 int fs_write(int fd, const void* buf, unsigned len) {
-    if (!ext2_is_mounted()) return -1;
-    return ext2_write(fd, buf, len);
+    return vfs_write(fd_file(fd), buf, len);
+}
+
+int fs_pread(int fd, void* buf, unsigned len, uint32_t off) {
+    return vfs_pread(fd_file(fd), buf, len, off);
+}
+
+int fs_pwrite(int fd, const void* buf, unsigned len, uint32_t off) {
+    return vfs_pwrite(fd_file(fd), buf, len, off);
+}
+
+int fs_lseek(int fd, int32_t off, int whence) {
+    return vfs_lseek(fd_file(fd), off, whence);
+}
+
+int fs_readv(int fd, const struct vfs_iovec* iov, unsigned cnt) {
+    return vfs_readv(fd_file(fd), iov, cnt);
+}
+
+int fs_writev(int fd, const struct vfs_iovec* iov, unsigned cnt) {
+    return vfs_writev(fd_file(fd), iov, cnt);
+}
+
+int fs_sendfile(int out_fd, int in_fd, uint32_t* offset, unsigned count) {
+    return vfs_sendfile(fd_file(out_fd), fd_file(in_fd), offset, count);
 }
 
 int fs_close(int fd) {
-    if (!ext2_is_mounted()) return -1;
-    return ext2_close(fd);
+    return fdt_close(cur_fdt(), fd);
+}
+
+struct vfs_file* fs_get_file(int fd) {
+    return fd_file(fd);
+}
+
+int fs_may_block(int fd) {
+    struct vfs_file* f = fd_file(fd);
+    return f && f->inode->fops && f->inode->fops->poll;
 }
@@ -0,0 +1,87 @@
+/* fsbench - file create/write/read/unlink throughput per mount.
+ * Runs the same workload on tmpfs (/tmp) and ext2 (/) so the cost of the
+ * disk path for scratch files is visible side by side.
+ */
+
+#include <kernel/vfs.h>
+#include <kernel/pit.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+#define FSBENCH_DEFAULT_FILES 32
+#define FSBENCH_MAX_FILES     60
+#define FSBENCH_FILE_SIZE     8192u
+#define FSBENCH_CHUNK         1024u
+
+static uint8_t g_chunk[FSBENCH_CHUNK];
+
+static void bench_path(char* out, const char* dir, unsigned i) {
+    unsigned n = 0;
+    while (dir[n]) { out[n] = dir[n]; n++; }
+    if (n && out[n - 1] != '/') out[n++] = '/';
+    const char* stem = "fsb";
+    while (*stem) out[n++] = *stem++;
+    out[n++] = (char)('0' + (i / 10) % 10);
+    out[n++] = (char)('0' + i % 10);
+    out[n] = 0;
+}
+
+static uint32_t ticks_to_ms(uint64_t ticks) {
+    uint32_t hz = pit_hz();
+    return hz ? (uint32_t)((ticks * 1000u) / hz) : 0u;
+}
+
+static void report(const char* phase, unsigned files, uint64_t ticks) {
+    uint32_t ms = ticks_to_ms(ticks);
+    uint32_t kib = (files * FSBENCH_FILE_SIZE) / 1024u;
+    printf("  %s: %u ms, %u files/s, %u KiB/s\n", phase, ms,
+           ms ? (files * 1000u) / ms : 0u, ms ? (kib * 1000u) / ms : 0u);
+}
+
+static void bench_mount(const char* dir, unsigned files) {
+    char path[48];
+    printf("fsbench: %s (%u files x %u bytes)\n", dir, files, FSBENCH_FILE_SIZE);
+
+    uint64_t t0 = pit_ticks();
+    for (unsigned i = 0; i < files; ++i) {
+        bench_path(path, dir, i);
+        struct vfs_file* f = vfs_open(path, VFS_O_CREAT | VFS_O_TRUNC);
+        if (!f) { printf("  create failed: %s\n", path); return; }
+        for (uint32_t off = 0; off < FSBENCH_FILE_SIZE; off += FSBENCH_CHUNK) {
+            if (vfs_write(f, g_chunk, FSBENCH_CHUNK) != (int)FSBENCH_CHUNK) {
+                printf("  write failed: %s\n", path);
+                vfs_close(f);
+                return;
+            }
+        }
+        vfs_close(f);
+    }
+    uint64_t t1 = pit_ticks();
+
+    for (unsigned i = 0; i < files; ++i) {
+        bench_path(path, dir, i);
+        struct vfs_file* f = vfs_open(path, 0);
+        if (!f) { printf("  open failed: %s\n", path); return; }
+        while (vfs_read(f, g_chunk, FSBENCH_CHUNK) > 0) { }
+        vfs_close(f);
+    }
+    uint64_t t2 = pit_ticks();
+
+    for (unsigned i = 0; i < files; ++i) {
+        bench_path(path, dir, i);
+        if (vfs_unlink(path) != 0) printf("  unlink failed: %s\n", path);
+    }
+    uint64_t t3 = pit_ticks();
+
+    report("create+write", files, t1 - t0);
+    report("read", files, t2 - t1);
+    report("unlink", files, t3 - t2);
+}
+
+void fsbench_run(unsigned files) {
+    if (files == 0) files = FSBENCH_DEFAULT_FILES;
+    if (files > FSBENCH_MAX_FILES) files = FSBENCH_MAX_FILES;
+    for (unsigned i = 0; i < FSBENCH_CHUNK; ++i) g_chunk[i] = (uint8_t)('a' + i % 26);
+    bench_mount("/tmp", files);
+    bench_mount("/", files);
+}
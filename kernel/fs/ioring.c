@@ -0,0 +1,147 @@
+#include <kernel/ioring.h>
+#include <kernel/process.h>
+#include <kernel/mmap.h>
+#include <kernel/fs.h>
+#include <kernel/vfs.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+/* Requests are carried out while SYS_io_enter runs: there is one CPU and
+   the block drivers complete synchronously, so every consumed SQE has its
+   CQE posted before the call returns and a GETEVENTS wait never blocks.
+   What the rings buy is one kernel entry for a whole batch. Writes reach
+   the disk before they complete, so FSYNC only checks the fd. */
+
+struct io_ring {
+    int pid;                       /* owner; 0 = free slot */
+    uint32_t uaddr;
+    struct io_ring_hdr* hdr;       /* user mapping, valid in the owner's space */
+    struct io_sqe* sqes;
+    struct io_cqe* cqes;
+    uint32_t sq_mask, cq_mask;
+};
+
+static struct io_ring rings[IO_RING_MAX];
+
+static uint32_t ring_bytes(uint32_t sq, uint32_t cq) {
+    return (uint32_t)(sizeof(struct io_ring_hdr) + sq * sizeof(struct io_sqe) + cq * sizeof(struct io_cqe));
+}
+
+/* Undo the first `mapped` bytes of a ring mapping that could not be finished. */
+static void ring_unmap(uint32_t base, uint32_t mapped) {
+    for (uint32_t off = 0; off < mapped; off += PAGE_SIZE) {
+        uint32_t pte = vmm_get_pte(base + off);
+        if (!(pte & PAGE_PRESENT)) continue;
+        vmm_unmap(base + off);
+        pmm_free_frame(pte & ~0xFFFu);
+    }
+}
+
+int io_ring_setup(process_t* proc, uint32_t entries, struct io_ring_params* params) {
+    if (!proc || !params || entries == 0 || entries > IO_RING_MAX_ENTRIES) return -1;
+    uint32_t sq = 1;
+    while (sq < entries) sq <<= 1;
+    uint32_t cq = sq * 2;
+
+    int id = -1;
+    for (int i = 0; i < IO_RING_MAX && id < 0; ++i) {
+        if (!rings[i].pid) id = i;
+    }
+    if (id < 0) return -1;
+
+    uint32_t size = (ring_bytes(sq, cq) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t base = mmap_find_range(proc, size);
+    if (base == MAP_FAILED) return -1;
+    /* Pinned so munmap and MAP_FIXED cannot pull the ring out from under
+       io_ring_enter. */
+    if (mmap_add_vma(proc, base, base + size, PROT_READ | PROT_WRITE, MAP_SHARED | VMA_PINNED, 0, 0) != 0) {
+        return -1;
+    }
+    for (uint32_t off = 0; off < size; off += PAGE_SIZE) {
+        uint32_t phys = pmm_alloc_frame();
+        if (!phys || vmm_map(base + off, phys, PAGE_WRITE | PAGE_USER) != 0) {
+            if (phys) pmm_free_frame(phys);
+            ring_unmap(base, off);
+            mmap_remove_vma(proc, base);
+            printf("io_ring: out of memory\n");
+            return -1;
+        }
+        memset(vmm_phys_to_virt(phys), 0, PAGE_SIZE);
+    }
+
+    struct io_ring* r = &rings[id];
+    r->pid = proc->pid;
+    r->uaddr = base;
+    r->hdr = (struct io_ring_hdr*)base;
+    r->sqes = (struct io_sqe*)(base + sizeof(struct io_ring_hdr));
+    r->cqes = (struct io_cqe*)((uint8_t*)r->sqes + sq * sizeof(struct io_sqe));
+    r->sq_mask = sq - 1;
+    r->cq_mask = cq - 1;
+    r->hdr->sq_entries = sq;
+    r->hdr->cq_entries = cq;
+    r->hdr->sqes_off = (uint32_t)((uint32_t)r->sqes - base);
+    r->hdr->cqes_off = (uint32_t)((uint32_t)r->cqes - base);
+
+    params->sq_entries = sq;
+    params->cq_entries = cq;
+    params->ring_addr = base;
+    params->ring_size = size;
+    return id;
+}
+
+static int32_t io_execute(const struct io_sqe* sqe) {
+    switch (sqe->opcode) {
+        case IO_OP_NOP:
+            return 0;
+        case IO_OP_READ:
+            if (sqe->off == IO_OFF_CURRENT) return fs_read(sqe->fd, (void*)sqe->addr, sqe->len);
+            return fs_pread(sqe->fd, (void*)sqe->addr, sqe->len, sqe->off);
+        case IO_OP_WRITE:
+            if (sqe->off == IO_OFF_CURRENT) return fs_write(sqe->fd, (const void*)sqe->addr, sqe->len);
+            return fs_pwrite(sqe->fd, (const void*)sqe->addr, sqe->len, sqe->off);
+        case IO_OP_FSYNC:
+            return fs_get_file(sqe->fd) ? 0 : -1;
+        default:
+            return -1;
+    }
+}
+
+int io_ring_enter(process_t* proc, int ring, uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    (void)min_complete; (void)flags; /* nothing is ever left in flight */
+    if (!proc || ring < 0 || ring >= IO_RING_MAX || rings[ring].pid != proc->pid) return -1;
+    struct io_ring* r = &rings[ring];
+    struct io_ring_hdr* h = r->hdr;
+
+    uint32_t head = h->sq_head;
+    uint32_t tail = h->sq_tail;
+    uint32_t cq_tail = h->cq_tail;
+    uint32_t done = 0;
+    while (done < to_submit && head != tail) {
+        if (cq_tail - h->cq_head > r->cq_mask) {
+            h->cq_overflow++;
+            break;
+        }
+        struct io_sqe sqe = r->sqes[head & r->sq_mask];
+        struct io_cqe* cqe = &r->cqes[cq_tail & r->cq_mask];
+        cqe->user_data = sqe.user_data;
+        cqe->res = io_execute(&sqe);
+        cq_tail++;
+        head++;
+        done++;
+        /* Publish the entry before the index that makes it visible. */
+        __asm__ volatile("" ::: "memory");
+        h->cq_tail = cq_tail;
+        h->sq_head = head;
+    }
+    return (int)done;
+}
+
+void io_ring_release(int pid) {
+    for (int i = 0; i < IO_RING_MAX; ++i) {
+        if (rings[i].pid != pid) continue;
+        mmap_remove_vma(process_find(pid), rings[i].uaddr);
+        memset(&rings[i], 0, sizeof(rings[i]));
+    }
+}
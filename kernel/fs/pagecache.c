@@ -0,0 +1,178 @@
+#include <kernel/pagecache.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/vfs.h>
+#include <string.h>
+
+/* Fixed pool of cache entries hashed by (dev, ino, index). Replacement is a
+   clock sweep that skips pinned pages and pages still mapped somewhere
+   (frame refcount > 1), so eviction never pulls a frame out from under a
+   user mapping or loses tmpfs data. */
+
+#define PAGECACHE_MAX     1024
+#define PAGECACHE_BUCKETS 256
+#define PAGECACHE_RESERVE 64   /* keep this many frames free for everyone else */
+/* At most this many pinned pages, so file systems that can re-read their
+   pages (ext2) always find evictable slots however full tmpfs gets. */
+#define PAGECACHE_MAX_PINNED (PAGECACHE_MAX * 3 / 4)
+
+struct pc_entry {
+    uint32_t dev;
+    uint32_t ino;
+    uint32_t index;
+    uint32_t phys;      /* 0 = slot unused */
+    int16_t  next;      /* hash chain, -1 terminates */
+    uint8_t  accessed;  /* clock reference bit */
+    uint8_t  pinned;
+};
+
+static struct pc_entry pc_pool[PAGECACHE_MAX];
+static int16_t pc_buckets[PAGECACHE_BUCKETS];
+static int pc_ready = 0;
+static uint32_t pc_hand = 0;
+static struct pagecache_stats pc_stats;
+
+static inline uint32_t pc_hash(uint32_t dev, uint32_t ino, uint32_t index) {
+    return ((ino + (dev << 24)) * 2654435761u ^ index * 40503u) % PAGECACHE_BUCKETS;
+}
+
+static void pc_init(void) {
+    for (int i = 0; i < PAGECACHE_BUCKETS; ++i) pc_buckets[i] = -1;
+    memset(pc_pool, 0, sizeof(pc_pool));
+    for (int i = 0; i < PAGECACHE_MAX; ++i) pc_pool[i].next = -1;
+    memset(&pc_stats, 0, sizeof(pc_stats));
+    pc_stats.capacity = PAGECACHE_MAX;
+    pc_hand = 0;
+    pc_ready = 1;
+}
+
+static struct pc_entry* pc_lookup(uint32_t dev, uint32_t ino, uint32_t index) {
+    if (!pc_ready) return 0;
+    for (int16_t i = pc_buckets[pc_hash(dev, ino, index)]; i >= 0; i = pc_pool[i].next) {
+        struct pc_entry* e = &pc_pool[i];
+        if (e->dev == dev && e->ino == ino && e->index == index) return e;
+    }
+    return 0;
+}
+
+static void pc_unlink(int16_t slot) {
+    struct pc_entry* e = &pc_pool[slot];
+    int16_t* link = &pc_buckets[pc_hash(e->dev, e->ino, e->index)];
+    while (*link >= 0 && *link != slot) link = &pc_pool[*link].next;
+    if (*link == slot) *link = e->next;
+    e->next = -1;
+}
+
+static void pc_drop(int16_t slot) {
+    struct pc_entry* e = &pc_pool[slot];
+    pc_unlink(slot);
+    pmm_unref_frame(e->phys);
+    e->phys = 0;
+    if (e->pinned) { e->pinned = 0; pc_stats.pinned--; }
+    pc_stats.pages--;
+}
+
+/* Clock sweep: clear reference bits on the first pass, evict on the second.
+   Returns a free slot index or -1 if everything is pinned by mappings. */
+static int pc_evict_one(void) {
+    for (uint32_t scanned = 0; scanned < 2u * PAGECACHE_MAX; ++scanned) {
+        int16_t slot = (int16_t)pc_hand;
+        pc_hand = (pc_hand + 1) % PAGECACHE_MAX;
+        struct pc_entry* e = &pc_pool[slot];
+        if (!e->phys || e->pinned) continue;
+        if (e->accessed) { e->accessed = 0; continue; }
+        if (pmm_frame_refs(e->phys) > 1) continue;
+        pc_drop(slot);
+        pc_stats.evictions++;
+        return slot;
+    }
+    return -1;
+}
+
+static int pc_free_slot(void) {
+    if (pc_stats.pages < PAGECACHE_MAX && pmm_free_frames() > PAGECACHE_RESERVE) {
+        for (int i = 0; i < PAGECACHE_MAX; ++i) {
+            if (!pc_pool[i].phys) return i;
+        }
+    }
+    return pc_evict_one();
+}
+
+uint32_t pagecache_get(struct vfs_inode* inode, uint32_t index, pagecache_fill_t fill) {
+    if (!pc_ready) pc_init();
+    uint32_t dev = inode->sb->dev, ino = inode->ino;
+    struct pc_entry* e = pc_lookup(dev, ino, index);
+    if (e) {
+        e->accessed = 1;
+        pc_stats.hits++;
+        return e->phys;
+    }
+    pc_stats.misses++;
+    if (!fill) return 0;
+
+    int slot = pc_free_slot();
+    if (slot < 0) return 0;
+    uint32_t phys = pmm_alloc_frame();
+    if (!phys) return 0;
+    if (fill(inode, index, vmm_phys_to_virt(phys)) != 0) {
+        pmm_free_frame(phys);
+        return 0;
+    }
+
+    e = &pc_pool[slot];
+    e->dev = dev;
+    e->ino = ino;
+    e->index = index;
+    e->phys = phys;
+    e->accessed = 1;
+    e->pinned = 0;
+    uint32_t h = pc_hash(dev, ino, index);
+    e->next = pc_buckets[h];
+    pc_buckets[h] = (int16_t)slot;
+    pc_stats.pages++;
+    return phys;
+}
+
+uint32_t pagecache_peek(struct vfs_inode* inode, uint32_t index) {
+    struct pc_entry* e = pc_lookup(inode->sb->dev, inode->ino, index);
+    if (!e) return 0;
+    e->accessed = 1;
+    return e->phys;
+}
+
+void pagecache_update(struct vfs_inode* inode, uint32_t index, uint32_t offset, const void* src, uint32_t len) {
+    struct pc_entry* e = pc_lookup(inode->sb->dev, inode->ino, index);
+    if (!e || offset >= PAGECACHE_PAGE_SIZE) return;
+    if (len > PAGECACHE_PAGE_SIZE - offset) len = PAGECACHE_PAGE_SIZE - offset;
+    memcpy((uint8_t*)vmm_phys_to_virt(e->phys) + offset, src, len);
+}
+
+int pagecache_pin(struct vfs_inode* inode, uint32_t index) {
+    struct pc_entry* e = pc_lookup(inode->sb->dev, inode->ino, index);
+    if (!e) return -1;
+    if (!e->pinned) {
+        if (pc_stats.pinned >= PAGECACHE_MAX_PINNED) return -1;
+        e->pinned = 1;
+        pc_stats.pinned++;
+    }
+    return 0;
+}
+
+void pagecache_drop_inode(uint32_t dev, uint32_t ino) {
+    if (!pc_ready) return;
+    for (int16_t i = 0; i < PAGECACHE_MAX; ++i) {
+        if (pc_pool[i].phys && pc_pool[i].dev == dev && pc_pool[i].ino == ino) pc_drop(i);
+    }
+}
+
+void pagecache_invalidate_dev(uint32_t dev) {
+    if (!pc_ready) return;
+    for (int16_t i = 0; i < PAGECACHE_MAX; ++i) {
+        if (pc_pool[i].phys && pc_pool[i].dev == dev) pc_drop(i);
+    }
+}
+
+void pagecache_get_stats(struct pagecache_stats* out) {
+    if (!pc_ready) pc_init();
+    *out = pc_stats;
+}
@@ -0,0 +1,195 @@
+#include <kernel/pipe.h>
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/poll.h>
+#include <kernel/waitq.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <string.h>
+
+/* Each pipe has two in-core inodes on a private superblock, one per end
+   (ino = slot * 2 + 1 for the read end, + 2 for the write end), so the
+   end is fixed by the inode's fops and the open-file count per end is
+   tracked through the release op. */
+
+#define MIN(a,b) ((a)<(b)?(a):(b))
+
+#define PIPE_USER_LO  0x00001000u
+#define PIPE_USER_TOP 0xC0000000u
+
+struct pipe {
+    uint8_t  used;
+    uint32_t frame;              /* the ring page */
+    uint32_t rpos;               /* ring offset of the oldest byte */
+    uint32_t count;              /* bytes queued */
+    uint32_t readers, writers;   /* open files per end */
+    struct wait_queue rd_wq;     /* readers waiting for data */
+    struct wait_queue wr_wq;     /* writers waiting for room */
+};
+
+static struct pipe pipes[PIPE_MAX];
+static struct vfs_super pipe_sb;
+
+static struct pipe* pipe_of(struct vfs_inode* inode) {
+    return &pipes[(inode->ino - 1) / 2];
+}
+
+static uint8_t* ring(struct pipe* p) {
+    return (uint8_t*)vmm_phys_to_virt(p->frame);
+}
+
+/* Sleep until a reader has data or EOF, or a writer has room or no reader.
+   The waiter goes on the queue before the check, so a wake-up between
+   the check and the halt is not lost. */
+static void pipe_wait(struct pipe* p, int reading) {
+    volatile uint32_t woken = 0;
+    struct waiter w = { 0, &woken };
+    struct wait_queue* q = reading ? &p->rd_wq : &p->wr_wq;
+    waitq_add(q, &w);
+    while (reading ? (p->count == 0 && p->writers) : (p->count == PIPE_SIZE && p->readers)) {
+        waitq_sleep(&woken, 0);
+        woken = 0;
+    }
+    waitq_remove(q, &w);
+}
+
+/* Page flip: a full, page-aligned ring read into a page-aligned private
+   user page swaps frames instead of copying. The reader's old frame (its
+   only reference) becomes the new ring. */
+static int try_flip(struct pipe* p, uint8_t* dst) {
+    uint32_t va = (uint32_t)dst;
+    if (p->rpos != 0 || p->count != PIPE_SIZE) return 0;
+    if ((va & 0xFFFu) || va < PIPE_USER_LO || va >= PIPE_USER_TOP) return 0;
+    uint32_t pte = vmm_get_pte(va);
+    const uint32_t want = PAGE_PRESENT | PAGE_USER | PAGE_WRITE;
+    if ((pte & want) != want) return 0;
+    uint32_t old = pte & ~0xFFFu;
+    if (pmm_frame_refs(old) != 1) return 0;   /* shared or not ours to give */
+    if (vmm_map(va, p->frame, PAGE_USER | PAGE_WRITE) != 0) return 0;
+    p->frame = old;
+    p->count = 0;
+    return 1;
+}
+
+static int pipe_read(struct vfs_inode* inode, uint32_t off, void* buf, unsigned len) {
+    (void)off;
+    struct pipe* p = pipe_of(inode);
+    if (len == 0) return 0;
+    pipe_wait(p, 1);
+    uint8_t* dst = (uint8_t*)buf;
+    unsigned done = 0;
+    while (done < len && p->count) {
+        if (len - done >= PIPE_SIZE && try_flip(p, dst + done)) {
+            done += PIPE_SIZE;
+            continue;
+        }
+        unsigned n = MIN(p->count, PIPE_SIZE - p->rpos);
+        n = MIN(n, len - done);
+        memcpy(dst + done, ring(p) + p->rpos, n);
+        p->rpos = (p->rpos + n) % PIPE_SIZE;
+        p->count -= n;
+        done += n;
+    }
+    if (!p->count) p->rpos = 0; /* keeps page-sized transfers flippable */
+    if (done) waitq_wake(&p->wr_wq);
+    return (int)done;
+}
+
+/* Blocks until everything is queued; short only when the last reader goes. */
+static int pipe_write(struct vfs_inode* inode, uint32_t off, const void* buf, unsigned len) {
+    (void)off;
+    struct pipe* p = pipe_of(inode);
+    const uint8_t* src = (const uint8_t*)buf;
+    unsigned done = 0;
+    while (done < len) {
+        pipe_wait(p, 0);
+        if (!p->readers) break;
+        uint32_t wpos = (p->rpos + p->count) % PIPE_SIZE;
+        unsigned n = MIN(PIPE_SIZE - p->count, PIPE_SIZE - wpos);
+        n = MIN(n, len - done);
+        memcpy(ring(p) + wpos, src + done, n);
+        p->count += n;
+        done += n;
+        waitq_wake(&p->rd_wq);
+    }
+    return done ? (int)done : -1;
+}
+
+static uint32_t pipe_read_poll(struct vfs_inode* inode, struct poll_table* pt) {
+    struct pipe* p = pipe_of(inode);
+    poll_wait(pt, &p->rd_wq);
+    return (p->count ? POLLIN : 0) | (p->writers ? 0 : POLLHUP);
+}
+
+static uint32_t pipe_write_poll(struct vfs_inode* inode, struct poll_table* pt) {
+    struct pipe* p = pipe_of(inode);
+    poll_wait(pt, &p->wr_wq);
+    if (!p->readers) return POLLERR;
+    return PIPE_SIZE - p->count >= PIPE_BUF ? POLLOUT : 0;
+}
+
+static void pipe_release(struct vfs_inode* inode, struct vfs_file* f) {
+    (void)f;
+    struct pipe* p = pipe_of(inode);
+    if (inode->ino % 2) {
+        p->readers--;
+        waitq_wake(&p->wr_wq);
+    } else {
+        p->writers--;
+        waitq_wake(&p->rd_wq);
+    }
+    if (!p->readers && !p->writers) {
+        pmm_unref_frame(p->frame);
+        memset(p, 0, sizeof(*p));
+    }
+}
+
+static const struct vfs_file_ops pipe_read_fops = {
+    .read = pipe_read, .poll = pipe_read_poll, .release = pipe_release,
+};
+
+static const struct vfs_file_ops pipe_write_fops = {
+    .write = pipe_write, .poll = pipe_write_poll, .release = pipe_release,
+};
+
+static int pipe_read_inode(struct vfs_super* sb, struct vfs_inode* inode) {
+    (void)sb;
+    uint32_t slot = (inode->ino - 1) / 2;
+    if (inode->ino == 0 || slot >= PIPE_MAX || !pipes[slot].used) return -1;
+    inode->type = FS_DT_FIFO;
+    inode->fops = (inode->ino % 2) ? &pipe_read_fops : &pipe_write_fops;
+    return 0;
+}
+
+static const struct vfs_super_ops pipe_sops = { .read_inode = pipe_read_inode };
+
+int pipe_create(struct vfs_file** rd, struct vfs_file** wr) {
+    if (!pipe_sb.dev) {
+        pipe_sb.fstype = "pipefs";
+        pipe_sb.dev = vfs_alloc_dev();
+        pipe_sb.ops = &pipe_sops;
+    }
+    uint32_t slot = 0;
+    while (slot < PIPE_MAX && pipes[slot].used) slot++;
+    if (slot == PIPE_MAX) return -1;
+    struct pipe* p = &pipes[slot];
+    p->frame = pmm_alloc_frame();
+    if (!p->frame) return -1;
+    p->used = 1;
+    p->readers = p->writers = 1;
+
+    struct vfs_inode* ri = vfs_iget(&pipe_sb, slot * 2 + 1);
+    struct vfs_inode* wi = vfs_iget(&pipe_sb, slot * 2 + 2);
+    *rd = ri ? vfs_open_inode(ri) : 0;
+    *wr = wi ? vfs_open_inode(wi) : 0;
+    if (*rd && *wr) return 0;
+
+    /* Unwind: closing an end runs release, which frees the slot. */
+    if (*rd) vfs_close(*rd); else { vfs_iput(ri); p->readers--; }
+    if (*wr) vfs_close(*wr); else { vfs_iput(wi); p->writers--; }
+    if (p->used && !p->readers && !p->writers) {
+        pmm_unref_frame(p->frame);
+        memset(p, 0, sizeof(*p));
+    }
+    return -1;
+}
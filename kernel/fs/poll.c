@@ -0,0 +1,67 @@
+#include <kernel/poll.h>
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/pit.h>
+#include <string.h>
+
+/* poll() over VFS files. The first scan registers a waiter on every source
+   wait queue the files report; the caller then sleeps until one of those
+   queues is woken from an IRQ (or the timeout), rescans, and repeats. */
+
+void poll_wait(struct poll_table* pt, struct wait_queue* q) {
+    if (!pt || !q) return;
+    for (uint32_t i = 0; i < pt->nwait; ++i) {
+        if (pt->ent[i].q == q) return;
+    }
+    if (pt->nwait >= pt->max) { pt->overflow = 1; return; }
+    struct waiter* w = &pt->ent[pt->nwait].w;
+    w->flag = &pt->woken;
+    pt->ent[pt->nwait].q = q;
+    pt->nwait++;
+    waitq_add(q, w);
+}
+
+static int scan(struct pollfd* fds, uint32_t nfds, struct poll_table* pt) {
+    int ready = 0;
+    for (uint32_t i = 0; i < nfds; ++i) {
+        struct pollfd* p = &fds[i];
+        p->revents = 0;
+        if (p->fd < 0) continue;
+        struct vfs_file* f = fs_get_file(p->fd);
+        if (pt) pt->key = (uint16_t)p->events;
+        uint32_t mask = f ? vfs_poll(f, pt) : POLLNVAL;
+        p->revents = (int16_t)(mask & ((uint16_t)p->events | POLLERR | POLLHUP | POLLNVAL));
+        if (p->revents) ready++;
+    }
+    return ready;
+}
+
+int fs_poll(struct pollfd* fds, uint32_t nfds, int32_t timeout_ms) {
+    if (nfds > POLL_MAX_FDS || (nfds && !fds)) return -1;
+    uint64_t deadline = 0;
+    if (timeout_ms > 0) {
+        uint32_t hz = pit_hz();
+        uint64_t ticks = hz ? ((uint64_t)timeout_ms * hz + 999u) / 1000u : 1u;
+        deadline = pit_ticks() + (ticks ? ticks : 1u);
+    }
+
+    struct poll_entry ents[nfds ? nfds * POLL_WAITS_PER_FD : 1];
+    struct poll_table pt;
+    memset((void*)&pt, 0, sizeof(pt));
+    pt.ent = ents;
+    pt.max = nfds * POLL_WAITS_PER_FD;
+    int ready = scan(fds, nfds, timeout_ms ? &pt : 0);
+    while (!ready && timeout_ms != 0) {
+        if (pt.overflow) {
+            /* Some queues went unregistered: recheck after every interrupt. */
+            if (deadline && pit_ticks() >= deadline) break;
+            __asm__ volatile("sti; hlt" ::: "memory");
+        } else if (!waitq_sleep(&pt.woken, deadline)) {
+            break;
+        }
+        pt.woken = 0;
+        ready = scan(fds, nfds, 0);
+    }
+    for (uint32_t i = 0; i < pt.nwait; ++i) waitq_remove(pt.ent[i].q, &pt.ent[i].w);
+    return ready;
+}
@@ -0,0 +1,208 @@
+#include <kernel/tmpfs.h>
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/pagecache.h>
+#include <kernel/vmm.h>
+#include <kernel/pit.h>
+#include <string.h>
+
+/* In-memory filesystem. Metadata lives in a fixed node table; file data
+   lives only in the page cache as pinned pages keyed by this superblock's
+   device, so read(), mmap() and the cache statistics treat it like any
+   other file. Flat: one root directory, regular files only. */
+
+#define TMPFS_MAX_NODES 64
+#define TMPFS_NAME_MAX  59
+#define TMPFS_ROOT_INO  1
+
+#define MIN(a,b) ((a)<(b)?(a):(b))
+
+struct tmpfs_node {
+    uint8_t  used;
+    uint8_t  type;
+    uint8_t  name_len;
+    uint32_t parent;
+    uint32_t size;
+    uint32_t mtime;
+    char     name[TMPFS_NAME_MAX + 1];
+};
+
+static struct tmpfs_node nodes[TMPFS_MAX_NODES]; /* ino = index + 1 */
+static struct vfs_super tmpfs_sb;
+
+static uint32_t tmpfs_now(void) {
+    uint32_t hz = pit_hz();
+    return hz ? (uint32_t)(pit_ticks() / hz) : 0u;
+}
+
+static struct tmpfs_node* node_of(uint32_t ino) {
+    if (ino == 0 || ino > TMPFS_MAX_NODES || !nodes[ino - 1].used) return 0;
+    return &nodes[ino - 1];
+}
+
+static int find_child(uint32_t dir, const char* name, unsigned len) {
+    for (int i = 0; i < TMPFS_MAX_NODES; ++i) {
+        struct tmpfs_node* n = &nodes[i];
+        if (n->used && n->parent == dir && i + 1 != TMPFS_ROOT_INO &&
+            n->name_len == len && memcmp(n->name, name, len) == 0) return i;
+    }
+    return -1;
+}
+
+static int tmpfs_lookup(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* ino) {
+    if (len == 2 && name[0] == '.' && name[1] == '.') { *ino = TMPFS_ROOT_INO; return 0; }
+    int i = find_child(dir->ino, name, len);
+    if (i < 0) return -1;
+    *ino = (uint32_t)i + 1;
+    return 0;
+}
+
+static int tmpfs_create(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* ino) {
+    if (len == 0 || len > TMPFS_NAME_MAX || find_child(dir->ino, name, len) >= 0) return -1;
+    for (int i = 0; i < TMPFS_MAX_NODES; ++i) {
+        struct tmpfs_node* n = &nodes[i];
+        if (n->used) continue;
+        memset(n, 0, sizeof(*n));
+        n->used = 1;
+        n->type = FS_DT_REG;
+        n->parent = dir->ino;
+        n->mtime = tmpfs_now();
+        n->name_len = (uint8_t)len;
+        memcpy(n->name, name, len);
+        *ino = (uint32_t)i + 1;
+        return 0;
+    }
+    return -1;
+}
+
+/* The VFS drops the node's cached (pinned) pages after a successful unlink. */
+static int tmpfs_unlink(struct vfs_inode* dir, const char* name, unsigned len) {
+    int i = find_child(dir->ino, name, len);
+    if (i < 0 || nodes[i].type != FS_DT_REG) return -1;
+    nodes[i].used = 0;
+    return 0;
+}
+
+static int tmpfs_truncate(struct vfs_inode* inode) {
+    struct tmpfs_node* n = node_of(inode->ino);
+    if (!n) return -1;
+    n->size = inode->size = 0;
+    n->mtime = inode->mtime = tmpfs_now();
+    return 0;
+}
+
+static int tmpfs_fill_zero(struct vfs_inode* inode, uint32_t index, void* page) {
+    (void)inode; (void)index;
+    memset(page, 0, PAGECACHE_PAGE_SIZE);
+    return 0;
+}
+
+static int tmpfs_read(struct vfs_inode* inode, uint32_t off, void* buf, unsigned len) {
+    unsigned copied = 0;
+    while (copied < len && off < inode->size) {
+        uint32_t phys = pagecache_get(inode, off / PAGECACHE_PAGE_SIZE, tmpfs_fill_zero);
+        if (!phys) break;
+        uint32_t poff = off % PAGECACHE_PAGE_SIZE;
+        unsigned n = MIN(len - copied, PAGECACHE_PAGE_SIZE - poff);
+        if (n > inode->size - off) n = inode->size - off;
+        memcpy((uint8_t*)buf + copied, (const uint8_t*)vmm_phys_to_virt(phys) + poff, n);
+        copied += n;
+        off += n;
+    }
+    return (int)copied;
+}
+
+static int tmpfs_write(struct vfs_inode* inode, uint32_t off, const void* buf, unsigned len) {
+    struct tmpfs_node* node = node_of(inode->ino);
+    if (!node) return -1;
+    unsigned written = 0;
+    while (written < len) {
+        uint32_t index = off / PAGECACHE_PAGE_SIZE;
+        uint32_t phys = pagecache_get(inode, index, tmpfs_fill_zero);
+        /* Out of space: the cache is short of slots or at its pin limit.
+           An unpinned page left behind still reads back as a hole. */
+        if (!phys || pagecache_pin(inode, index) != 0) break;
+        uint32_t poff = off % PAGECACHE_PAGE_SIZE;
+        unsigned n = MIN(len - written, PAGECACHE_PAGE_SIZE - poff);
+        memcpy((uint8_t*)vmm_phys_to_virt(phys) + poff, (const uint8_t*)buf + written, n);
+        written += n;
+        off += n;
+    }
+    if (off > node->size) node->size = off;
+    node->mtime = tmpfs_now();
+    inode->size = node->size;
+    inode->mtime = node->mtime;
+    return written ? (int)written : -1;
+}
+
+static int tmpfs_getdents(struct vfs_inode* dir, uint32_t* cookie, void* buf, unsigned len) {
+    uint8_t* out = (uint8_t*)buf;
+    unsigned n = 0;
+    uint32_t i = *cookie;
+    for (; i < TMPFS_MAX_NODES; ++i) {
+        struct tmpfs_node* c = &nodes[i];
+        if (!c->used || c->parent != dir->ino || i + 1 == TMPFS_ROOT_INO) continue;
+        unsigned reclen = (unsigned)(sizeof(struct fs_dirent) + c->name_len + 1 + 3) & ~3u;
+        if (n + reclen > len) {
+            if (n == 0) return -1;
+            break;
+        }
+        struct fs_dirent* d = (struct fs_dirent*)(out + n);
+        d->d_ino = i + 1;
+        d->d_off = i + 1;
+        d->d_reclen = (uint16_t)reclen;
+        d->d_type = c->type;
+        d->d_namlen = c->name_len;
+        memcpy(d->d_name, c->name, c->name_len);
+        d->d_name[c->name_len] = 0;
+        n += reclen;
+    }
+    *cookie = i;
+    return (int)n;
+}
+
+static uint32_t tmpfs_get_page(struct vfs_inode* inode, uint32_t index) {
+    return pagecache_get(inode, index, tmpfs_fill_zero);
+}
+
+static const struct vfs_inode_ops tmpfs_iops = {
+    .lookup = tmpfs_lookup,
+    .create = tmpfs_create,
+    .unlink = tmpfs_unlink,
+    .truncate = tmpfs_truncate,
+};
+
+static const struct vfs_file_ops tmpfs_fops = {
+    .read = tmpfs_read,
+    .write = tmpfs_write,
+    .getdents = tmpfs_getdents,
+    .get_page = tmpfs_get_page,
+};
+
+static int tmpfs_read_inode(struct vfs_super* sb, struct vfs_inode* inode) {
+    (void)sb;
+    struct tmpfs_node* n = node_of(inode->ino);
+    if (!n) return -1;
+    inode->type = n->type;
+    inode->size = n->size;
+    inode->mtime = n->mtime;
+    inode->iops = &tmpfs_iops;
+    inode->fops = &tmpfs_fops;
+    return 0;
+}
+
+static const struct vfs_super_ops tmpfs_sops = { .read_inode = tmpfs_read_inode };
+
+struct vfs_super* tmpfs_create_super(void) {
+    if (tmpfs_sb.dev) return &tmpfs_sb;
+    memset(nodes, 0, sizeof(nodes));
+    struct tmpfs_node* root = &nodes[TMPFS_ROOT_INO - 1];
+    root->used = 1;
+    root->type = FS_DT_DIR;
+    root->parent = TMPFS_ROOT_INO;
+    tmpfs_sb.fstype = "tmpfs";
+    tmpfs_sb.dev = vfs_alloc_dev();
+    tmpfs_sb.root_ino = TMPFS_ROOT_INO;
+    tmpfs_sb.ops = &tmpfs_sops;
+    return &tmpfs_sb;
+}
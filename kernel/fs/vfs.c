@@ -0,0 +1,335 @@
+#include <kernel/vfs.h>
+#include <kernel/fs.h>
+#include <kernel/pagecache.h>
+#include <kernel/elfcache.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <kernel/poll.h>
+#include <string.h>
+
+/* Mount table, in-core inode pool and open-file objects. Paths are resolved
+   by picking the mount with the longest matching prefix and walking the
+   remaining components through that filesystem's lookup op. */
+
+struct vfs_mount_ent {
+    char path[VFS_MOUNT_PATH];  /* normalised: "" for the root mount */
+    unsigned len;
+    struct vfs_super* sb;
+};
+
+static struct vfs_mount_ent mounts[VFS_MAX_MOUNTS];
+static struct vfs_inode inodes[VFS_MAX_INODES];
+static struct vfs_file files[VFS_MAX_FILES];
+static uint32_t next_dev = 1;
+
+uint32_t vfs_alloc_dev(void) { return next_dev++; }
+
+int vfs_mount(const char* path, struct vfs_super* sb) {
+    if (!path || !sb || path[0] != '/') return -1;
+    unsigned len = (unsigned)strlen(path);
+    while (len > 0 && path[len - 1] == '/') len--;
+    if (len >= VFS_MOUNT_PATH) return -1;
+
+    struct vfs_mount_ent* slot = 0;
+    for (int i = 0; i < VFS_MAX_MOUNTS; ++i) {
+        struct vfs_mount_ent* m = &mounts[i];
+        if (m->sb && m->len == len && memcmp(m->path, path, len) == 0) { slot = m; break; }
+        if (!m->sb && !slot) slot = m;
+    }
+    if (!slot) return -1;
+    memcpy(slot->path, path, len);
+    slot->path[len] = 0;
+    slot->len = len;
+    slot->sb = sb;
+    printf("vfs: mounted %s at %s\n", sb->fstype, len ? slot->path : "/");
+    return 0;
+}
+
+/* Longest-prefix mount for path; *rest points past the mount path. */
+static struct vfs_mount_ent* find_mount(const char* path, const char** rest) {
+    struct vfs_mount_ent* best = 0;
+    for (int i = 0; i < VFS_MAX_MOUNTS; ++i) {
+        struct vfs_mount_ent* m = &mounts[i];
+        if (!m->sb || (best && m->len <= best->len)) continue;
+        if (memcmp(path, m->path, m->len) != 0) continue;
+        char c = path[m->len];
+        if (c == 0 || c == '/' || c == '\\' || m->len == 0) best = m;
+    }
+    if (best) *rest = path + best->len;
+    return best;
+}
+
+struct vfs_inode* vfs_iget(struct vfs_super* sb, uint32_t ino) {
+    struct vfs_inode* spare = 0;
+    for (int i = 0; i < VFS_MAX_INODES; ++i) {
+        struct vfs_inode* n = &inodes[i];
+        if (n->valid && n->sb == sb && n->ino == ino) { n->refs++; return n; }
+        if (!n->valid && !spare) spare = n;
+    }
+    if (!spare) {
+        /* Recycle an unreferenced in-core inode. */
+        for (int i = 0; i < VFS_MAX_INODES && !spare; ++i) {
+            if (!inodes[i].refs) spare = &inodes[i];
+        }
+        if (!spare) { printf("vfs: inode pool exhausted\n"); return 0; }
+    }
+    memset(spare, 0, sizeof(*spare));
+    spare->sb = sb;
+    spare->ino = ino;
+    if (sb->ops->read_inode(sb, spare) != 0) return 0;
+    spare->valid = 1;
+    spare->refs = 1;
+    return spare;
+}
+
+void vfs_iref(struct vfs_inode* inode) { if (inode) inode->refs++; }
+
+void vfs_iput(struct vfs_inode* inode) { if (inode && inode->refs) inode->refs--; }
+
+/* File contents changed: forget anything derived from them. */
+static void inode_changed(struct vfs_inode* n) {
+    if (n->type == FS_DT_REG) elfcache_forget(n->sb->dev, n->ino);
+}
+
+static int is_sep(char c) { return c == '/' || c == '\\'; }
+
+/* Walk path. With want_parent the last component is not looked up but
+   returned through last/last_len, and the containing directory is returned. */
+static struct vfs_inode* walk(const char* path, int want_parent, const char** last, unsigned* last_len) {
+    if (!path) return 0;
+    const char* p;
+    struct vfs_mount_ent* m = find_mount(path, &p);
+    if (!m) return 0;
+    struct vfs_inode* cur = vfs_iget(m->sb, m->sb->root_ino);
+    while (cur) {
+        while (is_sep(*p)) p++;
+        if (!*p) break;
+        const char* comp = p;
+        while (*p && !is_sep(*p)) p++;
+        unsigned len = (unsigned)(p - comp);
+        const char* q = p;
+        while (is_sep(*q)) q++;
+        if (want_parent && !*q) {
+            if (last) *last = comp;
+            if (last_len) *last_len = len;
+            return cur;
+        }
+        if (len == 1 && comp[0] == '.') continue;
+        uint32_t ino;
+        if (cur->type != FS_DT_DIR || !cur->iops || !cur->iops->lookup ||
+            len > 255 || cur->iops->lookup(cur, comp, len, &ino) != 0) {
+            vfs_iput(cur);
+            return 0;
+        }
+        struct vfs_inode* next = vfs_iget(cur->sb, ino);
+        vfs_iput(cur);
+        cur = next;
+    }
+    if (want_parent) { vfs_iput(cur); return 0; } /* path names no entry */
+    return cur;
+}
+
+struct vfs_inode* vfs_lookup(const char* path) { return walk(path, 0, 0, 0); }
+
+static struct vfs_file* file_alloc(struct vfs_inode* inode) {
+    for (int i = 0; i < VFS_MAX_FILES; ++i) {
+        if (!files[i].refs) {
+            files[i].inode = inode;
+            files[i].pos = 0;
+            files[i].refs = 1;
+            return &files[i];
+        }
+    }
+    return 0;
+}
+
+struct vfs_file* vfs_open(const char* path, int flags) {
+    struct vfs_inode* inode = vfs_lookup(path);
+    if (!inode && (flags & VFS_O_CREAT)) {
+        const char* name; unsigned len;
+        struct vfs_inode* dir = walk(path, 1, &name, &len);
+        if (!dir) return 0;
+        uint32_t ino;
+        if (dir->type == FS_DT_DIR && dir->iops && dir->iops->create &&
+            len <= 255 && dir->iops->create(dir, name, len, &ino) == 0) {
+            inode = vfs_iget(dir->sb, ino);
+        }
+        vfs_iput(dir);
+    }
+    if (!inode) return 0;
+    if ((flags & VFS_O_TRUNC) && inode->type == FS_DT_REG && inode->size) {
+        if (!inode->iops || !inode->iops->truncate || inode->iops->truncate(inode) != 0) {
+            vfs_iput(inode);
+            return 0;
+        }
+        pagecache_drop_inode(inode->sb->dev, inode->ino);
+        inode_changed(inode);
+    }
+    return vfs_open_inode(inode);
+}
+
+struct vfs_file* vfs_open_inode(struct vfs_inode* inode) {
+    struct vfs_file* f = file_alloc(inode);
+    if (!f) vfs_iput(inode);
+    return f;
+}
+
+void vfs_file_ref(struct vfs_file* f) { if (f) f->refs++; }
+
+int vfs_close(struct vfs_file* f) {
+    if (!f || !f->refs) return -1;
+    if (--f->refs == 0) {
+        if (f->inode->fops && f->inode->fops->release) f->inode->fops->release(f->inode, f);
+        vfs_iput(f->inode);
+        f->inode = 0;
+    }
+    return 0;
+}
+
+int vfs_read(struct vfs_file* f, void* buf, unsigned len) {
+    if (!f || !f->refs) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type == FS_DT_DIR || !n->fops->read) return -1;
+    int r = n->fops->read(n, f->pos, buf, len);
+    if (r > 0) f->pos += (uint32_t)r;
+    return r;
+}
+
+int vfs_write(struct vfs_file* f, const void* buf, unsigned len) {
+    if (!f || !f->refs) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type == FS_DT_DIR || !n->fops->write) return -1;
+    int r = n->fops->write(n, f->pos, buf, len);
+    if (r > 0) { f->pos += (uint32_t)r; inode_changed(n); }
+    return r;
+}
+
+int vfs_pread(struct vfs_file* f, void* buf, unsigned len, uint32_t off) {
+    if (!f || !f->refs) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type == FS_DT_DIR || n->type == FS_DT_FIFO || !n->fops->read) return -1;
+    return n->fops->read(n, off, buf, len);
+}
+
+int vfs_pwrite(struct vfs_file* f, const void* buf, unsigned len, uint32_t off) {
+    if (!f || !f->refs) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type == FS_DT_DIR || n->type == FS_DT_FIFO || !n->fops->write) return -1;
+    int r = n->fops->write(n, off, buf, len);
+    if (r > 0) inode_changed(n);
+    return r;
+}
+
+int32_t vfs_lseek(struct vfs_file* f, int32_t off, int whence) {
+    if (!f || !f->refs) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type == FS_DT_CHR || n->type == FS_DT_DIR || n->type == FS_DT_FIFO) return -1;
+    int64_t base;
+    switch (whence) {
+        case VFS_SEEK_SET: base = 0; break;
+        case VFS_SEEK_CUR: base = f->pos; break;
+        case VFS_SEEK_END: base = n->size; break;
+        default: return -1;
+    }
+    int64_t pos = base + off;
+    if (pos < 0 || pos > 0x7FFFFFFF) return -1;
+    f->pos = (uint32_t)pos;
+    return (int32_t)pos;
+}
+
+static int vfs_rw_vec(struct vfs_file* f, const struct vfs_iovec* iov, unsigned cnt, int write) {
+    if (!f || !f->refs || !iov || cnt > VFS_IOV_MAX) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type == FS_DT_DIR || (write ? !n->fops->write : !n->fops->read)) return -1;
+    unsigned total = 0;
+    for (unsigned i = 0; i < cnt; ++i) {
+        if (!iov[i].len) continue;
+        int r = write ? n->fops->write(n, f->pos, iov[i].base, iov[i].len)
+                      : n->fops->read(n, f->pos, iov[i].base, iov[i].len);
+        if (r < 0) return total ? (int)total : -1;
+        f->pos += (uint32_t)r;
+        total += (unsigned)r;
+        if (write && r > 0) inode_changed(n);
+        if ((uint32_t)r < iov[i].len) break;
+    }
+    return (int)total;
+}
+
+int vfs_readv(struct vfs_file* f, const struct vfs_iovec* iov, unsigned cnt) {
+    return vfs_rw_vec(f, iov, cnt, 0);
+}
+
+int vfs_writev(struct vfs_file* f, const struct vfs_iovec* iov, unsigned cnt) {
+    return vfs_rw_vec(f, iov, cnt, 1);
+}
+
+int vfs_getdents(struct vfs_file* f, void* buf, unsigned len) {
+    if (!f || !f->refs) return -1;
+    struct vfs_inode* n = f->inode;
+    if (n->type != FS_DT_DIR || !n->fops->getdents) return -1;
+    return n->fops->getdents(n, &f->pos, buf, len);
+}
+
+uint32_t vfs_poll(struct vfs_file* f, struct poll_table* pt) {
+    if (!f || !f->refs) return POLLNVAL;
+    struct vfs_inode* n = f->inode;
+    if (!n->fops->poll) return POLLIN | POLLOUT;
+    return n->fops->poll(n, pt);
+}
+
+int vfs_unlink(const char* path) {
+    const char* name; unsigned len;
+    struct vfs_inode* dir = walk(path, 1, &name, &len);
+    if (!dir) return -1;
+    int rc = -1;
+    uint32_t ino;
+    if (dir->type == FS_DT_DIR && dir->iops && dir->iops->unlink && dir->iops->lookup &&
+        dir->iops->lookup(dir, name, len, &ino) == 0) {
+        /* Refuse while open: backends free the data immediately. */
+        struct vfs_inode* victim = 0;
+        for (int i = 0; i < VFS_MAX_INODES; ++i) {
+            if (inodes[i].valid && inodes[i].sb == dir->sb && inodes[i].ino == ino) victim = &inodes[i];
+        }
+        if (!victim || victim->refs == 0) {
+            rc = dir->iops->unlink(dir, name, len);
+            if (rc == 0) {
+                if (victim) victim->valid = 0;
+                pagecache_drop_inode(dir->sb->dev, ino);
+                elfcache_forget(dir->sb->dev, ino);
+            }
+        }
+    }
+    vfs_iput(dir);
+    return rc;
+}
+
+int vfs_sendfile(struct vfs_file* out, struct vfs_file* in, uint32_t* offset, unsigned count) {
+    if (!out || !in || !out->refs || !in->refs) return -1;
+    struct vfs_inode* src = in->inode;
+    struct vfs_inode* dst = out->inode;
+    if (src->type != FS_DT_REG || !src->fops->get_page || !dst->fops->write) return -1;
+    uint32_t pos = offset ? *offset : in->pos;
+    unsigned done = 0;
+    int failed = 0;
+    while (done < count && pos < src->size) {
+        uint32_t phys = src->fops->get_page(src, pos / PAGECACHE_PAGE_SIZE);
+        if (!phys) { failed = 1; break; }
+        uint32_t off = pos % PAGECACHE_PAGE_SIZE;
+        unsigned n = count - done;
+        if (n > PAGECACHE_PAGE_SIZE - off) n = PAGECACHE_PAGE_SIZE - off;
+        if (n > src->size - pos) n = src->size - pos;
+        /* Hold the frame: writing to a file may evict it from the cache. */
+        pmm_ref_frame(phys);
+        int w = dst->fops->write(dst, out->pos, (const uint8_t*)vmm_phys_to_virt(phys) + off, n);
+        pmm_unref_frame(phys);
+        if (w <= 0) { failed = 1; break; }
+        inode_changed(dst);
+        out->pos += (uint32_t)w;
+        pos += (uint32_t)w;
+        done += (unsigned)w;
+        if ((unsigned)w < n) break;
+    }
+    if (offset) *offset = pos; else in->pos = pos;
+    return (done || !failed) ? (int)done : -1;
+}
@@ -0,0 +1,10 @@
+#ifndef _KERNEL_CONSOLE_H
+#define _KERNEL_CONSOLE_H
+
+struct vfs_file;
+
+/* The console as a VFS file: reads take a keyboard line, writes go to
+   serial and VGA. Shared by the stdin/stdout/stderr descriptors. */
+struct vfs_file* console_file(void);
+
+#endif
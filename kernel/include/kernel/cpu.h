@@ -0,0 +1,25 @@
+#ifndef _KERNEL_CPU_H
+#define _KERNEL_CPU_H
+
+#include <stdint.h>
+
+/* Time-stamp counter; convert with vdso_tsc_per_ms(). */
+static inline uint64_t rdtsc(void) {
+    uint64_t v;
+    __asm__ volatile("rdtsc" : "=A"(v));
+    return v;
+}
+
+/* Disable interrupts, returning EFLAGS to hand back to irq_restore. */
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+/* Re-enable interrupts if they were on when the matching irq_save ran. */
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200) __asm__ volatile("sti" ::: "memory");
+}
+
+#endif
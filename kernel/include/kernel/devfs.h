@@ -0,0 +1,9 @@
+#ifndef _KERNEL_DEVFS_H
+#define _KERNEL_DEVFS_H
+
+struct vfs_super;
+
+/* Return the devfs superblock (/dev/console, /dev/disk). */
+struct vfs_super* devfs_create_super(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _KERNEL_DYNLINK_H
+#define _KERNEL_DYNLINK_H
+
+#include <stdint.h>
+
+/* In-kernel dynamic linker. It plays the part of the PT_INTERP program:
+   after the executable is mapped, its DT_NEEDED libraries are loaded from
+   /lib (text shared through the page cache), data relocations are applied
+   and PLT slots are bound lazily. The first call through a slot lands in
+   a trampoline page that asks the kernel (SYS_dl_resolve) for the target,
+   which is then written into the GOT. */
+
+#define DL_MAX_OBJS    4             /* executable + libraries */
+#define DL_TRAMPOLINE  0x2FFFF000u   /* lazy-binding stub, user read-only */
+#define DL_LIB_BASE    0x30000000u   /* first library's load bias */
+#define DL_LIB_STRIDE  0x01000000u   /* 16 MiB per library */
+#define DL_NAME_MAX    59            /* longest DT_NEEDED soname */
+
+struct dl_object {
+    uint32_t bias;
+    char name[DL_NAME_MAX + 1];      /* soname ("" for the executable) */
+    uint32_t dynamic;
+    uint32_t symtab, strtab, hash;   /* biased user addresses */
+    uint32_t nbucket, nchain;        /* DT_HASH header, checked at link time */
+    uint32_t rel, relsz;
+    uint32_t jmprel, pltrelsz;
+    uint32_t pltgot;
+};
+
+struct dl_state {
+    uint32_t nobjs;
+    struct dl_object objs[DL_MAX_OBJS];
+};
+
+struct process;
+
+/* Link a just-loaded executable whose PT_DYNAMIC is at `dynamic`. Must run
+   with proc current (relocation writes may fault pages in). 0 or -1. */
+int dl_link(struct process* proc, uint32_t dynamic);
+
+/* SYS_dl_resolve: bind the PLT slot at byte offset reloc_off of object
+   obj's DT_JMPREL table; returns the target address or 0. */
+uint32_t dl_resolve(struct process* proc, uint32_t obj, uint32_t reloc_off);
+
+#endif
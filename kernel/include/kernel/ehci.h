@@ -0,0 +1,59 @@
+#ifndef _KERNEL_EHCI_H
+#define _KERNEL_EHCI_H
+
+#include <stdint.h>
+#include <kernel/usb.h>
+
+/* EHCI (USB 2.0) host controller. High-speed devices on the root ports
+   are enumerated here; low- and full-speed ones are handed to the
+   companion UHCI controller, so ehci_init has to run before usb_init.
+   Control and bulk transfers go on the async schedule, interrupt
+   transfers on the periodic one, and all of them complete from the
+   controller's interrupt. Buffers are mapped kernel memory; they are
+   handed to the controller page by page, without copying. */
+
+#define EHCI_MAX_DEVICES 8
+
+struct ehci_pipe;
+
+struct ehci_device {
+    uint8_t  active;
+    uint8_t  port;
+    uint8_t  address;
+    uint8_t  iface_class;       /* first interface of the configuration */
+    uint8_t  iface_subclass;
+    uint8_t  iface_protocol;
+    uint8_t  intr_interval;     /* bInterval of the interrupt IN endpoint */
+    usb_device_descriptor_t desc;
+    struct ehci_pipe* ctrl;
+    struct ehci_pipe* bulk_in;  /* 0 if the interface has none */
+    struct ehci_pipe* bulk_out;
+    struct ehci_pipe* intr_in;
+};
+
+/* Runs from the interrupt handler with the bytes received, or -1 if the
+   endpoint halted (the transfer is then not re-armed). */
+typedef void (*ehci_done_fn)(struct ehci_device* dev, int len, void* arg);
+
+int ehci_init(void);
+
+/* Enumerated device n (0..EHCI_MAX_DEVICES-1), or 0. */
+struct ehci_device* ehci_device(int n);
+
+/* Synchronous control transfer on endpoint 0; data may be 0 when
+   wLength is 0. Returns the bytes moved or -1. */
+int ehci_control(struct ehci_device* dev, const usb_device_request_t* req, void* data);
+
+/* Synchronous bulk transfer on the device's bulk IN (ep has 0x80 set) or
+   OUT endpoint, up to about 1 MiB. Returns the bytes moved or -1; an IN
+   transfer ends early on a short packet. */
+int ehci_bulk(struct ehci_device* dev, uint8_t ep, void* buf, uint32_t len);
+
+/* Poll the interrupt IN endpoint at its bInterval into buf (at most
+   16 KiB); fn runs on every completion until the endpoint halts. */
+int ehci_interrupt_start(struct ehci_device* dev, void* buf, uint16_t len, ehci_done_fn fn, void* arg);
+
+/* Controller, port and device summary. */
+void ehci_dump(void);
+
+#endif
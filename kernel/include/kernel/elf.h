@@ -4,7 +4,21 @@
 #include <stdint.h>
 
 /* Minimal ELF32 types */
-#define PT_LOAD 1
+#define PT_LOAD    1
+#define PT_DYNAMIC 2
+#define PT_INTERP  3
+
+/* e_type */
+#define ET_EXEC 2
+#define ET_DYN  3
+
+/* Most program headers an executable may have. */
+#define ELF_MAX_PHDRS 16
+
+/* p_flags */
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
 
 typedef struct {
     unsigned char e_ident[16];
@@ -34,9 +48,61 @@ typedef struct {
     uint32_t p_align;
 } Elf32_Phdr;
 
+typedef struct {
+    int32_t  d_tag;
+    uint32_t d_val;        /* d_val or d_ptr */
+} Elf32_Dyn;
+
+#define DT_NULL     0
+#define DT_NEEDED   1
+#define DT_PLTRELSZ 2
+#define DT_PLTGOT   3
+#define DT_HASH     4
+#define DT_STRTAB   5
+#define DT_SYMTAB   6
+#define DT_REL      17
+#define DT_RELSZ    18
+#define DT_JMPREL   23
+
+typedef struct {
+    uint32_t st_name;
+    uint32_t st_value;
+    uint32_t st_size;
+    unsigned char st_info;
+    unsigned char st_other;
+    uint16_t st_shndx;
+} Elf32_Sym;
+
+#define STB_GLOBAL 1
+#define STB_WEAK   2
+#define ELF32_ST_BIND(i) ((i) >> 4)
+
+typedef struct {
+    uint32_t r_offset;
+    uint32_t r_info;
+} Elf32_Rel;
+
+#define ELF32_R_SYM(i)  ((i) >> 8)
+#define ELF32_R_TYPE(i) ((uint8_t)(i))
+
+#define R_386_32       1
+#define R_386_GLOB_DAT 6
+#define R_386_JMP_SLOT 7
+#define R_386_RELATIVE 8
+
 /* Load first multiboot module (ELF32) into user space and enter it. */
 int elf_run_first_module(void);
 int elf_run_module_by_name(const char* name);
+/* Stream an ELF from the VFS into user space and run it; any size. */
 int elf_run_from_filesystem(const char* path);
+/* TSC cycles the last elf_run_from_filesystem spent loading the image. */
+uint64_t elf_last_load_cycles(void);
+
+struct process;
+/* Map a shared object (ET_DYN) into proc at load bias `bias`, sharing its
+   whole pages through the page cache like an executable. Returns the
+   biased address of its PT_DYNAMIC segment (0 if it has none) or
+   0xFFFFFFFF on failure. */
+uint32_t elf_load_library(struct process* proc, const char* path, uint32_t bias);
 
 #endif
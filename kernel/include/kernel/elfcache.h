@@ -0,0 +1,45 @@
+#ifndef _KERNEL_ELFCACHE_H
+#define _KERNEL_ELFCACHE_H
+
+#include <stdint.h>
+#include <kernel/elf.h>
+
+/* Validated executable layouts keyed by (device, inode, mtime, size), so a
+   repeat exec of an unchanged file skips reading and checking its headers.
+   The VFS forgets an inode's entry whenever the file is written, truncated
+   or unlinked. */
+
+#define ELFCACHE_MAX 16
+
+struct elf_image {
+    uint16_t type;                    /* ET_EXEC or ET_DYN */
+    uint16_t interp;                  /* has PT_INTERP */
+    uint32_t dynamic;                 /* PT_DYNAMIC p_vaddr, 0 if static */
+    uint32_t entry;
+    uint32_t nsegs;                   /* PT_LOAD entries with p_memsz != 0 */
+    uint32_t file_bytes;              /* sum of p_filesz */
+    uint32_t bss_bytes;               /* sum of p_memsz - p_filesz */
+    Elf32_Phdr segs[ELF_MAX_PHDRS];
+};
+
+struct elfcache_stats {
+    uint32_t entries;
+    uint32_t capacity;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t stale;                   /* entries dropped because the file changed */
+};
+
+struct vfs_inode;
+
+/* Copy the cached layout of inode into out; 0 on a hit, -1 on a miss. */
+int  elfcache_lookup(struct vfs_inode* inode, struct elf_image* out);
+/* Remember a freshly validated layout (replaces the least recently used). */
+void elfcache_insert(struct vfs_inode* inode, const struct elf_image* img);
+/* Drop the entry for (dev, ino), if any. */
+void elfcache_forget(uint32_t dev, uint32_t ino);
+/* Drop everything (benchmarks use this to measure a cold exec). */
+void elfcache_flush(void);
+void elfcache_get_stats(struct elfcache_stats* out);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _KERNEL_FDTABLE_H
+#define _KERNEL_FDTABLE_H
+
+#include <stdint.h>
+
+/* Per-process file descriptor table. Slots point at shared VFS open files
+   (each slot holds one reference). A bitmap tracks used slots so the lowest
+   free descriptor is found a word at a time; the table starts with inline
+   storage and doubles on demand up to FDT_MAX. */
+
+#define FDT_INLINE 32
+#define FDT_MAX    1024
+
+struct vfs_file;
+
+struct fd_table {
+    uint32_t size;              /* slots available (multiple of 32) */
+    uint32_t count;             /* descriptors in use */
+    uint32_t hint;              /* lowest bitmap word that may have a free bit */
+    struct vfs_file** files;
+    uint32_t* used;
+    struct vfs_file* inline_files[FDT_INLINE];
+    uint32_t inline_used[FDT_INLINE / 32];
+};
+
+/* Empty table with the console on fds 0, 1 and 2. */
+void fdt_init(struct fd_table* t);
+
+/* Install f at the lowest free descriptor (takes over the caller's
+   reference); returns the fd or -1 when the table is full. */
+int fdt_alloc(struct fd_table* t, struct vfs_file* f);
+
+struct vfs_file* fdt_get(struct fd_table* t, int fd);
+int  fdt_close(struct fd_table* t, int fd);
+void fdt_close_all(struct fd_table* t);
+
+/* fork: dst (freshly initialised) becomes a copy of src, sharing files. */
+int fdt_clone(struct fd_table* dst, const struct fd_table* src);
+
+#endif
@@ -3,9 +3,31 @@
 
 #include <stdint.h>
 
+/* Directory entry types reported in fs_dirent.d_type (ext2 file_type codes). */
+#define FS_DT_UNKNOWN 0
+#define FS_DT_REG     1
+#define FS_DT_DIR     2
+#define FS_DT_CHR     3
+#define FS_DT_BLK     4
+#define FS_DT_FIFO    5
+#define FS_DT_SOCK    6
+#define FS_DT_LNK     7
+
+/* Fixed-layout record produced by fs_getdents / SYS_getdents. Records are
+   packed back to back; d_reclen is the 4-byte aligned size of this record and
+   d_off is the cookie of the entry that follows it. */
+struct fs_dirent {
+    uint32_t d_ino;
+    uint32_t d_off;
+    uint16_t d_reclen;
+    uint8_t  d_type;
+    uint8_t  d_namlen;
+    char     d_name[];   /* NUL terminated */
+};
+
 void fs_init(void);
 
-/* Open a file by name; returns fd >= 0 or -1. */
+/* Open a file or directory by path; returns fd >= 0 or -1. */
 int fs_open(const char* name);
 
 /* Read up to len bytes from fd into buf; returns bytes read or -1. */
@@ -13,11 +35,50 @@ int fs_read(int fd, void* buf, unsigned len);
 /* Write up to len bytes to fd from buf; returns bytes written or -1. */
 int fs_write(int fd, const void* buf, unsigned len);
 
+/* Read/write at byte offset off, leaving the fd position alone. */
+int fs_pread(int fd, void* buf, unsigned len, uint32_t off);
+int fs_pwrite(int fd, const void* buf, unsigned len, uint32_t off);
+
+/* Reposition fd (whence is VFS_SEEK_*); returns the new offset or -1. */
+int fs_lseek(int fd, int32_t off, int whence);
+
+/* Scatter/gather I/O at the fd position over cnt segments (at most
+   VFS_IOV_MAX); returns bytes moved or -1. */
+struct vfs_iovec;
+int fs_readv(int fd, const struct vfs_iovec* iov, unsigned cnt);
+int fs_writev(int fd, const struct vfs_iovec* iov, unsigned cnt);
+
 /* Close fd; returns 0 or -1. */
 int fs_close(int fd);
 
-/* List files (print to console). */
-void fs_list_print(void);
+/* Fill buf with fs_dirent records from a directory fd, resuming at the fd's
+   cookie; returns bytes produced, 0 at end of directory, or -1. */
+int fs_getdents(int fd, void* buf, unsigned len);
+
+/* Create (or truncate) a regular file and open it; returns fd or -1. */
+int fs_create(const char* name);
+
+/* Move up to count bytes from file in_fd to out_fd (a file or the console)
+   inside the kernel. Reads at *offset and advances it, or uses and advances
+   in_fd's position when offset is 0. Returns bytes moved, 0 at EOF, or -1. */
+int fs_sendfile(int out_fd, int in_fd, uint32_t* offset, unsigned count);
+
+/* Create a pipe: fds[0] reads, fds[1] writes. Returns 0 or -1. */
+int fs_pipe(int fds[2]);
+
+/* Remove a regular file that nobody has open; returns 0 or -1. */
+int fs_unlink(const char* name);
+
+/* VFS open file behind fd (for mmap and friends); 0 if fd is not open. */
+struct vfs_file;
+struct vfs_file* fs_get_file(int fd);
+
+/* 1 if reads or writes on fd can sleep (pipes, terminals): the file
+   implements poll. */
+int fs_may_block(int fd);
+
+/* List a directory (print to console). */
+void fs_list_print(const char* path);
 
 /* Dump file names into buf separated by '\n'; returns bytes written. */
 int fs_dump_list(char* buf, unsigned len);
@@ -43,6 +43,11 @@ struct TssEntry {
 /* Set esp0 for ring transitions */
 void tss_set_kernel_stack(uint32_t esp0);
 
+/* Point the SYSENTER MSRs at the fast system call entry (the int 0x80 gate
+   stays). Returns 0, or -1 if the CPU has no SYSENTER. */
+int sysenter_init(void);
+int sysenter_enabled(void);
+
 /**
  * @brief Initializes and loads the GDT.
  */
@@ -0,0 +1,41 @@
+#ifndef _KERNEL_GRANT_H
+#define _KERNEL_GRANT_H
+
+#include <stdint.h>
+
+/* Page grants: a sender lends a page range to another process without
+   copying. grant_create pins the frames behind [addr, addr+len); the
+   receiver's grant_map installs those same frames in its mmap window.
+   A read-only grant leaves the sender its pages and maps them read-only
+   for the receiver until either side revokes. A transfer grant unmaps the
+   pages from the sender at once and gives them to the receiver, writable,
+   when mapped; revoking it before then hands them back.
+
+   Every process shares the one page directory today (fork does not copy
+   it), so both sides are edited through the active directory. */
+
+#define GRANT_MAX        16
+#define GRANT_MAX_PAGES  1024u          /* 4 MiB; the frame list fills one page */
+
+#define GRANT_RO    0x0
+#define GRANT_MOVE  0x1
+
+struct process;
+
+/* Pin len bytes at page-aligned addr of proc for process to_pid (0: any).
+   A transfer needs private, writable, present pages. Returns the grant
+   id (>= 1) or -1. */
+int grant_create(struct process* proc, uint32_t addr, uint32_t len, int to_pid, uint32_t flags);
+
+/* Map grant id into proc; returns the address or (uint32_t)-1. A
+   transfer grant is used up by this. */
+uint32_t grant_map(struct process* proc, int id);
+
+/* Sender or receiver: unmap the receiver's view (read-only), or return
+   the pages to the sender (transfer not yet mapped), and drop the grant. */
+int grant_revoke(struct process* proc, int id);
+
+/* Process teardown: revoke or drop every grant proc is part of. */
+void grant_release(struct process* proc);
+
+#endif
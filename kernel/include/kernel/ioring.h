@@ -0,0 +1,78 @@
+#ifndef _KERNEL_IORING_H
+#define _KERNEL_IORING_H
+
+#include <stdint.h>
+
+/* Submission/completion rings shared with user space. The process fills
+   submission entries and bumps sq_tail, then calls SYS_io_enter; the kernel
+   consumes entries from sq_head and posts one completion per entry at
+   cq_tail. The process reaps completions by advancing cq_head. Every field
+   of the header and both entry arrays live in pages mapped into the caller. */
+
+#define IO_RING_MAX_ENTRIES 256   /* submission entries; the CQ is twice that */
+#define IO_RING_MAX         8     /* rings system-wide */
+
+/* Submission opcodes */
+#define IO_OP_NOP    0
+#define IO_OP_READ   1
+#define IO_OP_WRITE  2
+#define IO_OP_FSYNC  3
+
+/* io_sqe.off value meaning "at the file position, and advance it". */
+#define IO_OFF_CURRENT 0xFFFFFFFFu
+
+/* io_enter flags */
+#define IO_ENTER_GETEVENTS 0x1
+
+struct io_ring_hdr {
+    volatile uint32_t sq_head;     /* kernel-owned */
+    volatile uint32_t sq_tail;     /* user-owned */
+    volatile uint32_t cq_head;     /* user-owned */
+    volatile uint32_t cq_tail;     /* kernel-owned */
+    uint32_t sq_entries;           /* power of two */
+    uint32_t cq_entries;
+    uint32_t sqes_off;             /* byte offsets from the ring base */
+    uint32_t cqes_off;
+    volatile uint32_t cq_overflow; /* SQEs left unconsumed because the CQ was full */
+    uint32_t reserved[7];
+};
+
+struct io_sqe {
+    uint8_t  opcode;
+    uint8_t  flags;
+    uint16_t reserved;
+    int32_t  fd;
+    uint32_t off;                  /* byte offset or IO_OFF_CURRENT */
+    uint32_t addr;                 /* user buffer */
+    uint32_t len;
+    uint32_t user_data;            /* copied to the completion */
+    uint32_t pad[2];
+};
+
+struct io_cqe {
+    uint32_t user_data;
+    int32_t  res;                  /* bytes transferred, 0, or -1 */
+};
+
+/* Filled by SYS_io_setup. */
+struct io_ring_params {
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t ring_addr;            /* user address of struct io_ring_hdr */
+    uint32_t ring_size;
+};
+
+struct process;
+
+/* Create a ring with `entries` submission slots (rounded up to a power of
+   two) mapped into proc; returns the ring id or -1. */
+int io_ring_setup(struct process* proc, uint32_t entries, struct io_ring_params* params);
+
+/* Consume up to to_submit SQEs and post their completions. Returns the
+   number of SQEs consumed or -1. */
+int io_ring_enter(struct process* proc, int ring, uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+/* Forget the rings owned by pid (its pages go with the address space). */
+void io_ring_release(int pid);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef _KERNEL_IPC_H
+#define _KERNEL_IPC_H
+
+#include <stdint.h>
+#include <kernel/sched.h>
+
+/* Synchronous message passing in the L4 style. A server thread parks on
+   its endpoint in ipc_wait/ipc_reply_wait; a call copies the short message
+   into the endpoint and switches straight to that thread, which answers
+   by switching straight back. Neither direction goes through select_next,
+   and the whole round trip runs with interrupts off. The caller's HTAS
+   intent travels with the message and sets the server's priority while it
+   works on the call. */
+
+#define IPC_MAX_ENDPOINTS 8
+#define IPC_MSG_WORDS     4
+#define IPC_EP_ECHO       1     /* built-in echo server (ipcbench) */
+
+struct ipc_msg {
+    uint32_t w[IPC_MSG_WORDS];  /* from user space: ecx, edx, esi, edi */
+    uint32_t intent;            /* caller's task_intent_t, set by ipc_call */
+};
+
+/* Returns the endpoint id (>= 1) or -1. */
+int ipc_endpoint_create(const char* name);
+
+/* Create the server thread for ep and run it until its first ipc_wait.
+   fn gets the endpoint id as its argument. Returns the thread id or -1. */
+int ipc_server_start(int ep, kthread_fn fn, const char* name);
+
+/* Send msg to ep's server and block for the reply, which overwrites msg.
+   Returns 0, or -1 if there is no such endpoint or its server is not
+   waiting (busy, or never started). */
+int ipc_call(int ep, struct ipc_msg* msg);
+
+/* Server side, only from ep's server thread. ipc_wait blocks until the
+   next call arrives; ipc_reply_wait answers the current call with reply
+   and then does the same, in one switch. */
+void ipc_wait(int ep, struct ipc_msg* next);
+void ipc_reply_wait(int ep, const struct ipc_msg* reply, struct ipc_msg* next);
+
+/* Start the built-in servers. Call once, after sched_init and before
+   interrupts are enabled. */
+void ipc_init(void);
+void ipc_dump(void);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef _KERNEL_IRQ_H
+#define _KERNEL_IRQ_H
+
+#include <stdint.h>
+
+/* Hardware interrupt lines for drivers. PCI lines may be shared, so every
+   handler hooked on a line runs; each reads its own device status and
+   returns nonzero if the interrupt was its device's. */
+
+#define IRQ_LINES       16
+#define IRQ_MAX_SHARED  4
+
+typedef int (*irq_fn)(void);
+
+/* Attach fn to line irq (0-15) and unmask it. 0, or -1 if the line is
+   full. Handlers on line 0 run on every timer tick. */
+int irq_register(uint8_t irq, irq_fn fn);
+
+#endif
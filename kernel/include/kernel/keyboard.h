@@ -22,5 +22,8 @@ enum {
 void keyboard_init(void);
 void keyboard_on_scancode(uint8_t sc);
 int  kbd_getch(void);      /* returns -1 if none; ASCII or KEY_* above */
+int  kbd_available(void);
+/* Woken from the IRQ whenever a key is queued. */
+struct wait_queue* kbd_waitq(void);
 
 #endif
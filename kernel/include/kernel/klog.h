@@ -0,0 +1,60 @@
+#ifndef _KERNEL_KLOG_H
+#define _KERNEL_KLOG_H
+
+#include <stdint.h>
+
+/* Kernel log. klog() formats a record into a ring and returns; nothing
+   touches the consoles on the way. A kernel thread copies new records to
+   VGA and serial when the system goes idle (the shell waiting for a key,
+   a syscall sleeping on a wait queue). Errors and warnings are the
+   exception: they flush the ring on the spot so they are never late.
+   `dmesg` shows the whole ring with timestamps. */
+
+#define KLOG_ERR   0
+#define KLOG_WARN  1
+#define KLOG_INFO  2
+#define KLOG_DEBUG 3
+
+/* Subsystems, each with its own enable flag. */
+enum klog_subsys {
+    KLOG_CORE,
+    KLOG_MM,
+    KLOG_PROC,
+    KLOG_FS,
+    KLOG_ELF,
+    KLOG_BLOCK,
+    KLOG_USB,
+    KLOG_NSUBSYS
+};
+
+#define KLOG_RING   512             /* records; a power of two */
+#define KLOG_TEXT   116             /* longer messages are cut */
+
+struct klog_stats {
+    uint32_t records;       /* logged since boot */
+    uint32_t dropped;       /* overwritten before they reached the console */
+    uint32_t deferred;      /* written out by the log thread */
+    uint32_t drain_ticks;   /* PIT ticks the log thread spent on output */
+    uint64_t drain_cycles;
+};
+
+/* Safe from any context, interrupts on or off. */
+void klog(int subsys, int level, const char* fmt, ...);
+
+/* Start the log thread; needs sched_init. Records logged before are kept. */
+void klog_init(void);
+/* At idle points: run the log thread if records are waiting. */
+void klog_idle(void);
+/* Write out everything pending now, in the caller's context (panic). */
+void klog_flush(void);
+
+/* Print the ring, records up to level. */
+void klog_dmesg(int level);
+/* Record subsys at all (name as shown by klog_print_config). 0 or -1. */
+int  klog_enable(const char* name, int on);
+/* Highest level copied to the consoles (the ring keeps everything). */
+void klog_set_console_level(int level);
+void klog_get_stats(struct klog_stats* out);
+void klog_print_config(void);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef _KERNEL_MMAP_H
+#define _KERNEL_MMAP_H
+
+#include <stdint.h>
+
+/* User mappings in the mmap window. File-backed pages are not populated
+   at mmap() time; the page-fault handler faults them in from the page
+   cache on first touch. Shared memory and page grants record anonymous
+   areas (no inode) whose frames they install themselves. */
+
+#define PROT_READ   0x1
+#define PROT_WRITE  0x2
+#define PROT_EXEC   0x4
+
+#define MAP_SHARED  0x01
+#define MAP_PRIVATE 0x02
+#define MAP_FIXED   0x10
+#define VMA_PINNED  0x100   /* vm_area only: shm/grant frames, munmap refuses */
+
+#define MAP_FAILED  0xFFFFFFFFu
+
+/* Window handed out when the caller does not ask for an address. */
+#define MMAP_BASE   0x40000000u
+#define MMAP_LIMIT  0xB0000000u
+#define MMAP_USER_TOP 0xC0000000u  /* MAP_FIXED may go anywhere below the kernel */
+
+#define PROC_MAX_VMAS 16
+
+struct vm_area {
+    uint32_t start, end;   /* page aligned, end exclusive; start == end: unused */
+    uint32_t prot;
+    uint32_t flags;
+    struct vfs_inode* inode; /* backing file (referenced); 0: anonymous */
+    uint32_t pgoff;        /* file page index mapped at start */
+};
+
+/* SYS_mmap argument block (six arguments do not fit the register ABI). */
+struct mmap_args {
+    uint32_t addr;
+    uint32_t len;
+    uint32_t prot;
+    uint32_t flags;
+    int      fd;
+    uint32_t offset;       /* must be page aligned */
+};
+
+struct process;
+struct vfs_inode;
+
+/* Record a file mapping of [start, end) at file page pgoff without checking
+   the range (the caller owns it); takes an inode reference. With inode 0
+   the area is anonymous and the caller maps its frames. 0 or -1. */
+int mmap_add_vma(struct process* proc, uint32_t start, uint32_t end, uint32_t prot, uint32_t flags,
+                 struct vfs_inode* inode, uint32_t pgoff);
+/* Forget the area starting at start; its pages are left to the caller. */
+void mmap_remove_vma(struct process* proc, uint32_t start);
+/* Reserve len bytes (page multiple) of free address space in the mmap
+   window of the current address space; returns the start or (uint32_t)-1. */
+uint32_t mmap_find_range(struct process* proc, uint32_t len);
+/* Returns the mapped address or (uint32_t)-1. */
+uint32_t mmap_map(struct process* proc, const struct mmap_args* args);
+/* Unmap whole mappings starting at addr; returns 0 or -1. VMA_PINNED
+   areas are skipped (shm_unmap and grant_revoke own them). */
+int mmap_unmap(struct process* proc, uint32_t addr, uint32_t len);
+/* fork: take references on the inodes behind the copied mappings. */
+void mmap_fork(struct process* child);
+/* Process teardown: forget all mappings (pages go with the address space). */
+void mmap_release(struct process* proc);
+/* Called from the page-fault handler; 0 when the fault was resolved,
+   MMAP_FAULT_SIGBUS for a mapped page past end of file, -1 otherwise. */
+#define MMAP_FAULT_SIGBUS (-2)
+#define MMAP_SIGBUS_EXIT  135      /* exit status of a process killed by it (128 + SIGBUS) */
+int mmap_handle_fault(uint32_t addr, uint32_t err_code);
+
+#endif
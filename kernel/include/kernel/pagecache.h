@@ -0,0 +1,51 @@
+#ifndef _KERNEL_PAGECACHE_H
+#define _KERNEL_PAGECACHE_H
+
+#include <stdint.h>
+
+/* Unified page cache: file data cached in whole physical frames keyed by
+   (device, inode, page index). read() copies out of these frames and mmap()
+   maps them directly, so every reader of a file shares one copy. */
+
+#define PAGECACHE_PAGE_SIZE 4096u
+
+struct vfs_inode;
+
+/* Fill one page of file data (zero the tail past EOF); 0 on success. */
+typedef int (*pagecache_fill_t)(struct vfs_inode* inode, uint32_t index, void* page);
+
+struct pagecache_stats {
+    uint32_t pages;      /* pages currently cached */
+    uint32_t pinned;     /* pages that are the only copy (tmpfs) */
+    uint32_t capacity;   /* pool size */
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+};
+
+/* Look up (ino, index), filling it on a miss. Returns the frame's physical
+   address or 0 on failure. The cache keeps its own reference; a caller that
+   holds on to the frame (e.g. a user mapping) must pmm_ref_frame() it before
+   the next pagecache call, which may evict unreferenced pages. */
+uint32_t pagecache_get(struct vfs_inode* inode, uint32_t index, pagecache_fill_t fill);
+
+/* Frame of (ino, index) if it is already cached, else 0; never does I/O
+   and does not count as a hit or miss. Same reference rules as above. */
+uint32_t pagecache_peek(struct vfs_inode* inode, uint32_t index);
+
+/* Write-through hook: patch a cached page (if present) after a file write. */
+void pagecache_update(struct vfs_inode* inode, uint32_t index, uint32_t offset, const void* src, uint32_t len);
+
+/* Exempt a cached page from eviction: the cache holds the only copy.
+   Fails once a quarter of the pool is all that is left unpinned. */
+int pagecache_pin(struct vfs_inode* inode, uint32_t index);
+
+/* Drop the pages of one file (unlink/truncate), pinned ones included. */
+void pagecache_drop_inode(uint32_t dev, uint32_t ino);
+
+/* Drop every page of a device (e.g. when it is remounted). */
+void pagecache_invalidate_dev(uint32_t dev);
+
+void pagecache_get_stats(struct pagecache_stats* out);
+
+#endif
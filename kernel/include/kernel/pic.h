@@ -14,5 +14,10 @@
 
 void pic_remap(void);
 void pic_send_eoi(uint8_t irq);
+/* Let irq (0-15) through; a slave line also opens the cascade. */
+void pic_unmask(uint8_t irq);
+/* IRQ 7/15 with nothing in service: a spurious interrupt, not to be EOId
+   on its own PIC. Returns 1 if so. */
+int  pic_spurious(uint8_t irq);
 
 #endif
@@ -0,0 +1,21 @@
+#ifndef _KERNEL_PIPE_H
+#define _KERNEL_PIPE_H
+
+#include <stdint.h>
+
+/* Anonymous pipes: a one-page ring buffer between a read end and a write
+   end, each an ordinary open file. Readers sleep while the ring is empty
+   and a writer remains; writers sleep while it is full and a reader
+   remains. A read of whole pages into page-aligned private memory takes the
+   ring's frame instead of copying it (page flip). */
+
+#define PIPE_MAX   16
+#define PIPE_SIZE  4096u
+#define PIPE_BUF   512u   /* room a write end needs to report POLLOUT */
+
+struct vfs_file;
+
+/* Create a pipe; *rd and *wr receive referenced open files. 0 or -1. */
+int pipe_create(struct vfs_file** rd, struct vfs_file** wr);
+
+#endif
@@ -11,5 +11,11 @@ uint32_t pmm_alloc_frame(void);
 /* Allocate a physical frame below a max physical address (e.g., 4 MiB) */
 uint32_t pmm_alloc_frame_below(uint32_t max_phys);
 void pmm_free_frame(uint32_t frame_phys);
+/* Reference counting for frames shared between several owners (page cache,
+   user mappings). An allocated frame starts with one reference; unref frees
+   the frame when the last reference goes away. */
+void pmm_ref_frame(uint32_t frame_phys);
+void pmm_unref_frame(uint32_t frame_phys);
+uint32_t pmm_frame_refs(uint32_t frame_phys);
 
 #endif
@@ -0,0 +1,48 @@
+#ifndef _KERNEL_POLL_H
+#define _KERNEL_POLL_H
+
+#include <stdint.h>
+#include <kernel/waitq.h>
+
+/* Readiness bits for struct pollfd events/revents. */
+#define POLLIN   0x001
+#define POLLOUT  0x004
+#define POLLERR  0x008   /* always reported */
+#define POLLHUP  0x010   /* always reported */
+#define POLLNVAL 0x020   /* fd not open; always reported */
+
+#define POLL_MAX_FDS      64
+#define POLL_WAITS_PER_FD 2   /* wait queues one file's poll op may register */
+
+struct pollfd {
+    int32_t fd;
+    int16_t events;
+    int16_t revents;
+};
+
+struct poll_entry {
+    struct waiter w;
+    struct wait_queue* q;
+};
+
+/* Collects the wait queues of the sources being polled. A file's poll op
+   reports its current readiness and calls poll_wait for each queue whose
+   wake-up could change it. The table and its entries live on the polling
+   caller's stack, like any other waiter. */
+struct poll_table {
+    volatile uint32_t woken;
+    uint32_t nwait, max;
+    uint32_t key;          /* events asked of the file being scanned */
+    uint8_t  overflow;     /* ran out of slots: rescan on every interrupt */
+    struct poll_entry* ent;
+};
+
+/* pt may be 0 (a plain readiness check). */
+void poll_wait(struct poll_table* pt, struct wait_queue* q);
+
+/* Wait until one of fds is ready, timeout_ms passes (-1: forever, 0: just
+   check) or the call is woken. Fills revents; returns how many fds have a
+   non-zero revents, 0 on timeout, or -1. */
+int fs_poll(struct pollfd* fds, uint32_t nfds, int32_t timeout_ms);
+
+#endif
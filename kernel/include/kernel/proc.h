@@ -15,6 +15,8 @@ int proc_last_exit_code(void);
 
 /* Helper: run user entry and wait until it calls SYS_exit, then return exit code. */
 int run_user_and_wait(void* entry, uint32_t user_stack_top);
+/* Same, for a process created (and possibly given mappings) by the caller. */
+int run_process_and_wait(int pid, void* entry, uint32_t user_stack_top);
 
 /* Force immediate switch to saved kernel stack and resume point (noreturn). */
 void proc_switch_to_kernel_now(void) __attribute__((noreturn));
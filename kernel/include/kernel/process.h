@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 #include <kernel/idt.h>  /* for struct registers */
+#include <kernel/mmap.h> /* for struct vm_area */
+#include <kernel/fdtable.h>
+#include <kernel/dynlink.h>
 
 /* Forward declaration for HTAS */
 typedef struct htas_task_info htas_task_info_t;
@@ -35,6 +38,12 @@ typedef struct process {
     proc_context_t context; // Saved user registers
     int exit_code;          // Exit code when zombie
     uint32_t brk;           // Current program break for sbrk/brk
+    struct vm_area vmas[PROC_MAX_VMAS]; // File mappings (mmap)
+    uint32_t mmap_next;     // Next address to hand out in the mmap window
+    struct fd_table fdt;    // Open file descriptors
+    struct dl_state dl;     // Dynamic objects for lazy PLT binding
+    uint32_t sys_stats_phys; // Frame holding this process's syscall counters
+    uint8_t traced;         // Log syscalls to the trace ring (inherited by fork)
     
     /* HTAS scheduler extensions */
     htas_task_info_t* htas_info;  // Task profile and statistics
@@ -13,6 +13,12 @@ typedef void (*kthread_fn)(void*);
 
 void sched_init(void);
 int  kthread_create(kthread_fn fn, void* arg, const char* name);
+/* Created blocked: only runs once someone sched_switch_to()s it. */
+int  kthread_create_blocked(kthread_fn fn, void* arg, const char* name);
+int  sched_current(void);
+int  sched_get_priority(int pid);
+/* Block the current thread and run the blocked thread tid right away. */
+void sched_switch_to(int tid);
 int  sched_set_priority(int pid, int priority);
 void sched_yield(void);
 void sched_tick(void); /* call from timer IRQ */
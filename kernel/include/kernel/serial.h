@@ -4,11 +4,47 @@
 #include <stdint.h>
 
 #define COM1_PORT 0x3F8
+#define COM1_IRQ  4
+
+/* Input clock of the UART; the fastest rate is clock/16. A standard 16550
+   has a 1.8432 MHz crystal (115200 max); boards with faster crystals can
+   override this to allow higher rates. */
+#ifndef SERIAL_UART_CLOCK
+#define SERIAL_UART_CLOCK 1843200u
+#endif
+#define SERIAL_DEFAULT_BAUD 115200u
+
+struct serial_stats {
+    uint32_t baud;
+    uint32_t irq_mode;      /* 0 while still polled */
+    uint32_t irqs;
+    uint32_t tx_bytes;
+    uint32_t tx_queued;     /* bytes waiting in the TX ring */
+    uint32_t tx_full;       /* writer found the ring full and pushed by hand */
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;    /* RX ring overflow */
+};
 
 void serial_init(void);
+/* Switch to buffered, interrupt-driven I/O. Needs the IDT and PIC ready. */
+void serial_enable_irq(void);
+void serial_irq(void);
+/* Returns 0, or -1 if the rate is not reachable from SERIAL_UART_CLOCK. */
+int  serial_set_baud(uint32_t baud);
+uint32_t serial_get_baud(void);
 void serial_putchar(char c);
 void serial_writestring(const char* s);
+/* Wait for queued output to leave the UART (before halt, reset, panic). */
+void serial_flush(void);
 int  serial_available(void);
 int  serial_getchar(void); /* returns -1 if no data */
+void serial_get_stats(struct serial_stats* out);
+
+/* For blocking and poll: bytes the TX ring can take before a writer would
+   spin, and the queues the IRQ wakes when input arrives / output drains. */
+struct wait_queue;
+uint32_t serial_tx_room(void);
+struct wait_queue* serial_rx_waitq(void);
+struct wait_queue* serial_tx_waitq(void);
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef _KERNEL_SHM_H
+#define _KERNEL_SHM_H
+
+#include <stdint.h>
+
+/* Shared memory segments. A segment is a set of zeroed frames that lives
+   as long as some process holds it; every shm_map maps those same frames
+   writable, so all holders see each other's stores without further
+   syscalls. Segments are found by name or by the id shm_create returns. */
+
+#define SHM_MAX        16
+#define SHM_MAX_ATTACH 32
+#define SHM_NAME_MAX   15
+#define SHM_MAX_PAGES  1024u        /* 4 MiB; the frame list fills one page */
+
+struct process;
+
+/* Open the segment called name, creating it with size bytes if there is
+   none; name 0 or "" always creates an anonymous one. The caller holds the
+   segment until it exits or unmaps it. Returns the id (>= 1) or -1. */
+int shm_create(struct process* proc, const char* name, uint32_t size);
+
+/* Map segment id into proc's mmap window; the address or (uint32_t)-1.
+   A process may map a segment more than once. */
+uint32_t shm_map(struct process* proc, int id);
+
+/* Undo the shm_map that returned addr. The segment is freed when its last
+   holder lets go. Returns 0 or -1. */
+int shm_unmap(struct process* proc, uint32_t addr);
+
+/* Process teardown: drop proc's holds (the mappings go with the address
+   space). */
+void shm_release(struct process* proc);
+
+#endif
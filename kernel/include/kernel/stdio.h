@@ -4,6 +4,7 @@
 
 /* You must include <stdarg.h> to use va_list */
 #include <stdarg.h>
+#include <stddef.h>
 
 /**
  * The public-facing kernel printf function.
@@ -15,4 +16,11 @@ int printf(const char* format, ...);
  */
 int vprintf(const char* format, va_list args);
 
+/**
+ * Format into a buffer, same conversions as printf. Returns the length
+ * the whole output would have had; buf is truncated to size - 1.
+ */
+int vsnprintf(char* buf, size_t size, const char* format, va_list args);
+int snprintf(char* buf, size_t size, const char* format, ...);
+
 #endif
\ No newline at end of file
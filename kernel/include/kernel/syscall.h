@@ -1,6 +1,8 @@
 #ifndef _KERNEL_SYSCALL_H
 #define _KERNEL_SYSCALL_H
 
+#include <stdint.h>
+
 #define SYS_write 1
 #define SYS_exit  2
 #define SYS_read  3
@@ -15,5 +17,85 @@
 #define SYS_wait   11
 #define SYS_getpid 12
 #define SYS_getppid 13
+/* getdents(fd, buf, len): stream struct fs_dirent records from a directory fd. */
+#define SYS_getdents 14
+/* mmap(struct mmap_args*): map a file (read-only or private); returns address or -1. */
+#define SYS_mmap    15
+/* munmap(addr, len): remove the mappings that lie entirely inside the range. */
+#define SYS_munmap  16
+/* creat(path): create or truncate a regular file, open it for writing. */
+#define SYS_creat   17
+/* unlink(path): remove a regular file that is not open. */
+#define SYS_unlink  18
+/* sendfile(out_fd, in_fd, uint32_t* offset, count): in-kernel copy from the
+   page cache; count is passed in esi. */
+#define SYS_sendfile 19
+/* io_setup(entries, struct io_ring_params*): map a submission/completion
+   ring pair into the caller; returns a ring id. */
+#define SYS_io_setup 20
+/* io_enter(ring, to_submit, min_complete, flags): consume queued SQEs and
+   post their CQEs; flags (IO_ENTER_*) are passed in esi. */
+#define SYS_io_enter 21
+/* lseek(fd, off, whence): SEEK_SET 0, SEEK_CUR 1, SEEK_END 2; returns the new offset. */
+#define SYS_lseek   22
+/* pread/pwrite(fd, buf, len, off): off in esi; the fd offset is untouched. */
+#define SYS_pread   23
+#define SYS_pwrite  24
+/* readv/writev(fd, const struct iovec*, iovcnt): at most 64 segments. */
+#define SYS_readv   25
+#define SYS_writev  26
+/* dl_resolve(obj, reloc_off): bind a lazy PLT slot; only the dynamic
+   linker's trampoline page issues it. Returns the target address. */
+#define SYS_dl_resolve 27
+/* batch(struct sys_batch_ent*, count, flags): run up to SYS_BATCH_MAX calls
+   in order in one kernel entry, storing each result in its record.
+   Returns how many ran. exit, fork, wait, poll, ipc_call, io_enter,
+   dl_resolve, batch itself, and I/O on fds that can block (pipes,
+   terminals) are refused with -1. */
+#define SYS_batch   28
+
+#define SYS_BATCH_MAX        256
+#define SYS_BATCH_STOP_ON_ERR 0x1   /* stop after the first negative result */
+
+/* trace(pid, on): log pid's syscalls (0: the caller) to the trace ring.
+   pid must be the caller or one of its children. */
+#define SYS_trace      29
+/* trace_read(struct systrace_rec*, max, uint32_t* cursor): copy trace
+   records from *cursor on; returns how many. */
+#define SYS_trace_read 30
+/* sysstat(pid, struct systrace_stats*): per-call counters and latency
+   histograms of pid (0: the caller, -1: system-wide). */
+#define SYS_sysstat    31
+/* poll(struct pollfd*, nfds, timeout_ms): sleep until an fd is ready, the
+   timeout (ms, -1 forever) passes; see kernel/poll.h. Returns the number
+   of ready fds, 0 on timeout, or -1. */
+#define SYS_poll       32
+/* pipe(int fds[2]): fds[0] the read end, fds[1] the write end of a new
+   pipe (write to it with fwrite). Returns 0 or -1. */
+#define SYS_pipe       33
+/* ipc_call(ep) with the message in ecx, edx, esi, edi: synchronous call to
+   an IPC endpoint (see kernel/ipc.h). The reply comes back in the same
+   four registers; returns 0, or -1 if the server is not waiting. int 0x80
+   only: SYSENTER takes edi for the return address. */
+#define SYS_ipc_call   34
+/* grant(addr, len, to_pid, flags): lend pages to to_pid (0: anyone);
+   GRANT_RO or GRANT_MOVE, see kernel/grant.h. Returns a grant id or -1.
+   grant_map(id) maps it into the caller and returns the address or -1;
+   grant_revoke(id) ends it from either side, returning 0 or -1. */
+#define SYS_grant        35
+#define SYS_grant_map    36
+#define SYS_grant_revoke 37
+/* shm_create(name, size): open or create a shared memory segment (name 0:
+   anonymous), returns its id or -1; shm_map(id) returns the address or
+   -1; shm_unmap(addr) returns 0 or -1. See kernel/shm.h. */
+#define SYS_shm_create   38
+#define SYS_shm_map      39
+#define SYS_shm_unmap    40
+
+struct sys_batch_ent {
+    uint32_t nr;
+    uint32_t args[4];               /* ebx, ecx, edx, esi */
+    int32_t  result;
+};
 
 #endif
@@ -0,0 +1,66 @@
+#ifndef _KERNEL_SYSTRACE_H
+#define _KERNEL_SYSTRACE_H
+
+#include <stdint.h>
+
+/* System call accounting. Every call is counted and its latency (TSC
+   cycles from dispatch to return) added to a log2 histogram, both
+   system-wide and for the calling process. Processes in trace mode also
+   log each entry and exit into a shared ring buffer. */
+
+#define SYSTRACE_NR      64     /* numbers >= this share the last slot */
+#define SYSTRACE_BUCKETS 12     /* <256 cycles, <512, ..., >=256K */
+#define SYSTRACE_RING    512    /* records in the trace log */
+
+struct systrace_stats {
+    uint32_t calls[SYSTRACE_NR];
+    uint64_t cycles[SYSTRACE_NR];
+    uint32_t hist[SYSTRACE_NR][SYSTRACE_BUCKETS];
+};
+
+#define SYSTRACE_ENTER 0
+#define SYSTRACE_EXIT  1
+
+struct systrace_rec {
+    uint32_t seq;
+    int16_t  pid;
+    uint8_t  nr;
+    uint8_t  kind;              /* SYSTRACE_ENTER or SYSTRACE_EXIT */
+    uint32_t args[3];           /* ebx, ecx, edx at entry */
+    int32_t  result;            /* at exit */
+    uint32_t cycles;            /* at exit */
+};
+
+struct process;
+struct registers;
+
+/* Dispatcher hooks; enter returns the TSC value to hand to exit. */
+uint64_t systrace_enter(struct process* p, const struct registers* regs);
+void systrace_exit(struct process* p, uint32_t nr, uint32_t result, uint64_t t0);
+
+/* Trace mode for a process (inherited across fork). 0 or -1. */
+int systrace_set(struct process* p, int on);
+/* Trace the next program started with elf_run_from_filesystem (on = 0
+   cancels). */
+void systrace_arm_exec(int on);
+void systrace_on_exec(struct process* p);
+/* Pid of the last traced process to exit, -1 if none. */
+int systrace_last_pid(void);
+/* Drop a process's counters (process_destroy). */
+void systrace_release(struct process* p);
+
+/* Copy records with seq >= *cursor (oldest still held first); advances
+   *cursor. Returns the number copied. */
+int systrace_read(struct systrace_rec* out, unsigned max, uint32_t* cursor);
+/* Cursor of the next record to be written. */
+uint32_t systrace_cursor(void);
+/* Counters of p, or the system-wide ones for p == 0; 0 if none. */
+const struct systrace_stats* systrace_stats(struct process* p);
+
+const char* systrace_name(uint32_t nr);
+/* Shell views: per-call table (pid < 0: system-wide) and the trace log
+   from cursor `from` on (pid < 0: every process). */
+void systrace_print_stats(int pid);
+void systrace_print_log(int pid, uint32_t from);
+
+#endif
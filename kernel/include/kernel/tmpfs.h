@@ -0,0 +1,9 @@
+#ifndef _KERNEL_TMPFS_H
+#define _KERNEL_TMPFS_H
+
+struct vfs_super;
+
+/* Return the (single) tmpfs superblock, initialising it on first use. */
+struct vfs_super* tmpfs_create_super(void);
+
+#endif
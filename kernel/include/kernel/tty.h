@@ -7,6 +7,9 @@ void terminal_initialize(void);
 void terminal_putchar(char c);
 void terminal_write(const char* data, size_t size);
 void terminal_writestring(const char* data);
+/* Copy rows changed since the last flush to VGA memory. terminal_putchar
+   and terminal_write flush on return. */
+void terminal_flush(void);
 void terminal_clear(void);
 void terminal_scroll_view(int delta);
 void terminal_scroll_to_bottom(void);
@@ -27,6 +27,12 @@
 #define USB_CLASS_HID             0x03
 #define USB_CLASS_HUB             0x09
 
+/* Endpoint address and attribute bits */
+#define USB_EP_DIR_IN             0x80
+#define USB_EP_XFER_MASK          0x03
+#define USB_EP_XFER_BULK          0x02
+#define USB_EP_XFER_INT           0x03
+
 /* HID Subclasses */
 #define USB_HID_SUBCLASS_BOOT     0x01
 
@@ -91,8 +97,7 @@ typedef struct {
     uint16_t length;
 } __attribute__((packed)) usb_device_request_t;
 
-/* USB API */
+/* USB API. Transfers complete on the controller's own interrupt line. */
 int usb_init(void);
-void usb_poll(void);
 
 #endif
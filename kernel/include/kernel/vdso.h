@@ -0,0 +1,41 @@
+#ifndef _KERNEL_VDSO_H
+#define _KERNEL_VDSO_H
+
+#include <stdint.h>
+
+/* Kernel data page mapped read-only into every process, so time and
+   process identity can be read without a trap. One page serves all
+   processes: the pid/ppid/profile fields describe whichever process is
+   current, and only the current process ever runs user code. */
+
+#define VDSO_DATA_ADDR 0x2FFFE000u   /* below the dynamic linker trampoline */
+
+/* Readers: retry while seq is odd or changed across the read. */
+struct vdso_data {
+    volatile uint32_t seq;
+    uint32_t hz;                 /* PIT rate; 0 before the timer is set up */
+    uint32_t ns_per_tick;
+    uint32_t tsc_mult;           /* ns = (cycles * tsc_mult) >> tsc_shift; */
+    uint32_t tsc_shift;          /*   tsc_mult is 0 until calibrated */
+    uint64_t ticks;              /* PIT ticks at the last update */
+    uint64_t tick_tsc;           /* TSC read at that tick */
+    int32_t  pid, ppid;
+    uint32_t htas_intent;        /* task_intent_t; PROFILE_DEFAULT without a hint */
+    uint32_t htas_affinity;      /* allowed simulated CPUs */
+    int32_t  htas_priority_boost;
+    uint32_t reserved[4];
+};
+
+void vdso_init(void);
+/* Timer interrupt: publish the new tick and refresh the TSC scale. */
+void vdso_tick(void);
+/* TSC cycles per millisecond from the timer's calibration. 0 without a
+   timer or before its first full second; never waits. */
+uint32_t vdso_tsc_per_ms(void);
+/* Publish pid, ppid and HTAS profile of the now-current process (0: none). */
+struct process;
+void vdso_set_process(struct process* proc);
+/* Map the page read-only at VDSO_DATA_ADDR in the current address space. */
+int vdso_map(void);
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef _KERNEL_VFS_H
+#define _KERNEL_VFS_H
+
+#include <stdint.h>
+
+/* Virtual filesystem switch. Each mounted filesystem provides a superblock
+   with ops; the VFS keeps the mount table, a pool of in-core inodes shared
+   by every opener, and the open-file objects that fds refer to. */
+
+#define VFS_MAX_MOUNTS  8
+#define VFS_MAX_INODES  128
+#define VFS_MAX_FILES   256
+#define VFS_MOUNT_PATH  32
+
+/* vfs_lseek whence */
+#define VFS_SEEK_SET 0
+#define VFS_SEEK_CUR 1
+#define VFS_SEEK_END 2
+
+/* Most segments a single readv/writev will walk. */
+#define VFS_IOV_MAX  64
+
+/* vfs_open flags */
+#define VFS_O_CREAT  0x1   /* create a regular file if missing */
+#define VFS_O_TRUNC  0x2   /* truncate an existing regular file */
+
+struct vfs_super;
+struct vfs_inode;
+struct vfs_file;
+struct poll_table;
+
+struct vfs_super_ops {
+    /* Fill type, size, mtime and ops of an in-core inode from the store. */
+    int (*read_inode)(struct vfs_super* sb, struct vfs_inode* inode);
+};
+
+/* Namespace operations on directories and size changes. */
+struct vfs_inode_ops {
+    int (*lookup)(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* ino);
+    int (*create)(struct vfs_inode* dir, const char* name, unsigned len, uint32_t* ino);
+    int (*unlink)(struct vfs_inode* dir, const char* name, unsigned len);
+    int (*truncate)(struct vfs_inode* inode);    /* to zero length */
+};
+
+/* Data operations. Offsets are explicit; the open file holds the position. */
+struct vfs_file_ops {
+    int (*read)(struct vfs_inode* inode, uint32_t off, void* buf, unsigned len);
+    int (*write)(struct vfs_inode* inode, uint32_t off, const void* buf, unsigned len);
+    /* Directory streaming; *cookie is opaque to the caller. */
+    int (*getdents)(struct vfs_inode* dir, uint32_t* cookie, void* buf, unsigned len);
+    /* Page-cache frame holding page `index` of the file (for mmap). */
+    uint32_t (*get_page)(struct vfs_inode* inode, uint32_t index);
+    /* POLL* readiness now; registers the wait queues that signal a change
+       with poll_wait(pt, ...). Files without it never block. */
+    uint32_t (*poll)(struct vfs_inode* inode, struct poll_table* pt);
+    /* The last reference to open file f is going away. */
+    void (*release)(struct vfs_inode* inode, struct vfs_file* f);
+};
+
+struct vfs_super {
+    const char* fstype;
+    uint32_t dev;           /* assigned at mount; part of page-cache keys */
+    uint32_t root_ino;
+    const struct vfs_super_ops* ops;
+    void* priv;
+};
+
+struct vfs_inode {
+    struct vfs_super* sb;
+    uint32_t ino;
+    uint32_t size;
+    uint32_t mtime;
+    uint8_t  type;          /* FS_DT_* */
+    uint8_t  valid;
+    uint16_t refs;
+    const struct vfs_inode_ops* iops;
+    const struct vfs_file_ops* fops;
+    void* priv;
+};
+
+struct vfs_file {
+    struct vfs_inode* inode;
+    uint32_t pos;
+    uint32_t refs;          /* fds pointing at this open file */
+};
+
+/* One segment of a readv/writev (same layout as the user struct iovec). */
+struct vfs_iovec {
+    void* base;
+    uint32_t len;
+};
+
+/* Allocate a device id for a new superblock. */
+uint32_t vfs_alloc_dev(void);
+
+/* Attach sb at an absolute path ("/" or "/tmp"). Longest prefix wins. */
+int vfs_mount(const char* path, struct vfs_super* sb);
+
+/* In-core inode cache. iget returns a referenced inode or 0. */
+struct vfs_inode* vfs_iget(struct vfs_super* sb, uint32_t ino);
+void vfs_iref(struct vfs_inode* inode);
+void vfs_iput(struct vfs_inode* inode);
+
+/* Resolve a path to a referenced inode; 0 if not found. */
+struct vfs_inode* vfs_lookup(const char* path);
+
+/* Open-file objects. vfs_close drops one reference. */
+struct vfs_file* vfs_open(const char* path, int flags);
+/* Open-file object for an inode; takes over the caller's reference. */
+struct vfs_file* vfs_open_inode(struct vfs_inode* inode);
+void vfs_file_ref(struct vfs_file* f);
+int  vfs_close(struct vfs_file* f);
+int  vfs_read(struct vfs_file* f, void* buf, unsigned len);
+int  vfs_write(struct vfs_file* f, const void* buf, unsigned len);
+/* Read/write at an explicit offset without moving the file position. */
+int  vfs_pread(struct vfs_file* f, void* buf, unsigned len, uint32_t off);
+int  vfs_pwrite(struct vfs_file* f, const void* buf, unsigned len, uint32_t off);
+/* Reposition the file; returns the new position or -1. Seeking past EOF is
+   allowed, a later write leaves a hole. Character devices and pipes cannot
+   seek. */
+int32_t vfs_lseek(struct vfs_file* f, int32_t off, int whence);
+/* Scatter/gather at the file position, advancing it. Stops at the first
+   short transfer; returns the total moved or -1 if nothing moved. */
+int  vfs_readv(struct vfs_file* f, const struct vfs_iovec* iov, unsigned cnt);
+int  vfs_writev(struct vfs_file* f, const struct vfs_iovec* iov, unsigned cnt);
+int  vfs_getdents(struct vfs_file* f, void* buf, unsigned len);
+/* POLL* readiness of f (see kernel/poll.h); pt may be 0. */
+uint32_t vfs_poll(struct vfs_file* f, struct poll_table* pt);
+int  vfs_unlink(const char* path);
+
+/* Copy up to count bytes of a regular file into out straight from the page
+   cache. Reads at *offset (advancing it) or, when offset is 0, at the input
+   file position. Returns bytes moved, 0 at EOF, or -1. */
+int  vfs_sendfile(struct vfs_file* out, struct vfs_file* in, uint32_t* offset, unsigned count);
+
+#endif
@@ -6,10 +6,34 @@
 #define PAGE_PRESENT 0x001
 #define PAGE_WRITE   0x002
 #define PAGE_USER    0x004
+#define PAGE_LARGE   0x080  /* PDE maps a 4 MiB page (needs CR4.PSE) */
+
+#define PAGE_SIZE    4096u
+
+/* All managed physical memory is mapped here (supervisor only) so the kernel
+   can reach any frame, not just the low identity map that user mappings can
+   shadow. Sized to the PMM cap. */
+#define KERNEL_PHYSMAP_BASE 0xD0000000u
+#define KERNEL_PHYSMAP_SIZE 0x10000000u
+
+static inline void* vmm_phys_to_virt(uint32_t phys) {
+    return (void*)(KERNEL_PHYSMAP_BASE + phys);
+}
 
 void vmm_init(void);
 int  vmm_map(uint32_t virt, uint32_t phys, uint32_t flags);
 int  vmm_unmap(uint32_t virt);
+/* Map n pages at virt to frames[0..n) with one table lookup per 4 MiB;
+   only slots that held a mapping are invalidated. On failure nothing stays
+   mapped and -1 is returned. */
+int  vmm_map_range(uint32_t virt, const uint32_t* frames, uint32_t n, uint32_t flags);
+/* Clear n pages from virt (frame references are the caller's). Up to
+   VMM_FLUSH_PAGES pages are invalidated one by one, more with one CR3
+   reload. */
+#define VMM_FLUSH_PAGES 32u
+void vmm_unmap_range(uint32_t virt, uint32_t n);
 uint32_t vmm_resolve(uint32_t virt);
+/* Read the raw PTE for virt in the active directory (0 if no table). */
+uint32_t vmm_get_pte(uint32_t virt);
 
 #endif
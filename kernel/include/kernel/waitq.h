@@ -0,0 +1,32 @@
+#ifndef _KERNEL_WAITQ_H
+#define _KERNEL_WAITQ_H
+
+#include <stdint.h>
+
+/* Wait queues let a blocked caller sleep until the interrupt handler of the
+   source it cares about signals it. A waiter lives on the sleeper's stack
+   and points at a flag that waitq_wake sets; several waiters (one per
+   source being watched) may share a flag. Only waiters queued on the woken
+   source are touched, so other sleepers stay asleep. */
+
+struct waiter {
+    struct waiter* next;
+    volatile uint32_t* flag;
+};
+
+struct wait_queue {
+    struct waiter* head;
+};
+
+void waitq_add(struct wait_queue* q, struct waiter* w);
+void waitq_remove(struct wait_queue* q, struct waiter* w);
+
+/* Set the flag of every waiter on q. Safe from interrupt handlers. */
+void waitq_wake(struct wait_queue* q);
+
+/* Halt until *flag becomes non-zero or pit_ticks() reaches deadline (0: no
+   deadline). Returns 1 if flagged, 0 on timeout. Interrupts are enabled
+   while asleep and on return, so callers inside a syscall may use it. */
+int waitq_sleep(volatile uint32_t* flag, uint64_t deadline);
+
+#endif
@@ -0,0 +1,164 @@
+#include <kernel/grant.h>
+#include <kernel/process.h>
+#include <kernel/mmap.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+/* A live grant holds one reference on each of its frames. A read-only
+   mapping in the receiver takes one more (dropped by revoke or by the
+   receiver's teardown); a transfer passes the sender's mapping reference
+   to the grant and the grant's to the receiver's mapping. The receiver's
+   view is an anonymous VMA: pinned while the grant can still revoke it,
+   ordinary private memory once a transfer hands it over. */
+
+struct grant {
+    int      from;          /* sender pid; 0: free slot */
+    int      to;            /* receiver pid, 0 for anyone */
+    uint32_t flags;
+    uint32_t src;           /* sender address */
+    uint32_t npages;
+    uint32_t list_phys;     /* frame holding the uint32_t frame list */
+    uint32_t dst;           /* receiver address once mapped, else 0 */
+    int      dst_pid;       /* process that mapped it */
+};
+
+static struct grant grants[GRANT_MAX];
+
+static uint32_t* frame_list(const struct grant* g) {
+    return (uint32_t*)vmm_phys_to_virt(g->list_phys);
+}
+
+static struct grant* grant_get(int id) {
+    if (id < 1 || id > GRANT_MAX || !grants[id - 1].from) return 0;
+    return &grants[id - 1];
+}
+
+static void drop(struct grant* g, int unref) {
+    if (unref) {
+        uint32_t* frames = frame_list(g);
+        for (uint32_t i = 0; i < g->npages; ++i) pmm_unref_frame(frames[i]);
+    }
+    pmm_free_frame(g->list_phys);
+    memset(g, 0, sizeof(*g));
+}
+
+int grant_create(process_t* proc, uint32_t addr, uint32_t len, int to_pid, uint32_t flags) {
+    if (!proc || len == 0 || (addr & (PAGE_SIZE - 1)) || (flags & ~GRANT_MOVE)) return -1;
+    uint32_t npages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (npages > GRANT_MAX_PAGES || addr < PAGE_SIZE || addr + npages * PAGE_SIZE < addr ||
+        addr + npages * PAGE_SIZE > MMAP_USER_TOP) {
+        return -1;
+    }
+    struct grant* g = 0;
+    for (int i = 0; i < GRANT_MAX && !g; ++i) {
+        if (!grants[i].from) g = &grants[i];
+    }
+    if (!g) {
+        printf("grant: table full (max %d)\n", GRANT_MAX);
+        return -1;
+    }
+    uint32_t list_phys = pmm_alloc_frame();
+    if (!list_phys) return -1;
+    uint32_t* frames = (uint32_t*)vmm_phys_to_virt(list_phys);
+
+    uint32_t need = PAGE_PRESENT | PAGE_USER | ((flags & GRANT_MOVE) ? PAGE_WRITE : 0);
+    for (uint32_t i = 0; i < npages; ++i) {
+        uint32_t pte = vmm_get_pte(addr + i * PAGE_SIZE);
+        frames[i] = pte & ~0xFFFu;
+        /* A transfer must not take a frame the page cache or another
+           mapping still uses. */
+        if ((pte & need) != need || ((flags & GRANT_MOVE) && pmm_frame_refs(frames[i]) != 1)) {
+            pmm_free_frame(list_phys);
+            return -1;
+        }
+    }
+
+    if (flags & GRANT_MOVE) {
+        vmm_unmap_range(addr, npages);
+    } else {
+        for (uint32_t i = 0; i < npages; ++i) pmm_ref_frame(frames[i]);
+    }
+    g->from = proc->pid;
+    g->to = to_pid;
+    g->flags = flags;
+    g->src = addr;
+    g->npages = npages;
+    g->list_phys = list_phys;
+    g->dst = 0;
+    return (int)(g - grants) + 1;
+}
+
+uint32_t grant_map(process_t* proc, int id) {
+    struct grant* g = grant_get(id);
+    if (!proc || !g || g->dst || (g->to && g->to != proc->pid)) return MAP_FAILED;
+    uint32_t dst = mmap_find_range(proc, g->npages * PAGE_SIZE);
+    if (dst == MAP_FAILED) return MAP_FAILED;
+    int move = (g->flags & GRANT_MOVE) != 0;
+    if (mmap_add_vma(proc, dst, dst + g->npages * PAGE_SIZE, move ? PROT_READ | PROT_WRITE : PROT_READ,
+                     move ? MAP_PRIVATE : MAP_SHARED | VMA_PINNED, 0, 0) != 0) {
+        return MAP_FAILED;
+    }
+    uint32_t flags = PAGE_USER | (move ? PAGE_WRITE : 0);
+    if (vmm_map_range(dst, frame_list(g), g->npages, flags) != 0) {
+        printf("grant: out of memory for page tables\n");
+        mmap_remove_vma(proc, dst);
+        return MAP_FAILED;
+    }
+    if (g->flags & GRANT_MOVE) {
+        drop(g, 0);     /* the grant's references now back the mapping */
+        return dst;
+    }
+    uint32_t* frames = frame_list(g);
+    for (uint32_t i = 0; i < g->npages; ++i) pmm_ref_frame(frames[i]);
+    g->dst = dst;
+    g->dst_pid = proc->pid;
+    return dst;
+}
+
+static void revoke(struct grant* g) {
+    uint32_t* frames = frame_list(g);
+    if (g->flags & GRANT_MOVE) {
+        /* Not mapped yet (that would have ended the grant): give it back. */
+        if (vmm_map_range(g->src, frames, g->npages, PAGE_USER | PAGE_WRITE) == 0) {
+            drop(g, 0);
+            return;
+        }
+        printf("grant: cannot return pages to pid %d, dropping them\n", g->from);
+    } else if (g->dst) {
+        vmm_unmap_range(g->dst, g->npages);
+        for (uint32_t i = 0; i < g->npages; ++i) pmm_unref_frame(frames[i]);
+        mmap_remove_vma(process_find(g->dst_pid), g->dst);
+    }
+    drop(g, 1);
+}
+
+int grant_revoke(process_t* proc, int id) {
+    struct grant* g = grant_get(id);
+    if (!proc || !g) return -1;
+    if (g->from != proc->pid && g->to != proc->pid && !(g->dst && g->dst_pid == proc->pid)) return -1;
+    revoke(g);
+    return 0;
+}
+
+void grant_release(process_t* proc) {
+    if (!proc) return;
+    for (int i = 0; i < GRANT_MAX; ++i) {
+        struct grant* g = &grants[i];
+        if (!g->from) continue;
+        if (g->from == proc->pid) {
+            /* Pages still owed to the dying sender go with it. */
+            if (g->flags & GRANT_MOVE) drop(g, 1); else revoke(g);
+        } else if (g->to == proc->pid) {
+            /* The receiver's mapping references go with its address space;
+               a pending transfer goes back to the sender. */
+            if (g->flags & GRANT_MOVE) revoke(g); else drop(g, 1);
+        } else if (g->dst && g->dst_pid == proc->pid) {
+            /* An open grant mapped by the dying process: teardown drops
+               the mapping references, the grant stays with its sender. */
+            g->dst = 0;
+            g->dst_pid = 0;
+        }
+    }
+}
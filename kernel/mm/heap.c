@@ -3,8 +3,6 @@
 #include <kernel/pmm.h>
 #include <string.h>
 
-#define PAGE_SIZE 4096u
-
 static uint8_t* heap_cur;
 static uint8_t* heap_end;
 
@@ -0,0 +1,183 @@
+#include <kernel/mmap.h>
+#include <kernel/process.h>
+#include <kernel/fs.h>
+#include <kernel/vfs.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+/* Read-only mappings share the page-cache frame outright. Private writable
+   mappings start out the same way but mapped read-only; the first write
+   fault gives the process its own copy. Shared writable mappings would need
+   writeback and are refused. Pages wholly past end of file cannot be
+   mapped, and a fault on one after the file shrank kills the process
+   (SIGBUS) rather than handing out a zero page. */
+
+static struct vm_area* find_vma(process_t* p, uint32_t addr) {
+    for (int i = 0; i < PROC_MAX_VMAS; ++i) {
+        struct vm_area* v = &p->vmas[i];
+        if (v->start != v->end && addr >= v->start && addr < v->end) return v;
+    }
+    return 0;
+}
+
+static int range_free(process_t* p, uint32_t start, uint32_t end) {
+    for (int i = 0; i < PROC_MAX_VMAS; ++i) {
+        struct vm_area* v = &p->vmas[i];
+        if (v->start != v->end && start < v->end && v->start < end) return 0;
+    }
+    for (uint32_t a = start; a < end; a += PAGE_SIZE) {
+        if (vmm_resolve(a)) return 0; /* ELF image, stack or heap lives here */
+    }
+    return 1;
+}
+
+int mmap_add_vma(process_t* proc, uint32_t start, uint32_t end, uint32_t prot, uint32_t flags,
+                 struct vfs_inode* inode, uint32_t pgoff) {
+    struct vm_area* slot = 0;
+    for (int i = 0; i < PROC_MAX_VMAS && !slot; ++i) {
+        if (proc->vmas[i].start == proc->vmas[i].end) slot = &proc->vmas[i];
+    }
+    if (!slot) return -1;
+    slot->start = start;
+    slot->end = end;
+    slot->prot = prot;
+    slot->flags = flags;
+    slot->inode = inode;
+    if (inode) vfs_iref(inode);
+    slot->pgoff = pgoff;
+    return 0;
+}
+
+void mmap_remove_vma(process_t* proc, uint32_t start) {
+    for (int i = 0; proc && i < PROC_MAX_VMAS; ++i) {
+        struct vm_area* v = &proc->vmas[i];
+        if (v->start == v->end || v->start != start) continue;
+        if (v->inode) vfs_iput(v->inode);
+        v->inode = 0;
+        v->start = v->end = 0;
+        return;
+    }
+}
+
+uint32_t mmap_find_range(process_t* proc, uint32_t len) {
+    uint32_t start = proc->mmap_next;
+    while (start + len <= MMAP_LIMIT && start + len > start && !range_free(proc, start, start + len)) {
+        start += PAGE_SIZE;
+    }
+    if (start + len > MMAP_LIMIT || start + len < start) return MAP_FAILED;
+    proc->mmap_next = start + len;
+    return start;
+}
+
+uint32_t mmap_map(process_t* proc, const struct mmap_args* a) {
+    if (!proc || !a || a->len == 0) return MAP_FAILED;
+    if (a->offset & (PAGE_SIZE - 1)) return MAP_FAILED;
+    if (!(a->flags & (MAP_SHARED | MAP_PRIVATE))) return MAP_FAILED;
+    if ((a->flags & MAP_SHARED) && (a->prot & PROT_WRITE)) {
+        printf("mmap: shared writable mappings are not supported\n");
+        return MAP_FAILED;
+    }
+    struct vfs_file* f = fs_get_file(a->fd);
+    if (!f || f->inode->type != FS_DT_REG || !f->inode->fops->get_page) return MAP_FAILED;
+
+    uint32_t len = (a->len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    if (len < a->len) return MAP_FAILED;
+    /* The last page may run past EOF (zero tail), no page may start there */
+    uint32_t file_pages = (f->inode->size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (a->offset / PAGE_SIZE >= file_pages || len / PAGE_SIZE > file_pages - a->offset / PAGE_SIZE) {
+        return MAP_FAILED;
+    }
+
+    uint32_t start;
+    if (a->flags & MAP_FIXED) {
+        start = a->addr;
+        if ((start & (PAGE_SIZE - 1)) || start < PAGE_SIZE) return MAP_FAILED;
+        if (start + len < start || start + len > MMAP_USER_TOP) return MAP_FAILED;
+        if (!range_free(proc, start, start + len)) return MAP_FAILED;
+    } else {
+        start = mmap_find_range(proc, len);
+        if (start == MAP_FAILED) return MAP_FAILED;
+    }
+
+    if (mmap_add_vma(proc, start, start + len, a->prot, a->flags, f->inode, a->offset / PAGE_SIZE) != 0) {
+        return MAP_FAILED;
+    }
+    return start;
+}
+
+int mmap_unmap(process_t* proc, uint32_t addr, uint32_t len) {
+    if (!proc || (addr & (PAGE_SIZE - 1)) || len == 0) return -1;
+    uint32_t end = addr + ((len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    int found = 0;
+    for (int i = 0; i < PROC_MAX_VMAS; ++i) {
+        struct vm_area* v = &proc->vmas[i];
+        if (v->start == v->end || v->start < addr || v->end > end || (v->flags & VMA_PINNED)) continue;
+        for (uint32_t a = v->start; a < v->end; a += PAGE_SIZE) {
+            uint32_t pte = vmm_get_pte(a);
+            if (!(pte & PAGE_PRESENT)) continue;
+            vmm_unmap(a);
+            pmm_unref_frame(pte & ~0xFFFu);
+        }
+        if (v->inode) vfs_iput(v->inode);
+        v->inode = 0;
+        v->start = v->end = 0;
+        found = 1;
+    }
+    return found ? 0 : -1;
+}
+
+void mmap_fork(process_t* child) {
+    for (int i = 0; i < PROC_MAX_VMAS; ++i) {
+        struct vm_area* v = &child->vmas[i];
+        if (v->start != v->end && v->inode) vfs_iref(v->inode);
+    }
+}
+
+void mmap_release(process_t* proc) {
+    for (int i = 0; i < PROC_MAX_VMAS; ++i) {
+        struct vm_area* v = &proc->vmas[i];
+        if (v->start == v->end) continue;
+        if (v->inode) vfs_iput(v->inode);
+        v->inode = 0;
+        v->start = v->end = 0;
+    }
+}
+
+/* Give the process a private copy of the frame currently mapped at page. */
+static int copy_on_write(uint32_t page, uint32_t old_phys) {
+    uint32_t phys = pmm_alloc_frame();
+    if (!phys) return -1;
+    memcpy(vmm_phys_to_virt(phys), vmm_phys_to_virt(old_phys), PAGE_SIZE);
+    if (vmm_map(page, phys, PAGE_WRITE | PAGE_USER) != 0) { pmm_free_frame(phys); return -1; }
+    pmm_unref_frame(old_phys);
+    return 0;
+}
+
+int mmap_handle_fault(uint32_t addr, uint32_t err_code) {
+    process_t* p = process_current();
+    if (!p || addr >= MMAP_USER_TOP) return -1;
+    struct vm_area* v = find_vma(p, addr);
+    if (!v || !v->inode) return -1;   /* anonymous areas are always mapped */
+
+    uint32_t page = addr & ~(PAGE_SIZE - 1);
+    int write = (err_code & 0x2) != 0;
+    if (write && !(v->prot & PROT_WRITE)) return -1;
+
+    if (err_code & 0x1) {
+        /* Protection fault: only a write to a not-yet-copied private page. */
+        uint32_t pte = vmm_get_pte(page);
+        if (!write || !(pte & PAGE_PRESENT)) return -1;
+        return copy_on_write(page, pte & ~0xFFFu);
+    }
+
+    uint32_t index = v->pgoff + (page - v->start) / PAGE_SIZE;
+    if (index >= (v->inode->size + PAGE_SIZE - 1) / PAGE_SIZE) return MMAP_FAULT_SIGBUS;
+    uint32_t phys = v->inode->fops->get_page(v->inode, index);
+    if (!phys) return -1;
+    pmm_ref_frame(phys);
+    if (vmm_map(page, phys, PAGE_USER) != 0) { pmm_unref_frame(phys); return -1; }
+    if (write) return copy_on_write(page, phys);
+    return 0;
+}
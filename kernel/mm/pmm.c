@@ -10,6 +10,7 @@
 static uint32_t total_frames = 0;
 static uint32_t free_frames_cnt = 0;
 static uint32_t bitmap[MAX_FRAMES / 32]; /* 1 bit per frame */
+static uint16_t extra_refs[MAX_FRAMES];  /* references beyond the allocating owner */
 
 extern uint32_t kernel_phys_start; /* from linker */
 extern uint32_t kernel_phys_end;   /* from linker */
@@ -116,5 +117,26 @@ uint32_t pmm_alloc_frame_below(uint32_t max_phys) {
 void pmm_free_frame(uint32_t frame_phys) {
     uint32_t idx = frame_phys / FRAME_SIZE;
     if (idx >= total_frames) return;
+    extra_refs[idx] = 0;
     if (bm_test(idx)) { bm_clear(idx); free_frames_cnt++; }
 }
+
+void pmm_ref_frame(uint32_t frame_phys) {
+    uint32_t idx = frame_phys / FRAME_SIZE;
+    if (idx >= total_frames || !bm_test(idx)) return;
+    if (extra_refs[idx] != 0xFFFFu) extra_refs[idx]++;
+}
+
+void pmm_unref_frame(uint32_t frame_phys) {
+    uint32_t idx = frame_phys / FRAME_SIZE;
+    if (idx >= total_frames || !bm_test(idx)) return;
+    if (extra_refs[idx]) { extra_refs[idx]--; return; }
+    bm_clear(idx);
+    free_frames_cnt++;
+}
+
+uint32_t pmm_frame_refs(uint32_t frame_phys) {
+    uint32_t idx = frame_phys / FRAME_SIZE;
+    if (idx >= total_frames || !bm_test(idx)) return 0;
+    return 1u + extra_refs[idx];
+}
@@ -0,0 +1,165 @@
+#include <kernel/shm.h>
+#include <kernel/process.h>
+#include <kernel/mmap.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+/* The segment keeps one reference on each frame and every mapping takes
+   another, dropped by shm_unmap or by the address-space teardown. Holds
+   are rows of the attach table: shm_create leaves a row with no address,
+   which the process's first shm_map then fills in. Each mapping is also a
+   pinned anonymous VMA of the process, so munmap and mmap leave it alone. */
+
+struct shm_seg {
+    uint8_t  used;
+    char     name[SHM_NAME_MAX + 1];
+    uint32_t npages;
+    uint32_t list_phys;     /* frame holding the uint32_t frame list */
+    uint32_t holds;         /* attach rows pointing here */
+};
+
+struct shm_attach {
+    int      pid;           /* 0: free row */
+    int      seg;           /* index into segs */
+    uint32_t addr;          /* 0: held but not mapped */
+};
+
+static struct shm_seg segs[SHM_MAX];
+static struct shm_attach attach[SHM_MAX_ATTACH];
+
+static uint32_t* frame_list(const struct shm_seg* s) {
+    return (uint32_t*)vmm_phys_to_virt(s->list_phys);
+}
+
+static void seg_free(struct shm_seg* s) {
+    uint32_t* frames = frame_list(s);
+    for (uint32_t i = 0; i < s->npages; ++i) pmm_unref_frame(frames[i]);
+    pmm_free_frame(s->list_phys);
+    memset(s, 0, sizeof(*s));
+}
+
+static void put(struct shm_attach* a) {
+    struct shm_seg* s = &segs[a->seg];
+    memset(a, 0, sizeof(*a));
+    if (--s->holds == 0) seg_free(s);
+}
+
+static struct shm_attach* new_row(int pid, int seg) {
+    for (int i = 0; i < SHM_MAX_ATTACH; ++i) {
+        if (attach[i].pid) continue;
+        attach[i].pid = pid;
+        attach[i].seg = seg;
+        attach[i].addr = 0;
+        segs[seg].holds++;
+        return &attach[i];
+    }
+    printf("shm: attach table full (max %d)\n", SHM_MAX_ATTACH);
+    return 0;
+}
+
+static int seg_alloc(const char* name, uint32_t npages) {
+    int idx = -1;
+    for (int i = 0; i < SHM_MAX && idx < 0; ++i) {
+        if (!segs[i].used) idx = i;
+    }
+    if (idx < 0) {
+        printf("shm: out of segments (max %d)\n", SHM_MAX);
+        return -1;
+    }
+    struct shm_seg* s = &segs[idx];
+    s->list_phys = pmm_alloc_frame();
+    if (!s->list_phys) return -1;
+    uint32_t* frames = frame_list(s);
+    for (uint32_t i = 0; i < npages; ++i) {
+        frames[i] = pmm_alloc_frame();
+        if (!frames[i]) {
+            s->npages = i;
+            seg_free(s);
+            printf("shm: out of memory\n");
+            return -1;
+        }
+        memset(vmm_phys_to_virt(frames[i]), 0, PAGE_SIZE);
+    }
+    s->used = 1;
+    s->npages = npages;
+    uint32_t j = 0;
+    if (name) { while (name[j] && j < SHM_NAME_MAX) { s->name[j] = name[j]; j++; } }
+    s->name[j] = 0;
+    return idx;
+}
+
+int shm_create(process_t* proc, const char* name, uint32_t size) {
+    if (!proc) return -1;
+    if (name && name[0]) {
+        uint32_t n = 0;
+        while (n <= SHM_NAME_MAX && name[n]) n++;
+        if (n > SHM_NAME_MAX) return -1;
+        for (int i = 0; i < SHM_MAX; ++i) {
+            if (!segs[i].used || strcmp(segs[i].name, name)) continue;
+            if (size > segs[i].npages * PAGE_SIZE) return -1;
+            return new_row(proc->pid, i) ? i + 1 : -1;
+        }
+    }
+    uint32_t npages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (npages == 0 || npages > SHM_MAX_PAGES) return -1;
+    int idx = seg_alloc(name, npages);
+    if (idx < 0) return -1;
+    if (!new_row(proc->pid, idx)) {
+        seg_free(&segs[idx]);
+        return -1;
+    }
+    return idx + 1;
+}
+
+uint32_t shm_map(process_t* proc, int id) {
+    if (!proc || id < 1 || id > SHM_MAX || !segs[id - 1].used) return MAP_FAILED;
+    int seg = id - 1;
+    struct shm_seg* s = &segs[seg];
+    struct shm_attach* a = 0;
+    for (int i = 0; i < SHM_MAX_ATTACH && !a; ++i) {
+        if (attach[i].pid == proc->pid && attach[i].seg == seg && !attach[i].addr) a = &attach[i];
+    }
+    int fresh = !a;
+    if (fresh && !(a = new_row(proc->pid, seg))) return MAP_FAILED;
+
+    uint32_t addr = mmap_find_range(proc, s->npages * PAGE_SIZE);
+    if (addr == MAP_FAILED || mmap_add_vma(proc, addr, addr + s->npages * PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | VMA_PINNED, 0, 0) != 0) {
+        if (fresh) put(a);
+        return MAP_FAILED;
+    }
+    if (vmm_map_range(addr, frame_list(s), s->npages, PAGE_USER | PAGE_WRITE) != 0) {
+        mmap_remove_vma(proc, addr);
+        if (fresh) put(a);
+        return MAP_FAILED;
+    }
+    uint32_t* frames = frame_list(s);
+    for (uint32_t i = 0; i < s->npages; ++i) pmm_ref_frame(frames[i]);
+    a->addr = addr;
+    return addr;
+}
+
+int shm_unmap(process_t* proc, uint32_t addr) {
+    if (!proc || !addr) return -1;
+    for (int i = 0; i < SHM_MAX_ATTACH; ++i) {
+        struct shm_attach* a = &attach[i];
+        if (a->pid != proc->pid || a->addr != addr) continue;
+        struct shm_seg* s = &segs[a->seg];
+        uint32_t* frames = frame_list(s);
+        vmm_unmap_range(addr, s->npages);
+        for (uint32_t k = 0; k < s->npages; ++k) pmm_unref_frame(frames[k]);
+        mmap_remove_vma(proc, addr);
+        put(a);
+        return 0;
+    }
+    return -1;
+}
+
+void shm_release(process_t* proc) {
+    if (!proc) return;
+    for (int i = 0; i < SHM_MAX_ATTACH; ++i) {
+        if (attach[i].pid == proc->pid) put(&attach[i]);
+    }
+}
@@ -2,7 +2,6 @@
 #include <kernel/pmm.h>
 #include <kernel/stdio.h>
 
-#define PAGE_SIZE 4096u
 #define PD_ENTRIES 1024
 #define PT_ENTRIES 1024
 
@@ -39,6 +38,26 @@ static uint32_t* get_pt(uint32_t* pd, uint32_t v, int create, uint32_t flags) {
 }
 
 void vmm_init(void) {
+    /* Build the physmap with 4 MiB pages: no page tables to allocate. */
+    uint32_t cr4;
+    __asm__ volatile("mov %%cr4,%0":"=r"(cr4));
+    cr4 |= 0x10; /* PSE */
+    __asm__ volatile("mov %0,%%cr4"::"r"(cr4));
+    /* Honour read-only user pages in ring 0 too, so kernel copies into a
+       private file mapping take the copy-on-write fault. */
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0,%0":"=r"(cr0));
+    cr0 |= 0x10000; /* WP */
+    __asm__ volatile("mov %0,%%cr0"::"r"(cr0));
+
+    uint32_t bytes = pmm_total_frames() * PAGE_SIZE;
+    if (bytes > KERNEL_PHYSMAP_SIZE || bytes == 0) bytes = KERNEL_PHYSMAP_SIZE;
+    uint32_t* pd = pd_ptr();
+    for (uint32_t off = 0; off < bytes; off += 0x400000u) {
+        pd[(KERNEL_PHYSMAP_BASE + off) >> 22] = off | PAGE_LARGE | PAGE_WRITE | PAGE_PRESENT;
+    }
+    __asm__ volatile("mov %0,%%cr3"::"r"(read_cr3()):"memory");
+    printf("VMM: physmap %u MiB at 0x%x\n", bytes >> 20, KERNEL_PHYSMAP_BASE);
 }
 
 int vmm_map(uint32_t virt, uint32_t phys, uint32_t flags) {
@@ -64,14 +83,63 @@ int vmm_unmap(uint32_t virt) {
     return 0;
 }
 
+int vmm_map_range(uint32_t virt, const uint32_t* frames, uint32_t n, uint32_t flags) {
+    uint32_t* pd = pd_ptr();
+    uint32_t* pt = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t v = virt + i * PAGE_SIZE;
+        if (!pt || (v & 0x3FFFFFu) == 0) {
+            pt = get_pt(pd, v, 1, flags);
+            if (!pt) {
+                vmm_unmap_range(virt, i);
+                return -1;
+            }
+        }
+        uint32_t idx = (v >> 12) & 0x3FF;
+        uint32_t old = pt[idx];
+        pt[idx] = (frames[i] & ~0xFFFu) | (flags & (PAGE_WRITE|PAGE_USER)) | PAGE_PRESENT;
+        /* A not-present entry cannot be cached, so fresh slots need no flush. */
+        if (old & PAGE_PRESENT) invlpg(v);
+    }
+    return 0;
+}
+
+void vmm_unmap_range(uint32_t virt, uint32_t n) {
+    uint32_t* pd = pd_ptr();
+    uint32_t cleared = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t v = virt + i * PAGE_SIZE;
+        uint32_t pde = pd[(v >> 22) & 0x3FF];
+        if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) continue;
+        uint32_t* pt = (uint32_t*)(pde & ~0xFFFu);
+        uint32_t idx = (v >> 12) & 0x3FF;
+        if (!(pt[idx] & PAGE_PRESENT)) continue;
+        pt[idx] = 0;
+        if (n <= VMM_FLUSH_PAGES) invlpg(v);
+        cleared++;
+    }
+    if (n > VMM_FLUSH_PAGES && cleared) {
+        __asm__ volatile("mov %0,%%cr3"::"r"(read_cr3()):"memory");
+    }
+}
+
 uint32_t vmm_resolve(uint32_t virt) {
     uint32_t* pd = pd_ptr();
     uint32_t pd_idx = (virt >> 22) & 0x3FF;
     uint32_t pde = pd[pd_idx];
     if (!(pde & PAGE_PRESENT)) return 0;
+    if (pde & PAGE_LARGE) return (pde & 0xFFC00000u) | (virt & 0x3FFFFFu);
     uint32_t* pt = (uint32_t*)(pde & ~0xFFFu);
     uint32_t pt_idx = (virt >> 12) & 0x3FF;
     uint32_t pte = pt[pt_idx];
     if (!(pte & PAGE_PRESENT)) return 0;
     return (pte & ~0xFFFu) | (virt & 0xFFFu);
 }
+
+uint32_t vmm_get_pte(uint32_t virt) {
+    uint32_t* pd = pd_ptr();
+    uint32_t pde = pd[(virt >> 22) & 0x3FF];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) return 0;
+    uint32_t* pt = (uint32_t*)(pde & ~0xFFFu);
+    return pt[(virt >> 12) & 0x3FF];
+}
@@ -0,0 +1,154 @@
+#include <kernel/ipc.h>
+#include <kernel/sched.h>
+#include <kernel/process.h>
+#include <kernel/htas.h>
+#include <kernel/cpu.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+struct ipc_endpoint {
+    uint8_t  used;
+    uint8_t  waiting;       /* server is parked in ipc_wait/reply_wait */
+    int8_t   server;        /* thread id, -1 before ipc_server_start */
+    int8_t   caller;        /* thread switched away from, waiting for us */
+    int8_t   base_prio;     /* server priority outside of calls */
+    char     name[15];
+    struct ipc_msg msg;     /* request on the way in, reply on the way out */
+    uint32_t calls;
+    uint32_t refused;       /* server busy or absent */
+    uint32_t by_intent[4];  /* PERFORMANCE, EFFICIENCY, LOW_LATENCY, DEFAULT */
+};
+
+static struct ipc_endpoint eps[IPC_MAX_ENDPOINTS];
+
+static struct ipc_endpoint* ep_get(int ep) {
+    if (ep < 1 || ep > IPC_MAX_ENDPOINTS || !eps[ep - 1].used) return 0;
+    return &eps[ep - 1];
+}
+
+/* Thread priority the server borrows for a caller with this intent; the
+   default intent leaves the server at its own. */
+static int donated_priority(uint32_t intent, int base) {
+    switch (intent) {
+        case PROFILE_LOW_LATENCY: return SCHED_PRIORITY_REALTIME;
+        case PROFILE_PERFORMANCE: return SCHED_PRIORITY_INTERACTIVE;
+        case PROFILE_EFFICIENCY:  return SCHED_PRIORITY_BACKGROUND;
+        default:                  return base;
+    }
+}
+
+int ipc_endpoint_create(const char* name) {
+    for (int i = 0; i < IPC_MAX_ENDPOINTS; ++i) {
+        struct ipc_endpoint* e = &eps[i];
+        if (e->used) continue;
+        memset(e, 0, sizeof(*e));
+        e->used = 1;
+        e->server = -1;
+        e->caller = -1;
+        int j = 0;
+        if (name) { while (name[j] && j < (int)sizeof(e->name) - 1) { e->name[j] = name[j]; j++; } }
+        e->name[j] = 0;
+        return i + 1;
+    }
+    printf("ipc: out of endpoints (max %d)\n", IPC_MAX_ENDPOINTS);
+    return -1;
+}
+
+int ipc_server_start(int ep, kthread_fn fn, const char* name) {
+    struct ipc_endpoint* e = ep_get(ep);
+    if (!e || e->server >= 0) return -1;
+    int tid = kthread_create_blocked(fn, (void*)(uintptr_t)ep, name);
+    if (tid < 0) {
+        printf("ipc: cannot create server thread for %s\n", e->name);
+        return -1;
+    }
+    e->server = (int8_t)tid;
+    e->base_prio = (int8_t)sched_get_priority(tid);
+    /* Let it run up to its first ipc_wait, which switches back here. */
+    uint32_t flags = irq_save();
+    e->caller = (int8_t)sched_current();
+    sched_switch_to(tid);
+    irq_restore(flags);
+    return tid;
+}
+
+int ipc_call(int ep, struct ipc_msg* msg) {
+    struct ipc_endpoint* e = ep_get(ep);
+    if (!e) return -1;
+    uint32_t flags = irq_save();
+    if (!e->waiting || e->server == sched_current()) {
+        e->refused++;
+        irq_restore(flags);
+        return -1;
+    }
+    process_t* p = process_current();
+    uint32_t intent = p && p->htas_info ? (uint32_t)p->htas_info->profile.intent : PROFILE_DEFAULT;
+    if (intent > PROFILE_DEFAULT) intent = PROFILE_DEFAULT;
+
+    e->msg = *msg;
+    e->msg.intent = intent;
+    e->waiting = 0;
+    e->caller = (int8_t)sched_current();
+    e->calls++;
+    e->by_intent[intent]++;
+    int prio = donated_priority(intent, e->base_prio);
+    if (prio != e->base_prio) sched_set_priority(e->server, prio);
+
+    sched_switch_to(e->server);
+
+    /* Back from ipc_reply_wait: the reply is in the endpoint. */
+    if (prio != e->base_prio) sched_set_priority(e->server, e->base_prio);
+    *msg = e->msg;
+    irq_restore(flags);
+    return 0;
+}
+
+void ipc_reply_wait(int ep, const struct ipc_msg* reply, struct ipc_msg* next) {
+    struct ipc_endpoint* e = ep_get(ep);
+    if (!e || e->server != sched_current()) {
+        printf("ipc: reply/wait on %d from a thread that does not serve it\n", ep);
+        for (;;) { __asm__ volatile("cli; hlt"); }
+    }
+    uint32_t flags = irq_save();
+    if (reply) e->msg = *reply;
+    e->waiting = 1;
+    sched_switch_to(e->caller);
+    /* Switched to by ipc_call with the request in the endpoint. */
+    *next = e->msg;
+    irq_restore(flags);
+}
+
+void ipc_wait(int ep, struct ipc_msg* next) {
+    ipc_reply_wait(ep, 0, next);
+}
+
+/* Hands every message back unchanged: the round trip is pure IPC cost. */
+static void echo_server(void* arg) {
+    int ep = (int)(uintptr_t)arg;
+    struct ipc_msg m;
+    ipc_wait(ep, &m);
+    for (;;) ipc_reply_wait(ep, &m, &m);
+}
+
+void ipc_init(void) {
+    int ep = ipc_endpoint_create("echo");
+    if (ep != IPC_EP_ECHO || ipc_server_start(ep, echo_server, "ipc-echo") < 0) {
+        printf("ipc: echo server not started\n");
+        return;
+    }
+    printf("ipc: echo server on endpoint %d\n", ep);
+}
+
+void ipc_dump(void) {
+    static const char* intent_names[4] = { "perf", "eff", "lowlat", "default" };
+    printf("EP  SERVER  STATE    CALLS  REFUSED  NAME\n");
+    for (int i = 0; i < IPC_MAX_ENDPOINTS; ++i) {
+        const struct ipc_endpoint* e = &eps[i];
+        if (!e->used) continue;
+        printf("%d   %d       %s  %u  %u  %s\n", i + 1, e->server,
+               e->waiting ? "waiting" : "busy   ", e->calls, e->refused, e->name);
+        for (int k = 0; k < 4; ++k) {
+            if (e->by_intent[k]) printf("      %s: %u calls\n", intent_names[k], e->by_intent[k]);
+        }
+    }
+}
@@ -1,8 +1,10 @@
 #include <kernel/proc.h>
 #include <kernel/gdt.h>
 #include <kernel/stdio.h>
+#include <kernel/klog.h>
 #include <kernel/process.h>
 #include <kernel/vmm.h>
+#include <kernel/vdso.h>
 
 /* Globals used by the assembly thunk to resume on the correct stack. */
 void*    g_proc_resume_eip = 0;
@@ -39,25 +41,28 @@ static inline uint32_t read_cr3(void) {
     return cr3;
 }
 
-__attribute__((noinline,optimize("O0")))
 int run_user_and_wait(void* entry, uint32_t user_stack_top) {
+    int pid = process_create(0);
+    if (pid < 0) {
+        klog(KLOG_PROC, KLOG_ERR, "[proc] FAILED to create process\n");
+        return -1;
+    }
+    return run_process_and_wait(pid, entry, user_stack_top);
+}
+
+__attribute__((noinline,optimize("O0")))
+int run_process_and_wait(int pid, void* entry, uint32_t user_stack_top) {
     uint32_t resume_esp;
     __asm__ volatile ("movl %%esp, %0" : "=r"(resume_esp));
     uint32_t resume_ebp;
     __asm__ volatile ("movl %%ebp, %0" : "=r"(resume_ebp));
     void* resume_eip = &&after_user;
     
-    printf("[proc] run_user_and_wait: entry=%p stack=0x%x\n", entry, user_stack_top);
-    
-    int pid = process_create(0);
-    if (pid < 0) {
-        printf("[proc] FAILED to create process\n");
-        return -1;
-    }
+    klog(KLOG_PROC, KLOG_DEBUG, "[proc] run_process_and_wait: pid=%d entry=%p stack=0x%x\n", pid, entry, user_stack_top);
     
     process_t* proc = process_find(pid);
     if (!proc) {
-        printf("[proc] FAILED to find process %d\n", pid);
+        klog(KLOG_PROC, KLOG_ERR, "[proc] FAILED to find process %d\n", pid);
         return -1;
     }
     
@@ -74,7 +79,9 @@ int run_user_and_wait(void* entry, uint32_t user_stack_top) {
     
     process_set_current(pid);
     
-    printf("[proc] Process %d set up and ready\n", pid);
+    klog(KLOG_PROC, KLOG_DEBUG, "[proc] Process %d set up and ready\n", pid);
+    
+    if (vdso_map() != 0) klog(KLOG_PROC, KLOG_WARN, "[proc] vdso page not mapped\n");
     
     proc_begin_wait(resume_eip, resume_esp, resume_ebp);
     __asm__ volatile("": : : "memory");
@@ -82,7 +89,7 @@ int run_user_and_wait(void* entry, uint32_t user_stack_top) {
     __asm__ volatile("": : : "memory");
     
 after_user:
-    printf("[proc] after_user: resumed in kernel, exit_code=%d\n", proc_last_exit_code());
+    klog(KLOG_PROC, KLOG_DEBUG, "[proc] after_user: resumed in kernel, exit_code=%d\n", proc_last_exit_code());
     
     // Clean up the process
     if (proc) {
@@ -3,7 +3,13 @@
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <kernel/stdio.h>
+#include <kernel/klog.h>
 #include <kernel/htas.h>
+#include <kernel/ioring.h>
+#include <kernel/vdso.h>
+#include <kernel/systrace.h>
+#include <kernel/grant.h>
+#include <kernel/shm.h>
 #include <string.h>
 #include <stdbool.h>
 
@@ -25,12 +31,13 @@ static inline void write_cr3(uint32_t pd_phys) {
 
 /* Helper: copy page directory for fork */
 static uint32_t clone_page_directory(uint32_t src_pd_phys) {
-    printf("process: WARNING - clone_page_directory not fully implemented, sharing address space\n");
+    klog(KLOG_PROC, KLOG_DEBUG, "process: WARNING - clone_page_directory not fully implemented, sharing address space\n");
     return src_pd_phys;
 }
 
 /* Release all user-space mappings held by the given page directory. This
-   frees user pages and their page tables, and (when the directory is not the
+   drops a reference on user pages (page-cache frames stay cached), frees
+   their page tables, and (when the directory is not the
    currently active one) the page directory itself. */
 static void free_user_address_space(uint32_t pd_phys) {
     if (!pd_phys) return;
@@ -55,7 +62,7 @@ static void free_user_address_space(uint32_t pd_phys) {
                 uint32_t virt = ((uint32_t)i << 22) | ((uint32_t)j << 12);
                 uint32_t phys = pte & ~0xFFFu;
                 vmm_unmap(virt);
-                pmm_free_frame(phys);
+                pmm_unref_frame(phys);
             }
 
             /* If the table no longer has user mappings, release it. */
@@ -76,7 +83,7 @@ static void free_user_address_space(uint32_t pd_phys) {
                 if (!(pte & PAGE_PRESENT)) continue;
                 if (pte & PAGE_USER) {
                     uint32_t phys = pte & ~0xFFFu;
-                    pmm_free_frame(phys);
+                    pmm_unref_frame(phys);
                 }
                 pt[j] = 0;
             }
@@ -94,7 +101,7 @@ void process_init(void) {
     memset(process_table, 0, sizeof(process_table));
     current_pid = -1;
     next_pid = 1;
-    printf("process: initialized (max=%d)\n", MAX_PROCESSES);
+    klog(KLOG_PROC, KLOG_INFO, "process: initialized (max=%d)\n", MAX_PROCESSES);
 }
 
 int process_create(int ppid) {
@@ -107,6 +114,12 @@ int process_create(int ppid) {
             process_table[i].page_dir = 0;
             process_table[i].exit_code = 0;
             process_table[i].brk = 0;
+            memset(process_table[i].vmas, 0, sizeof(process_table[i].vmas));
+            process_table[i].mmap_next = MMAP_BASE;
+            fdt_init(&process_table[i].fdt);
+            memset(&process_table[i].dl, 0, sizeof(process_table[i].dl));
+            process_table[i].sys_stats_phys = 0;
+            process_table[i].traced = 0;
             process_table[i].htas_info = 0;  // Initialize HTAS info
             process_table[i].user_data = 0;  // Initialize user data
             memset(&process_table[i].context, 0, sizeof(proc_context_t));
@@ -148,12 +161,20 @@ void process_yield(void) {
 
 void process_set_current(int pid) {
     current_pid = pid;
+    vdso_set_process(process_find(pid));
 }
 
 void process_destroy(int pid) {
     process_t* proc = process_find(pid);
     if (!proc) return;
 
+    grant_release(proc);
+    shm_release(proc);
+    mmap_release(proc);
+    io_ring_release(pid);
+    systrace_release(proc);
+    fdt_close_all(&proc->fdt);
+
     /* Free user address space resources (page tables, frames, etc.). */
     if (proc->page_dir) {
         free_user_address_space(proc->page_dir);
@@ -162,33 +183,33 @@ void process_destroy(int pid) {
     
     proc->state = PROC_UNUSED;
     
-    printf("process: destroyed pid=%d\n", pid);
+    klog(KLOG_PROC, KLOG_DEBUG, "process: destroyed pid=%d\n", pid);
 }
 
 int process_fork(void) {
     process_t* parent = process_current();
     if (!parent) {
-        printf("process: fork failed - no current process\n");
+        klog(KLOG_PROC, KLOG_ERR, "process: fork failed - no current process\n");
         return -1;
     }
 
     // Create child process
     int child_pid = process_create(parent->pid);
     if (child_pid < 0) {
-        printf("process: fork failed - no free slots\n");
+        klog(KLOG_PROC, KLOG_ERR, "process: fork failed - no free slots\n");
         return -1;
     }
 
     process_t* child = process_find(child_pid);
     if (!child) {
-        printf("process: fork failed - couldn't find child\n");
+        klog(KLOG_PROC, KLOG_ERR, "process: fork failed - couldn't find child\n");
         return -1;
     }
 
     // Clone page directory and memory
     child->page_dir = clone_page_directory(parent->page_dir);
     if (!child->page_dir) {
-        printf("process: fork failed - couldn't clone page directory\n");
+        klog(KLOG_PROC, KLOG_ERR, "process: fork failed - couldn't clone page directory\n");
         process_destroy(child_pid);
         return -1;
     }
@@ -201,9 +222,19 @@ int process_fork(void) {
     
     // Copy other process state
     child->brk = parent->brk;
+    memcpy(child->vmas, parent->vmas, sizeof(child->vmas));
+    mmap_fork(child);
+    child->mmap_next = parent->mmap_next;
+    child->dl = parent->dl;
+    child->traced = parent->traced;
+    if (fdt_clone(&child->fdt, &parent->fdt) != 0) {
+        klog(KLOG_PROC, KLOG_ERR, "process: fork failed - couldn't copy fd table\n");
+        process_destroy(child_pid);
+        return -1;
+    }
     child->state = PROC_READY;
 
-    printf("process: fork: parent=%d child=%d\n", parent->pid, child_pid);
+    klog(KLOG_PROC, KLOG_DEBUG, "process: fork: parent=%d child=%d\n", parent->pid, child_pid);
 
     // Parent returns child PID
     return child_pid;
@@ -212,20 +243,21 @@ int process_fork(void) {
 void process_exit(int code) {
     process_t* proc = process_current();
     if (!proc) {
-        printf("process: exit called with no current process\n");
+        klog(KLOG_PROC, KLOG_ERR, "process: exit called with no current process\n");
         return;
     }
 
     proc->exit_code = code;
     proc->state = PROC_ZOMBIE;
+    fdt_close_all(&proc->fdt);
     
-    printf("process: pid=%d exited with code %d\n", proc->pid, code);
+    klog(KLOG_PROC, KLOG_DEBUG, "process: pid=%d exited with code %d\n", proc->pid, code);
 
     // Wake up parent if it's waiting
     if (proc->ppid > 0) {
         process_t* parent = process_find(proc->ppid);
         if (parent && parent->state == PROC_BLOCKED) {
-            printf("process: waking up parent %d\n", proc->ppid);
+            klog(KLOG_PROC, KLOG_DEBUG, "process: waking up parent %d\n", proc->ppid);
             parent->state = PROC_READY;
         }
     }
@@ -250,7 +282,7 @@ int process_wait(int* status) {
                     *status = p->exit_code;
                 }
                 process_destroy(pid);
-                printf("process: wait collected zombie child %d\n", pid);
+                klog(KLOG_PROC, KLOG_DEBUG, "process: wait collected zombie child %d\n", pid);
                 return pid;
             }
         }
@@ -282,7 +314,7 @@ void process_switch(int new_pid) {
 
     process_t* new_proc = process_find(new_pid);
     if (!new_proc || new_proc->state != PROC_READY) {
-        printf("process: can't switch to pid=%d\n", new_pid);
+        klog(KLOG_PROC, KLOG_ERR, "process: can't switch to pid=%d\n", new_pid);
         return;
     }
 
@@ -296,6 +328,7 @@ void process_switch(int new_pid) {
     // Switch to new process
     current_pid = new_pid;
     new_proc->state = PROC_RUNNING;
+    vdso_set_process(new_proc);
 
     // Switch page directory
     write_cr3(new_proc->page_dir);
@@ -353,6 +386,7 @@ void process_schedule(struct registers* regs) {
 
     current_pid = next->pid;
     next->state = PROC_RUNNING;
+    vdso_set_process(next);
 
     write_cr3(next->page_dir);
 
@@ -3,20 +3,28 @@
 #include <kernel/serial.h>
 #include <kernel/proc.h>
 #include <kernel/stdio.h>
-#include <kernel/keyboard.h>
+#include <kernel/klog.h>
 #include <kernel/tty.h>
 #include <kernel/pmm.h>
 #include <kernel/vmm.h>
 #include <kernel/process.h>
+#include <kernel/mmap.h>
+#include <kernel/ioring.h>
+#include <kernel/systrace.h>
+#include <kernel/poll.h>
+#include <kernel/ipc.h>
+#include <kernel/grant.h>
+#include <kernel/shm.h>
+#include <kernel/vfs.h>
+#include <string.h>
 
 static int sys_write_impl(const char* buf, unsigned len) {
     /* Mirror userland stdout to BOTH serial and VGA so output is visible
        in the QEMU window and (optionally) on the host terminal. */
     for (unsigned i = 0; i < len; ++i) {
-        char c = buf[i];
-        serial_putchar(c);
-        terminal_putchar(c);
+        serial_putchar(buf[i]);
     }
+    terminal_write(buf, len);
     return (int)len;
 }
 
@@ -29,19 +37,92 @@ extern int fs_read(int fd, void* buf, unsigned len);
 extern int fs_write(int fd, const void* buf, unsigned len);
 extern int fs_close(int fd);
 extern int fs_dump_list(char* buf, unsigned len);
+extern int fs_getdents(int fd, void* buf, unsigned len);
+extern int fs_create(const char* name);
+extern int fs_pipe(int fds[2]);
+extern int fs_unlink(const char* name);
+extern int fs_sendfile(int out_fd, int in_fd, uint32_t* offset, unsigned count);
+extern int fs_lseek(int fd, int32_t off, int whence);
+extern int fs_pread(int fd, void* buf, unsigned len, uint32_t off);
+extern int fs_pwrite(int fd, const void* buf, unsigned len, uint32_t off);
+extern int fs_readv(int fd, const struct vfs_iovec* iov, unsigned cnt);
+extern int fs_writev(int fd, const struct vfs_iovec* iov, unsigned cnt);
+extern int fs_may_block(int fd);
 
-void syscall_dispatch(struct registers* regs) {
+void syscall_dispatch(struct registers* regs);
+
+/* [addr, addr + len) lies wholly below the kernel at 0xC0000000. */
+static int user_ptr_ok(uint32_t addr, uint32_t len) {
+    return addr < 0xC0000000u && len <= 0xC0000000u - addr;
+}
+
+/* Copy a readv/writev vector into kiov, checking the array and every
+   segment, so the VFS only ever sees checked user buffers. */
+static int copy_iov(uint32_t uiov, unsigned cnt, struct vfs_iovec* kiov) {
+    if (!uiov || cnt > VFS_IOV_MAX || !user_ptr_ok(uiov, cnt * sizeof(*kiov))) return -1;
+    memcpy(kiov, (const void*)uiov, cnt * sizeof(*kiov));
+    for (unsigned i = 0; i < cnt; ++i) {
+        if (kiov[i].len && !user_ptr_ok((uint32_t)kiov[i].base, kiov[i].len)) return -1;
+    }
+    return 0;
+}
+
+/* Calls a batch refuses: those that never return to the batch, those that
+   may sleep (the rest of the batch would wait behind them), and ipc_call,
+   whose reply comes back in registers a record has no room for. */
+static int batch_refused(const struct sys_batch_ent* e) {
+    switch (e->nr) {
+        case SYS_exit: case SYS_fork: case SYS_batch: case SYS_dl_resolve:
+        case SYS_wait: case SYS_poll: case SYS_ipc_call: case SYS_io_enter:
+            return 1;
+        case SYS_read: case SYS_readv: case SYS_pread:
+        case SYS_fwrite: case SYS_writev: case SYS_pwrite:
+            return fs_may_block((int)e->args[0]);
+        case SYS_sendfile:
+            return fs_may_block((int)e->args[0]) || fs_may_block((int)e->args[1]);
+        default:
+            return 0;
+    }
+}
+
+/* Each record runs through the normal dispatcher on a copy of the
+   caller's frame, so batched calls behave exactly like trapped ones. */
+static int sys_batch(struct registers* regs) {
+    struct sys_batch_ent* ents = (struct sys_batch_ent*)regs->ebx;
+    uint32_t count = regs->ecx, flags = regs->edx;
+    if (!ents || count > SYS_BATCH_MAX || (uint32_t)ents >= 0xC0000000u ||
+        count * sizeof(struct sys_batch_ent) > 0xC0000000u - (uint32_t)ents) return -1;
+    uint32_t done = 0;
+    for (; done < count; ++done) {
+        struct sys_batch_ent* e = &ents[done];
+        struct registers r = *regs;
+        r.eax = e->nr;
+        r.ebx = e->args[0];
+        r.ecx = e->args[1];
+        r.edx = e->args[2];
+        r.esi = e->args[3];
+        if (batch_refused(e)) r.eax = (uint32_t)-1;
+        else syscall_dispatch(&r);
+        e->result = (int32_t)r.eax;
+        if ((flags & SYS_BATCH_STOP_ON_ERR) && e->result < 0) { ++done; break; }
+    }
+    return (int)done;
+}
+
+static void dispatch(struct registers* regs) {
     switch (regs->eax) {
         case SYS_write:
               /* Quiet default: avoid per-call spam so user shells are readable. */
               regs->eax = (uint32_t)sys_write_impl((const char*)regs->ebx, (unsigned)regs->ecx);
             break;
-        case SYS_exit: {
+        case SYS_exit:
+        do_exit: {
             int code = (int)regs->ebx;
-            printf("\n[usr] exit(%d)\n", code);
+            klog(KLOG_PROC, KLOG_DEBUG, "[usr] exit(%d)\n", code);
             /* Save exit code and arrange to return control at the ISR tail. */
             if (!proc_prepare_kernel_return(regs, code)) {
-                printf("[sys_exit] ERROR: proc_prepare_kernel_return failed!\n");
+                klog(KLOG_PROC, KLOG_ERR, "[sys_exit] ERROR: proc_prepare_kernel_return failed!\n");
+                serial_flush();
                 for(;;) { __asm__ volatile("cli; hlt"); }
             }
             /* Perform an immediate switch to kernel stack and resume point.
@@ -50,43 +131,47 @@ void syscall_dispatch(struct registers* regs) {
             extern uint32_t g_proc_resume_esp;
             extern uint32_t g_proc_resume_ebp;
             /* Debug instrumentation: */
-            printf("[sys_exit] hard switch now: resume_esp=0x%x resume_ebp=0x%x resume_eip=%p\n", 
+            klog(KLOG_PROC, KLOG_DEBUG, "[sys_exit] hard switch now: resume_esp=0x%x resume_ebp=0x%x resume_eip=%p\n", 
                    g_proc_resume_esp, g_proc_resume_ebp, g_proc_resume_eip);
             proc_switch_to_kernel_now();
             __builtin_unreachable();
         }
-        case SYS_read: {
-            int fd = (int)regs->ebx;
-            void* buf = (void*)regs->ecx;
-            unsigned len = (unsigned)regs->edx;
-            if (fd == 0) {
-                /* Read from keyboard into user buffer, echo to console. */
-                char* dst = (char*)buf;
-                unsigned n = 0;
-                /* Allow IRQ1 (keyboard) to fire while we block for input.
-                   The syscall ISR entry cleared IF (interrupt gate), so
-                   explicitly re-enable it for the duration of this read. */
-                __asm__ volatile("sti" ::: "memory");
-                while (n < len) {
-                    int ch = kbd_getch();
-                    if (ch < 0) { __asm__ volatile("sti; hlt"); continue; }
-                    if (ch == '\r') ch = '\n';
-                    if (ch == '\b') {
-                        if (n > 0) { n--; terminal_putchar('\b'); terminal_putchar(' '); terminal_putchar('\b'); }
-                        continue;
-                    }
-                    dst[n++] = (char)ch;
-                    terminal_putchar((char)ch);
-                    if (ch == '\n') break;
-                }
-                regs->eax = (uint32_t)n;
-            } else {
-                regs->eax = (uint32_t)fs_read(fd, buf, len);
-            }
-            break; }
+        case SYS_read:
+            regs->eax = (uint32_t)fs_read((int)regs->ebx, (void*)regs->ecx, (unsigned)regs->edx);
+            break;
         case SYS_open:
             regs->eax = (uint32_t)fs_open((const char*)regs->ebx);
             break;
+        case SYS_creat:
+            regs->eax = (uint32_t)fs_create((const char*)regs->ebx);
+            break;
+        case SYS_unlink:
+            regs->eax = (uint32_t)fs_unlink((const char*)regs->ebx);
+            break;
+        case SYS_sendfile:
+            /* *offset is read and written back by the kernel */
+            if (regs->edx && !user_ptr_ok(regs->edx, sizeof(uint32_t))) { regs->eax = (uint32_t)-1; break; }
+            regs->eax = (uint32_t)fs_sendfile((int)regs->ebx, (int)regs->ecx,
+                                              (uint32_t*)regs->edx, (unsigned)regs->esi);
+            break;
+        case SYS_lseek:
+            regs->eax = (uint32_t)fs_lseek((int)regs->ebx, (int32_t)regs->ecx, (int)regs->edx);
+            break;
+        case SYS_pread:
+            regs->eax = (uint32_t)fs_pread((int)regs->ebx, (void*)regs->ecx, (unsigned)regs->edx, regs->esi);
+            break;
+        case SYS_pwrite:
+            regs->eax = (uint32_t)fs_pwrite((int)regs->ebx, (const void*)regs->ecx, (unsigned)regs->edx, regs->esi);
+            break;
+        case SYS_readv:
+        case SYS_writev: {
+            struct vfs_iovec iov[VFS_IOV_MAX];
+            unsigned cnt = (unsigned)regs->edx;
+            if (copy_iov(regs->ecx, cnt, iov) != 0) { regs->eax = (uint32_t)-1; break; }
+            regs->eax = (uint32_t)(regs->eax == SYS_readv ? fs_readv((int)regs->ebx, iov, cnt)
+                                                          : fs_writev((int)regs->ebx, iov, cnt));
+            break;
+        }
         case SYS_close:
             regs->eax = (uint32_t)fs_close((int)regs->ebx);
             break;
@@ -121,6 +206,123 @@ void syscall_dispatch(struct registers* regs) {
         case SYS_fs_list:
             regs->eax = (uint32_t)fs_dump_list((char*)regs->ebx, (unsigned)regs->ecx);
             break;
+        case SYS_getdents:
+            regs->eax = (uint32_t)fs_getdents((int)regs->ebx, (void*)regs->ecx, (unsigned)regs->edx);
+            break;
+        case SYS_mmap: {
+            /* Copied in so mmap_map never reads user memory */
+            struct mmap_args a;
+            if (!regs->ebx || !user_ptr_ok(regs->ebx, sizeof(a))) { regs->eax = MAP_FAILED; break; }
+            memcpy(&a, (const void*)regs->ebx, sizeof(a));
+            regs->eax = mmap_map(process_current(), &a);
+            break;
+        }
+        case SYS_munmap:
+            regs->eax = (uint32_t)mmap_unmap(process_current(), regs->ebx, regs->ecx);
+            break;
+        case SYS_io_setup: {
+            struct io_ring_params params;
+            if (!regs->ecx || !user_ptr_ok(regs->ecx, sizeof(params))) { regs->eax = (uint32_t)-1; break; }
+            int id = io_ring_setup(process_current(), regs->ebx, &params);
+            if (id >= 0) memcpy((void*)regs->ecx, &params, sizeof(params));
+            regs->eax = (uint32_t)id;
+            break;
+        }
+        case SYS_io_enter:
+            regs->eax = (uint32_t)io_ring_enter(process_current(), (int)regs->ebx, regs->ecx,
+                                                regs->edx, regs->esi);
+            break;
+        case SYS_trace: {
+            /* Only the caller and its own children */
+            process_t* self = process_current();
+            process_t* p = regs->ebx ? process_find((int)regs->ebx) : self;
+            if (!self || !p || (p != self && p->ppid != self->pid)) { regs->eax = (uint32_t)-1; break; }
+            regs->eax = (uint32_t)systrace_set(p, (int)regs->ecx);
+            break;
+        }
+        case SYS_trace_read: {
+            uint32_t out = regs->ebx, max = regs->ecx, cursor = regs->edx;
+            if (!out || !cursor || max > 0xC0000000u / sizeof(struct systrace_rec) ||
+                !user_ptr_ok(out, max * sizeof(struct systrace_rec)) || !user_ptr_ok(cursor, sizeof(uint32_t))) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            regs->eax = (uint32_t)systrace_read((struct systrace_rec*)out, max, (uint32_t*)cursor);
+            break;
+        }
+        case SYS_sysstat: {
+            int pid = (int)regs->ebx;
+            const struct systrace_stats* st =
+                systrace_stats(pid < 0 ? 0 : pid ? process_find(pid) : process_current());
+            uint32_t out = regs->ecx;
+            if (!st || !out || out >= 0xC0000000u || sizeof(*st) > 0xC0000000u - out) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            memcpy((void*)out, st, sizeof(*st));
+            regs->eax = 0;
+            break;
+        }
+        case SYS_poll: {
+            uint32_t fds = regs->ebx, n = regs->ecx;
+            if (n > POLL_MAX_FDS || fds >= 0xC0000000u ||
+                n * sizeof(struct pollfd) > 0xC0000000u - fds) {
+                regs->eax = (uint32_t)-1;
+                break;
+            }
+            regs->eax = (uint32_t)fs_poll((struct pollfd*)fds, n, (int32_t)regs->edx);
+            break;
+        }
+        case SYS_pipe: {
+            int* fds = (int*)regs->ebx;
+            if (!fds || (uint32_t)fds >= 0xC0000000u - 8u) { regs->eax = (uint32_t)-1; break; }
+            regs->eax = (uint32_t)fs_pipe(fds);
+            break;
+        }
+        case SYS_ipc_call: {
+            /* The message never touches user memory: registers in, registers out. */
+            struct ipc_msg m;
+            m.w[0] = regs->ecx; m.w[1] = regs->edx; m.w[2] = regs->esi; m.w[3] = regs->edi;
+            int r = ipc_call((int)regs->ebx, &m);
+            if (r == 0) {
+                regs->ecx = m.w[0]; regs->edx = m.w[1]; regs->esi = m.w[2]; regs->edi = m.w[3];
+            }
+            regs->eax = (uint32_t)r;
+            break;
+        }
+        case SYS_grant:
+            regs->eax = (uint32_t)grant_create(process_current(), regs->ebx, regs->ecx,
+                                               (int)regs->edx, regs->esi);
+            break;
+        case SYS_grant_map:
+            regs->eax = grant_map(process_current(), (int)regs->ebx);
+            break;
+        case SYS_grant_revoke:
+            regs->eax = (uint32_t)grant_revoke(process_current(), (int)regs->ebx);
+            break;
+        case SYS_shm_create: {
+            const char* name = (const char*)regs->ebx;
+            if ((uint32_t)name >= 0xC0000000u - SHM_NAME_MAX) { regs->eax = (uint32_t)-1; break; }
+            regs->eax = (uint32_t)shm_create(process_current(), name, regs->ecx);
+            break;
+        }
+        case SYS_shm_map:
+            regs->eax = shm_map(process_current(), (int)regs->ebx);
+            break;
+        case SYS_shm_unmap:
+            regs->eax = (uint32_t)shm_unmap(process_current(), regs->ebx);
+            break;
+        case SYS_batch:
+            regs->eax = (uint32_t)sys_batch(regs);
+            break;
+        case SYS_dl_resolve:
+            regs->eax = dl_resolve(process_current(), regs->ebx, regs->ecx);
+            if (regs->eax == 0) {
+                /* Nothing sensible to return to: end the process like ld.so does. */
+                regs->ebx = 127;
+                goto do_exit;
+            }
+            break;
         case SYS_fork: {
             // Save current process context from interrupt frame
             process_t* proc = process_current();
@@ -155,17 +357,27 @@ void syscall_dispatch(struct registers* regs) {
             break;
         }
         case SYS_getpid: {
-            // For now, just return a fake PID without process management
-            regs->eax = 1; // Always return PID 1
+            /* Same value the vDSO page publishes; 1 outside a process. */
+            process_t* p = process_current();
+            regs->eax = p ? (uint32_t)p->pid : 1u;
             break;
         }
         case SYS_getppid: {
-            // For now, just return a fake PPID without process management
-            regs->eax = 0; // Always return PPID 0
+            process_t* p = process_current();
+            regs->eax = p ? (uint32_t)p->ppid : 0u;
             break;
         }
         default:
-            printf("Unknown syscall: %u\n", regs->eax);
+            klog(KLOG_PROC, KLOG_WARN, "Unknown syscall: %u\n", regs->eax);
             regs->eax = (uint32_t)-1;
     }
 }
+
+/* Entry from int 0x80 and SYSENTER: account the call around dispatch. */
+void syscall_dispatch(struct registers* regs) {
+    process_t* p = process_current();
+    uint32_t nr = regs->eax;
+    uint64_t t0 = systrace_enter(p, regs);
+    dispatch(regs);
+    systrace_exit(p, nr, regs->eax, t0);
+}
@@ -0,0 +1,206 @@
+#include <kernel/systrace.h>
+#include <kernel/process.h>
+#include <kernel/syscall.h>
+#include <kernel/cpu.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+static struct systrace_stats global;
+static struct systrace_rec ring[SYSTRACE_RING];
+static uint32_t ring_seq;              /* seq of the next record */
+static int arm_exec;
+
+/* Counters of the last traced process to exit, for `strace PATH`. */
+static struct systrace_stats last_stats;
+static int last_pid = -1;
+
+static const char* const names[] = {
+    [SYS_write] = "write", [SYS_exit] = "exit", [SYS_read] = "read",
+    [SYS_open] = "open", [SYS_close] = "close", [SYS_sbrk] = "sbrk",
+    [SYS_time] = "time", [SYS_fs_list] = "fs_list", [SYS_fwrite] = "fwrite",
+    [SYS_fork] = "fork", [SYS_wait] = "wait", [SYS_getpid] = "getpid",
+    [SYS_getppid] = "getppid", [SYS_getdents] = "getdents", [SYS_mmap] = "mmap",
+    [SYS_munmap] = "munmap", [SYS_creat] = "creat", [SYS_unlink] = "unlink",
+    [SYS_sendfile] = "sendfile", [SYS_io_setup] = "io_setup",
+    [SYS_io_enter] = "io_enter", [SYS_lseek] = "lseek", [SYS_pread] = "pread",
+    [SYS_pwrite] = "pwrite", [SYS_readv] = "readv", [SYS_writev] = "writev",
+    [SYS_dl_resolve] = "dl_resolve", [SYS_batch] = "batch",
+    [SYS_trace] = "trace", [SYS_trace_read] = "trace_read",
+    [SYS_sysstat] = "sysstat", [SYS_poll] = "poll",
+    [SYS_pipe] = "pipe",
+    [SYS_ipc_call] = "ipc_call",
+    [SYS_grant] = "grant",
+    [SYS_grant_map] = "grant_map",
+    [SYS_grant_revoke] = "grant_revoke",
+    [SYS_shm_create] = "shm_create",
+    [SYS_shm_map] = "shm_map",
+    [SYS_shm_unmap] = "shm_unmap",
+};
+
+const char* systrace_name(uint32_t nr) {
+    if (nr < sizeof(names) / sizeof(names[0]) && names[nr]) return names[nr];
+    return "?";
+}
+
+static unsigned slot(uint32_t nr) {
+    return nr < SYSTRACE_NR ? nr : SYSTRACE_NR - 1;
+}
+
+static unsigned bucket(uint32_t cycles) {
+    unsigned b = 0;
+    cycles >>= 8;
+    while (cycles && b < SYSTRACE_BUCKETS - 1) { cycles >>= 1; b++; }
+    return b;
+}
+
+static struct systrace_rec* ring_next(void) {
+    struct systrace_rec* r = &ring[ring_seq % SYSTRACE_RING];
+    r->seq = ring_seq++;
+    return r;
+}
+
+/* Per-process counters live in a frame of their own, taken on the first
+   call so idle slots cost nothing. */
+static struct systrace_stats* proc_stats(process_t* p) {
+    if (!p->sys_stats_phys) {
+        uint32_t phys = pmm_alloc_frame();
+        if (!phys) return 0;
+        memset(vmm_phys_to_virt(phys), 0, sizeof(struct systrace_stats));
+        p->sys_stats_phys = phys;
+    }
+    return (struct systrace_stats*)vmm_phys_to_virt(p->sys_stats_phys);
+}
+
+uint64_t systrace_enter(struct process* p, const struct registers* regs) {
+    unsigned s = slot(regs->eax);
+    global.calls[s]++;
+    if (p) {
+        struct systrace_stats* ps = proc_stats(p);
+        if (ps) ps->calls[s]++;
+        if (p->traced) {
+            struct systrace_rec* r = ring_next();
+            r->pid = (int16_t)p->pid;
+            r->nr = (uint8_t)regs->eax;
+            r->kind = SYSTRACE_ENTER;
+            r->args[0] = regs->ebx;
+            r->args[1] = regs->ecx;
+            r->args[2] = regs->edx;
+            r->result = 0;
+            r->cycles = 0;
+        }
+    }
+    return rdtsc();
+}
+
+void systrace_exit(struct process* p, uint32_t nr, uint32_t result, uint64_t t0) {
+    uint64_t d = rdtsc() - t0;
+    uint32_t cycles = d >> 32 ? 0xFFFFFFFFu : (uint32_t)d;
+    unsigned s = slot(nr), b = bucket(cycles);
+    global.cycles[s] += cycles;
+    global.hist[s][b]++;
+    if (!p) return;
+    if (p->sys_stats_phys) {
+        struct systrace_stats* ps = (struct systrace_stats*)vmm_phys_to_virt(p->sys_stats_phys);
+        ps->cycles[s] += cycles;
+        ps->hist[s][b]++;
+    }
+    if (p->traced) {
+        struct systrace_rec* r = ring_next();
+        r->pid = (int16_t)p->pid;
+        r->nr = (uint8_t)nr;
+        r->kind = SYSTRACE_EXIT;
+        r->args[0] = r->args[1] = r->args[2] = 0;
+        r->result = (int32_t)result;
+        r->cycles = cycles;
+    }
+}
+
+int systrace_set(struct process* p, int on) {
+    if (!p) return -1;
+    p->traced = on ? 1 : 0;
+    return 0;
+}
+
+void systrace_arm_exec(int on) {
+    arm_exec = on;
+    if (on) last_pid = -1;
+}
+
+int systrace_last_pid(void) { return last_pid; }
+
+uint32_t systrace_cursor(void) { return ring_seq; }
+
+void systrace_on_exec(struct process* p) {
+    if (!arm_exec || !p) return;
+    arm_exec = 0;
+    p->traced = 1;
+}
+
+void systrace_release(struct process* p) {
+    if (!p->sys_stats_phys) return;
+    if (p->traced) {
+        memcpy(&last_stats, vmm_phys_to_virt(p->sys_stats_phys), sizeof(last_stats));
+        last_pid = p->pid;
+    }
+    pmm_free_frame(p->sys_stats_phys);
+    p->sys_stats_phys = 0;
+}
+
+int systrace_read(struct systrace_rec* out, unsigned max, uint32_t* cursor) {
+    uint32_t from = *cursor;
+    if (ring_seq - from > SYSTRACE_RING) from = ring_seq - SYSTRACE_RING;
+    unsigned n = 0;
+    while (from != ring_seq && n < max) {
+        out[n++] = ring[from % SYSTRACE_RING];
+        from++;
+    }
+    *cursor = from;
+    return (int)n;
+}
+
+const struct systrace_stats* systrace_stats(struct process* p) {
+    if (!p) return &global;
+    return p->sys_stats_phys ? (const struct systrace_stats*)vmm_phys_to_virt(p->sys_stats_phys) : 0;
+}
+
+void systrace_print_stats(int pid) {
+    const struct systrace_stats* st = &global;
+    if (pid >= 0) {
+        process_t* p = process_find(pid);
+        st = p ? systrace_stats(p) : (pid == last_pid ? &last_stats : 0);
+        if (!st) { printf("systrace: no counters for pid %d\n", pid); return; }
+        printf("syscalls of pid %d:\n", pid);
+    } else {
+        printf("syscalls (system-wide):\n");
+    }
+    printf("  nr name        calls   avg cycles  histogram (<256, x2 ... >=256K)\n");
+    for (unsigned i = 0; i < SYSTRACE_NR; ++i) {
+        if (!st->calls[i]) continue;
+        uint32_t done = 0;
+        for (unsigned b = 0; b < SYSTRACE_BUCKETS; ++b) done += st->hist[i][b];
+        uint32_t avg = done ? (uint32_t)(st->cycles[i] / done) : 0;
+        printf("  %u %s  %u  %u  [", i, i == SYSTRACE_NR - 1 ? "other" : systrace_name(i),
+               st->calls[i], avg);
+        for (unsigned b = 0; b < SYSTRACE_BUCKETS; ++b) printf(b ? " %u" : "%u", st->hist[i][b]);
+        printf("]\n");
+    }
+}
+
+void systrace_print_log(int pid, uint32_t from) {
+    uint32_t cursor = from;
+    struct systrace_rec r;
+    unsigned shown = 0;
+    while (systrace_read(&r, 1, &cursor) == 1) {
+        if (pid >= 0 && r.pid != pid) continue;
+        if (r.kind == SYSTRACE_ENTER) {
+            printf("[%d] %s(0x%x, 0x%x, 0x%x)\n", r.pid, systrace_name(r.nr),
+                   r.args[0], r.args[1], r.args[2]);
+        } else {
+            printf("[%d] %s = %d  (%u cycles)\n", r.pid, systrace_name(r.nr), r.result, r.cycles);
+        }
+        shown++;
+    }
+    if (!shown) printf("systrace: log empty\n");
+}
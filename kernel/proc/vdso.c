@@ -0,0 +1,101 @@
+#include <kernel/vdso.h>
+#include <kernel/process.h>
+#include <kernel/htas.h>
+#include <kernel/cpu.h>
+#include <kernel/pit.h>
+#include <kernel/pmm.h>
+#include <kernel/vmm.h>
+#include <kernel/stdio.h>
+#include <string.h>
+
+static uint32_t vdso_phys;
+static struct vdso_data* vd;     /* kernel view through the physmap */
+static uint64_t second_tsc;      /* TSC when the current second began */
+static uint32_t second_ticks;
+static volatile uint64_t second_cycles;  /* TSC cycles the last full second took */
+
+/* Writers run with interrupts off, so the timer never nests inside an
+   update; readers are user code, which cannot run until it is done. */
+static inline uint32_t write_begin(void) {
+    uint32_t flags = irq_save();
+    vd->seq++;
+    __asm__ volatile("" ::: "memory");
+    return flags;
+}
+
+static inline void write_end(uint32_t flags) {
+    __asm__ volatile("" ::: "memory");
+    vd->seq++;
+    irq_restore(flags);
+}
+
+void vdso_init(void) {
+    if (vd) return;
+    vdso_phys = pmm_alloc_frame();
+    if (!vdso_phys) { printf("vdso: no frame\n"); return; }
+    vd = (struct vdso_data*)vmm_phys_to_virt(vdso_phys);
+    memset(vd, 0, 4096);
+    vd->hz = pit_hz();
+    vd->ns_per_tick = vd->hz ? 1000000000u / vd->hz : 0;
+    vd->pid = vd->ppid = -1;
+    vd->htas_intent = PROFILE_DEFAULT;
+    second_tsc = rdtsc();
+}
+
+void vdso_tick(void) {
+    if (!vd) return;
+    uint64_t now = rdtsc();
+    uint32_t flags = write_begin();
+    vd->ticks = pit_ticks();
+    vd->tick_tsc = now;
+    /* Rescale once a second from the cycles that second took. */
+    if (vd->hz && ++second_ticks >= vd->hz) {
+        uint64_t cycles = now - second_tsc;
+        second_cycles = cycles;
+        if (cycles) {
+            /* Largest shift whose multiplier still fits 32 bits; a TSC at
+               or below 1 GHz needs a shift under 32. */
+            uint64_t mult = (1000000000ull << 32) / cycles;
+            uint32_t shift = 32;
+            while (mult > 0xFFFFFFFFull) { mult >>= 1; shift--; }
+            vd->tsc_mult = (uint32_t)mult;
+            vd->tsc_shift = shift;
+        }
+        second_tsc = now;
+        second_ticks = 0;
+    }
+    write_end(flags);
+}
+
+uint32_t vdso_tsc_per_ms(void) {
+    if (!vd || !vd->hz) return 0;
+    return (uint32_t)(second_cycles / 1000u);
+}
+
+void vdso_set_process(struct process* proc) {
+    if (!vd) return;
+    uint32_t flags = write_begin();
+    vd->pid = proc ? proc->pid : -1;
+    vd->ppid = proc ? proc->ppid : -1;
+    if (proc && proc->htas_info) {
+        vd->htas_intent = proc->htas_info->profile.intent;
+        vd->htas_affinity = proc->htas_info->cpu_affinity_mask;
+        vd->htas_priority_boost = proc->htas_info->priority_boost;
+    } else {
+        vd->htas_intent = PROFILE_DEFAULT;
+        vd->htas_affinity = 0;
+        vd->htas_priority_boost = 0;
+    }
+    write_end(flags);
+}
+
+int vdso_map(void) {
+    if (!vd) return -1;
+    if (vmm_get_pte(VDSO_DATA_ADDR) & PAGE_USER) return 0;
+    pmm_ref_frame(vdso_phys); /* dropped with the address space */
+    if (vmm_map(VDSO_DATA_ADDR, vdso_phys, PAGE_USER) != 0) {
+        pmm_unref_frame(vdso_phys);
+        return -1;
+    }
+    return 0;
+}
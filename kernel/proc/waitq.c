@@ -0,0 +1,42 @@
+#include <kernel/waitq.h>
+#include <kernel/cpu.h>
+#include <kernel/pit.h>
+#include <kernel/klog.h>
+
+void waitq_add(struct wait_queue* q, struct waiter* w) {
+    uint32_t flags = irq_save();
+    w->next = q->head;
+    q->head = w;
+    irq_restore(flags);
+}
+
+void waitq_remove(struct wait_queue* q, struct waiter* w) {
+    uint32_t flags = irq_save();
+    for (struct waiter** p = &q->head; *p; p = &(*p)->next) {
+        if (*p == w) { *p = w->next; break; }
+    }
+    w->next = 0;
+    irq_restore(flags);
+}
+
+void waitq_wake(struct wait_queue* q) {
+    for (struct waiter* w = q->head; w; w = w->next) *w->flag = 1;
+}
+
+int waitq_sleep(volatile uint32_t* flag, uint64_t deadline) {
+    for (;;) {
+        /* Idle: a good moment for klogd to write out pending records. */
+        klog_idle();
+        __asm__ volatile("cli" ::: "memory");
+        if (*flag) break;
+        if (deadline && pit_ticks() >= deadline) {
+            __asm__ volatile("sti" ::: "memory");
+            return 0;
+        }
+        /* sti takes effect after hlt starts, so a wake-up between the check
+           and the halt still ends the halt. */
+        __asm__ volatile("sti; hlt" ::: "memory");
+    }
+    __asm__ volatile("sti" ::: "memory");
+    return 1;
+}
@@ -3,6 +3,7 @@
 #include <kernel/tty.h>
 #include <kernel/kmalloc.h>
 #include <kernel/stdio.h>
+#include <kernel/vdso.h>
 #include <string.h>
 
 cpu_info_t g_cpu_topology[NUM_CPUS] = {
@@ -202,6 +203,7 @@ int sys_sched_set_profile(uint32_t pid, const task_profile_t* profile) {
            pid, intent_name[profile->intent], 
            proc->htas_info->cpu_affinity_mask,
            proc->htas_info->preferred_numa_node);
+    if (proc == process_current()) vdso_set_process(proc);
     
     return 0;
 }
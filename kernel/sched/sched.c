@@ -29,7 +29,7 @@ static int current = -1;
 
 extern void ctx_switch(uint32_t* old_esp, uint32_t new_esp);
 
-static void kthread_trampoline(void);
+static void kthread_trampoline(kthread_fn fn, void* arg);
 static void apply_aging(void);
 static int select_next(void);
 static void refill_slice(int tid);
@@ -49,8 +49,7 @@ static uint32_t new_stack_with_trampoline(kthread_fn fn, void* arg){
     *(--sp) = 0;
     /* entry EIP for switch return path */
     *(--sp) = (uint32_t)(uintptr_t)&kthread_trampoline;
-    /* minimal callee-saved registers for ctx switch compatibility */
-    /* reserve pusha frame: edi,esi,ebp,esp,ebx,edx,ecx,eax if needed by asm */
+    /* pusha frame ctx_switch pops: edi,esi,ebp,esp,ebx,edx,ecx,eax */
     for (int i=0;i<8;i++) *(--sp) = 0;
     return (uint32_t)(uintptr_t)sp;
 }
@@ -65,13 +64,13 @@ void sched_init(void){
     refill_slice(0);
 }
 
-int kthread_create(kthread_fn fn, void* arg, const char* name){
+static int spawn(kthread_fn fn, void* arg, const char* name, tstate_t state){
     for (int i=1;i<MAX_THREADS;i++){
         if (th[i].state == T_UNUSED){
             uint32_t esp = new_stack_with_trampoline(fn,arg);
             if (!esp) return -1;
             th[i].esp = esp;
-            th[i].state = T_READY;
+            th[i].state = state;
             int j=0; if (name){ while (name[j] && j<15){ th[i].name[j]=name[j]; j++; } }
             th[i].name[j]=0;
             th[i].priority = DEFAULT_PRIORITY;
@@ -83,6 +82,38 @@ int kthread_create(kthread_fn fn, void* arg, const char* name){
     return -1;
 }
 
+int kthread_create(kthread_fn fn, void* arg, const char* name){
+    return spawn(fn, arg, name, T_READY);
+}
+
+int kthread_create_blocked(kthread_fn fn, void* arg, const char* name){
+    return spawn(fn, arg, name, T_BLOCKED);
+}
+
+int sched_current(void){
+    return current;
+}
+
+int sched_get_priority(int pid){
+    if (pid < 0 || pid >= MAX_THREADS || th[pid].state == T_UNUSED) return -1;
+    return th[pid].priority;
+}
+
+/* Hand the CPU to tid directly: the caller blocks and tid runs on what is
+   left of the caller's slice, without select_next or aging. Whoever wakes
+   the caller again does so with another sched_switch_to. */
+void sched_switch_to(int tid){
+    if (tid < 0 || tid >= MAX_THREADS || tid == current) return;
+    if (th[tid].state != T_BLOCKED) return;
+    int prev = current;
+    th[prev].state = T_BLOCKED;
+    th[tid].state = T_RUNNING;
+    th[tid].wait_ticks = 0;
+    th[tid].slice_left = th[prev].slice_left;
+    current = tid;
+    ctx_switch(&th[prev].esp, th[tid].esp);
+}
+
 int sched_set_priority(int pid, int priority){
     if (pid < 0 || pid >= MAX_THREADS) return -1;
     if (priority < SCHED_PRIORITY_REALTIME || priority >= SCHED_PRIORITY_LEVELS) return -1;
@@ -139,13 +170,11 @@ void sched_tick(void){
     }
 }
 
-/* Runs on a fresh stack for the new thread */
-static void kthread_trampoline(void){
-    struct start_pack pack;
-    /* stack layout: [pusha..], ret, pack */
-    uint32_t* sp; __asm__ volatile ("movl %%esp,%0":"=r"(sp));
-    memcpy(&pack, (void*)(sp + 1), sizeof(pack));
-    pack.fn(pack.arg);
+/* Runs on a fresh stack for the new thread. ctx_switch "returns" here with
+   the zero return address and the start pack above it, i.e. as if called
+   as kthread_trampoline(pack.fn, pack.arg). */
+static void kthread_trampoline(kthread_fn fn, void* arg){
+    fn(arg);
     /* If function returns, just park */
     for(;;) { __asm__ volatile("hlt"); }
 }
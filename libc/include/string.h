@@ -13,6 +13,7 @@ int memcmp(const void*, const void*, size_t);
 void* memcpy(void* __restrict, const void* __restrict, size_t);
 void* memmove(void*, const void*, size_t);
 void* memset(void*, int, size_t);
+int strcmp(const char*, const char*);
 size_t strlen(const char*);
 
 #ifdef __cplusplus
@@ -21,6 +21,18 @@ sudo cp user/minitest.elf /mnt/jimirfs/ 2>/dev/null || echo "minitest.elf not fo
 sudo cp user/forktest.elf /mnt/jimirfs/ 2>/dev/null || echo "forktest.elf not found"
 sudo cp user/proctest.elf /mnt/jimirfs/ 2>/dev/null || echo "proctest.elf not found"
 sudo cp user/simplefork.elf /mnt/jimirfs/ 2>/dev/null || echo "simplefork.elf not found"
+sudo cp user/iobench.elf /mnt/jimirfs/ 2>/dev/null || echo "iobench.elf not found"
+sudo cp user/sysbench.elf /mnt/jimirfs/ 2>/dev/null || echo "sysbench.elf not found"
+sudo cp user/batchbench.elf /mnt/jimirfs/ 2>/dev/null || echo "batchbench.elf not found"
+sudo cp user/strace.elf /mnt/jimirfs/ 2>/dev/null || echo "strace.elf not found"
+sudo cp user/polltest.elf /mnt/jimirfs/ 2>/dev/null || echo "polltest.elf not found"
+sudo cp user/pipebench.elf /mnt/jimirfs/ 2>/dev/null || echo "pipebench.elf not found"
+sudo cp user/ipcbench.elf /mnt/jimirfs/ 2>/dev/null || echo "ipcbench.elf not found"
+sudo cp user/grantbench.elf /mnt/jimirfs/ 2>/dev/null || echo "grantbench.elf not found"
+sudo cp user/shmring.elf /mnt/jimirfs/ 2>/dev/null || echo "shmring.elf not found"
+# Shared libraries for the dynamically linked programs
+sudo mkdir -p /mnt/jimirfs/lib
+sudo cp user/libc.so /mnt/jimirfs/lib/
 
 # List contents
 echo "Filesystem contents:"
@@ -0,0 +1,101 @@
+/* batchbench.c - Small writes one trap each against SYS_batch.
+ *
+ * Appends RECORDS 16-byte records to a scratch file with one fwrite trap
+ * per record, then again with BATCH writes per batch() call, and reports
+ * TSC cycles per record for both.
+ */
+
+extern int write(int fd, const char* buf, unsigned len);
+extern int creat(const char* path);
+extern int close(int fd);
+extern int unlink(const char* path);
+
+struct sys_batch_ent { unsigned nr; unsigned args[4]; int result; };
+#define BATCH_STOP_ON_ERR 0x1
+extern int batch(struct sys_batch_ent* ents, unsigned count, unsigned flags);
+
+#define SYS_fwrite 9
+#define RECORDS    10000u
+#define RECORD     16u
+#define BATCH      64u
+
+static const char* path = "/tmp/batchbench.dat";
+static char record[RECORD] = "0123456789abcde\n";
+static struct sys_batch_ent ents[BATCH];
+
+static void print(const char* s) {
+    unsigned len = 0;
+    while (s[len]) len++;
+    write(1, s, len);
+}
+
+static void print_num(unsigned n) {
+    char buf[12];
+    int i = 0;
+    do { buf[i++] = (char)('0' + n % 10); n /= 10; } while (n);
+    while (i > 0) { char c = buf[--i]; write(1, &c, 1); }
+}
+
+static unsigned long long rdtsc(void) {
+    unsigned long long t;
+    __asm__ volatile("rdtsc" : "=A"(t));
+    return t;
+}
+
+static int sys_fwrite(int fd, const void* buf, unsigned len) {
+    int r;
+    __asm__ volatile("int $0x80" : "=a"(r) : "a"(SYS_fwrite), "b"(fd), "c"(buf), "d"(len) : "memory");
+    return r;
+}
+
+/* kcycles (units of 1024 cycles) over RECORDS writes -> cycles per write. */
+static unsigned per_record(unsigned kcycles) {
+    return (kcycles / RECORDS) * 1024u + (kcycles % RECORDS) * 1024u / RECORDS;
+}
+
+int main(void) {
+    print("batchbench: 10000 small writes\n");
+    int bad = 0;
+
+    int fd = creat(path);
+    if (fd < 0) { print("cannot create "); print(path); print("\n"); return 1; }
+    unsigned long long t0 = rdtsc();
+    for (unsigned i = 0; i < RECORDS; ++i) {
+        if (sys_fwrite(fd, record, RECORD) != (int)RECORD) bad++;
+    }
+    unsigned long long t1 = rdtsc();
+    close(fd);
+
+    fd = creat(path);
+    if (fd < 0) { print("cannot create "); print(path); print("\n"); return 1; }
+    for (unsigned i = 0; i < BATCH; ++i) {
+        ents[i].nr = SYS_fwrite;
+        ents[i].args[0] = (unsigned)fd;
+        ents[i].args[1] = (unsigned)record;
+        ents[i].args[2] = RECORD;
+    }
+    unsigned long long t2 = rdtsc();
+    for (unsigned done = 0; done < RECORDS; ) {
+        unsigned n = RECORDS - done < BATCH ? RECORDS - done : BATCH;
+        int ran = batch(ents, n, BATCH_STOP_ON_ERR);
+        if (ran != (int)n || ents[n - 1].result != (int)RECORD) { bad++; break; }
+        done += n;
+    }
+    unsigned long long t3 = rdtsc();
+    close(fd);
+    unlink(path);
+
+    unsigned plain_k = (unsigned)((t1 - t0) >> 10);
+    unsigned batch_k = (unsigned)((t3 - t2) >> 10);
+    print("  one trap each: "); print_num(per_record(plain_k)); print(" cycles/write\n");
+    print("  batched:       "); print_num(per_record(batch_k)); print(" cycles/write (batch ");
+    print_num(BATCH); print(")\n");
+    if (batch_k) {
+        unsigned x100 = plain_k * 100u / batch_k;
+        print("  speedup: x"); print_num(x100 / 100u); print(".");
+        if (x100 % 100u < 10) print("0");
+        print_num(x100 % 100u); print("\n");
+    }
+    if (bad) { print("  errors: "); print_num((unsigned)bad); print("\n"); }
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/* iobench.c - Compare synchronous read() against batched submission rings.
+ *
+ * Writes a scratch file through the ring, then reads it back PASSES times
+ * with one read() per 4 KiB block and again with BATCH reads queued per
+ * io_enter(). Reports TSC cycles per block for both.
+ */
+
+extern void exit(int code);
+extern int write(int fd, const char* buf, unsigned len);
+extern int read(int fd, void* buf, unsigned len);
+extern int open(const char* path);
+extern int close(int fd);
+extern int creat(const char* path);
+extern int unlink(const char* path);
+
+/* Layout shared with the kernel (kernel/include/kernel/ioring.h). */
+struct io_ring_hdr {
+    volatile unsigned sq_head, sq_tail, cq_head, cq_tail;
+    unsigned sq_entries, cq_entries, sqes_off, cqes_off;
+    volatile unsigned cq_overflow;
+    unsigned reserved[7];
+};
+struct io_sqe {
+    unsigned char opcode, flags;
+    unsigned short reserved;
+    int fd;
+    unsigned off, addr, len, user_data;
+    unsigned pad[2];
+};
+struct io_cqe { unsigned user_data; int res; };
+struct io_ring_params { unsigned sq_entries, cq_entries, ring_addr, ring_size; };
+
+#define IO_OP_READ  1
+#define IO_OP_WRITE 2
+#define IO_OP_FSYNC 3
+#define IO_ENTER_GETEVENTS 1
+
+extern int io_setup(unsigned entries, void* params);
+extern int io_enter(int ring, unsigned to_submit, unsigned min_complete, unsigned flags);
+
+#define BLOCK   4096u
+#define BLOCKS  64u       /* 256 KiB file */
+#define BATCH   32u
+#define PASSES  8u
+
+static const char* path = "/tmp/iobench.dat";
+static unsigned char bufs[BATCH][BLOCK];
+
+static struct io_ring_hdr* hdr;
+static struct io_sqe* sqes;
+static struct io_cqe* cqes;
+static int ring;
+
+static void print(const char* s) {
+    unsigned len = 0;
+    while (s[len]) len++;
+    write(1, s, len);
+}
+
+static void print_num(unsigned n) {
+    char buf[12];
+    int i = 0;
+    do { buf[i++] = (char)('0' + n % 10); n /= 10; } while (n);
+    while (i > 0) { char c = buf[--i]; write(1, &c, 1); }
+}
+
+static unsigned long long rdtsc(void) {
+    unsigned long long t;
+    __asm__ volatile("rdtsc" : "=A"(t));
+    return t;
+}
+
+/* kcycles (units of 1024 cycles) spent on all passes -> cycles per block. */
+static unsigned per_block(unsigned kcycles) {
+    unsigned ops = BLOCKS * PASSES;
+    return (kcycles / ops) * 1024u + (kcycles % ops) * 1024u / ops;
+}
+
+static void queue(unsigned char op, int fd, unsigned off, void* buf, unsigned len, unsigned tag) {
+    struct io_sqe* e = &sqes[hdr->sq_tail & (hdr->sq_entries - 1)];
+    e->opcode = op;
+    e->flags = 0;
+    e->fd = fd;
+    e->off = off;
+    e->addr = (unsigned)buf;
+    e->len = len;
+    e->user_data = tag;
+    __asm__ volatile("" ::: "memory");
+    hdr->sq_tail++;
+}
+
+/* Submit everything queued and reap; returns the number of failed CQEs. */
+static int submit_and_reap(unsigned n, unsigned expect) {
+    int bad = 0;
+    if (io_enter(ring, n, n, IO_ENTER_GETEVENTS) != (int)n) return (int)n;
+    while (hdr->cq_head != hdr->cq_tail) {
+        struct io_cqe* c = &cqes[hdr->cq_head & (hdr->cq_entries - 1)];
+        if (c->res != (int)expect) bad++;
+        hdr->cq_head++;
+    }
+    return bad;
+}
+
+int main(void) {
+    print("iobench: submission rings vs read()\n");
+
+    struct io_ring_params p;
+    ring = io_setup(BATCH, &p);
+    if (ring < 0) { print("io_setup failed\n"); return 1; }
+    hdr = (struct io_ring_hdr*)p.ring_addr;
+    sqes = (struct io_sqe*)(p.ring_addr + hdr->sqes_off);
+    cqes = (struct io_cqe*)(p.ring_addr + hdr->cqes_off);
+
+    int fd = creat(path);
+    if (fd < 0) { print("cannot create "); print(path); print("\n"); return 1; }
+    for (unsigned i = 0; i < BLOCK; ++i) bufs[0][i] = (unsigned char)i;
+    int bad = 0;
+    for (unsigned b = 0; b < BLOCKS; b += BATCH) {
+        for (unsigned i = 0; i < BATCH; ++i) queue(IO_OP_WRITE, fd, (b + i) * BLOCK, bufs[0], BLOCK, b + i);
+        bad += submit_and_reap(BATCH, BLOCK);
+    }
+    queue(IO_OP_FSYNC, fd, 0, 0, 0, 0);
+    bad += submit_and_reap(1, 0);
+    close(fd);
+    if (bad) { print("write through ring failed\n"); unlink(path); return 1; }
+
+    /* Synchronous: one trap per block. */
+    unsigned long long t0 = rdtsc();
+    for (unsigned pass = 0; pass < PASSES; ++pass) {
+        fd = open(path);
+        if (fd < 0) { print("open failed\n"); unlink(path); return 1; }
+        for (unsigned b = 0; b < BLOCKS; ++b) {
+            if (read(fd, bufs[b % BATCH], BLOCK) != (int)BLOCK) bad++;
+        }
+        close(fd);
+    }
+    unsigned long long t1 = rdtsc();
+
+    /* Ring: one trap per BATCH blocks. */
+    for (unsigned pass = 0; pass < PASSES; ++pass) {
+        fd = open(path);
+        if (fd < 0) { print("open failed\n"); unlink(path); return 1; }
+        for (unsigned b = 0; b < BLOCKS; b += BATCH) {
+            for (unsigned i = 0; i < BATCH; ++i) queue(IO_OP_READ, fd, (b + i) * BLOCK, bufs[i], BLOCK, b + i);
+            bad += submit_and_reap(BATCH, BLOCK);
+        }
+        close(fd);
+    }
+    unsigned long long t2 = rdtsc();
+    unlink(path);
+
+    /* Work in units of 1024 cycles: there is no 64-bit divide here. */
+    unsigned sync_k = (unsigned)((t1 - t0) >> 10);
+    unsigned ring_k = (unsigned)((t2 - t1) >> 10);
+    print("  read():  "); print_num(per_block(sync_k)); print(" cycles/block\n");
+    print("  ring:    "); print_num(per_block(ring_k)); print(" cycles/block (batch ");
+    print_num(BATCH); print(")\n");
+    if (ring_k) {
+        unsigned x100 = sync_k * 100u / ring_k;
+        print("  speedup: x"); print_num(x100 / 100u); print(".");
+        if (x100 % 100u < 10) print("0");
+        print_num(x100 % 100u); print("\n");
+    }
+    if (bad) { print("  errors: "); print_num((unsigned)bad); print("\n"); }
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+/* polltest.c - Wait on the keyboard and a timer at once.
+ *
+ * Polls stdin and /dev/ttyS0 with a one second timeout: each timeout
+ * prints a tick, each ready fd has its input echoed with the fd it came
+ * from. Typing 'q' on either ends the test. The process sleeps in poll()
+ * between events instead of spinning on read.
+ */
+
+extern int write(int fd, const char* buf, unsigned len);
+extern int read(int fd, void* buf, unsigned len);
+extern int open(const char* path);
+extern int close(int fd);
+
+struct pollfd { int fd; short events; short revents; };
+#define POLLIN   0x001
+#define POLLNVAL 0x020
+extern int poll(struct pollfd* fds, unsigned nfds, int timeout_ms);
+
+#define TICK_MS   1000
+#define MAX_TICKS 30
+
+static void print(const char* s) {
+    unsigned len = 0;
+    while (s[len]) len++;
+    write(1, s, len);
+}
+
+static void print_num(unsigned n) {
+    char buf[12];
+    int i = 0;
+    do { buf[i++] = (char)('0' + n % 10); n /= 10; } while (n);
+    while (i > 0) { char c = buf[--i]; write(1, &c, 1); }
+}
+
+int main(void) {
+    struct pollfd fds[2];
+    unsigned nfds = 1;
+    fds[0].fd = 0;
+    fds[0].events = POLLIN;
+    int tty = open("/dev/ttyS0");
+    if (tty >= 0) {
+        fds[1].fd = tty;
+        fds[1].events = POLLIN;
+        nfds = 2;
+    }
+
+    print("polltest: type a line (or on the serial line), 'q' quits\n");
+    unsigned ticks = 0;
+    for (;;) {
+        int n = poll(fds, nfds, TICK_MS);
+        if (n < 0) { print("polltest: poll failed\n"); break; }
+        if (n == 0) {
+            print("tick ");
+            print_num(++ticks);
+            print("\n");
+            if (ticks >= MAX_TICKS) break;
+            continue;
+        }
+        int quit = 0;
+        for (unsigned i = 0; i < nfds; ++i) {
+            if (fds[i].revents & POLLNVAL) { fds[i].fd = -1; continue; }
+            if (!(fds[i].revents & POLLIN)) continue;
+            char buf[64];
+            int r = read(fds[i].fd, buf, sizeof(buf));
+            if (r <= 0) continue;
+            print("fd ");
+            print_num((unsigned)fds[i].fd);
+            print(": ");
+            write(1, buf, (unsigned)r);
+            if (buf[r - 1] != '\n') print("\n");
+            if (buf[0] == 'q') quit = 1;
+        }
+        if (quit) break;
+    }
+    if (tty >= 0) close(tty);
+    return 0;
+}
@@ -0,0 +1,113 @@
+/* sysbench.c - Null system call latency: int 0x80 against SYSENTER, and
+ * the clock read through a trap against the vDSO data page.
+ *
+ * Times ITERS getpid() calls through each entry path (getpid does no work
+ * in the kernel) and ITERS reads of the time, and reports TSC cycles per
+ * call.
+ */
+
+extern int write(int fd, const char* buf, unsigned len);
+extern int getpid(void);
+extern int sysenter_syscall(int nr, unsigned a, unsigned b, unsigned c, unsigned d);
+extern unsigned vdso_time(void);
+extern unsigned long long clock_monotonic_ns(void);
+extern int vdso_getpid(void);
+
+#define SYS_time   7
+#define SYS_getpid 12
+#define ITERS      100000u
+
+static void print(const char* s) {
+    unsigned len = 0;
+    while (s[len]) len++;
+    write(1, s, len);
+}
+
+static void print_num(unsigned n) {
+    char buf[12];
+    int i = 0;
+    do { buf[i++] = (char)('0' + n % 10); n /= 10; } while (n);
+    while (i > 0) { char c = buf[--i]; write(1, &c, 1); }
+}
+
+static unsigned long long rdtsc(void) {
+    unsigned long long t;
+    __asm__ volatile("rdtsc" : "=A"(t));
+    return t;
+}
+
+/* Same test the kernel uses before programming the SYSENTER MSRs. */
+static int have_sysenter(void) {
+    unsigned eax = 1, ebx, ecx, edx;
+    __asm__ volatile("cpuid" : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    unsigned family = (eax >> 8) & 0xF, model = (eax >> 4) & 0xF, stepping = eax & 0xF;
+    if (family == 6 && model < 3 && stepping < 3) return 0;
+    return (edx >> 11) & 1;
+}
+
+static unsigned sys_time(void) {
+    unsigned ret;
+    __asm__ volatile("int $0x80" : "=a"(ret) : "a"(SYS_time) : "memory");
+    return ret;
+}
+
+/* kcycles (units of 1024 cycles) over ITERS calls -> cycles per call. */
+static unsigned per_call(unsigned kcycles) {
+    return (kcycles / ITERS) * 1024u + (kcycles % ITERS) * 1024u / ITERS;
+}
+
+static void print_ratio(unsigned slow_k, unsigned fast_k) {
+    if (!fast_k) return;
+    unsigned x100 = slow_k * 100u / fast_k;
+    print("  speedup:  x"); print_num(x100 / 100u); print(".");
+    if (x100 % 100u < 10) print("0");
+    print_num(x100 % 100u); print("\n");
+}
+
+static void bench_time(void) {
+    print("sysbench: clock read\n");
+    unsigned long long t0 = rdtsc();
+    for (unsigned i = 0; i < ITERS; ++i) sys_time();
+    unsigned long long t1 = rdtsc();
+    for (unsigned i = 0; i < ITERS; ++i) vdso_time();
+    unsigned long long t2 = rdtsc();
+    for (unsigned i = 0; i < ITERS; ++i) clock_monotonic_ns();
+    unsigned long long t3 = rdtsc();
+    unsigned trap_k = (unsigned)((t1 - t0) >> 10);
+    unsigned vdso_k = (unsigned)((t2 - t1) >> 10);
+    unsigned ns_k = (unsigned)((t3 - t2) >> 10);
+    print("  SYS_time:           "); print_num(per_call(trap_k)); print(" cycles/call\n");
+    print("  vdso_time:          "); print_num(per_call(vdso_k)); print(" cycles/call\n");
+    print("  clock_monotonic_ns: "); print_num(per_call(ns_k)); print(" cycles/call\n");
+    print_ratio(trap_k, vdso_k);
+    if (vdso_time() + 1 < sys_time()) print("  vdso_time behind SYS_time\n");
+    if (vdso_getpid() != getpid()) print("  vdso pid differs from getpid()\n");
+}
+
+int main(void) {
+    print("sysbench: null syscall latency\n");
+
+    unsigned long long t0 = rdtsc();
+    for (unsigned i = 0; i < ITERS; ++i) getpid();
+    unsigned long long t1 = rdtsc();
+    unsigned int_k = (unsigned)((t1 - t0) >> 10);
+    print("  int 0x80: "); print_num(per_call(int_k)); print(" cycles/call\n");
+
+    if (!have_sysenter()) {
+        print("  sysenter: not supported by this CPU\n");
+        bench_time();
+        return 0;
+    }
+    if (sysenter_syscall(SYS_getpid, 0, 0, 0, 0) != getpid()) {
+        print("  sysenter: result differs from int 0x80\n");
+        return 1;
+    }
+    t0 = rdtsc();
+    for (unsigned i = 0; i < ITERS; ++i) sysenter_syscall(SYS_getpid, 0, 0, 0, 0);
+    t1 = rdtsc();
+    unsigned fast_k = (unsigned)((t1 - t0) >> 10);
+    print("  sysenter: "); print_num(per_call(fast_k)); print(" cycles/call\n");
+    print_ratio(int_k, fast_k);
+    bench_time();
+    return 0;
+}
@@ -13,6 +13,49 @@
 #define SYS_wait   11
 #define SYS_getpid 12
 #define SYS_getppid 13
+#define SYS_getdents 14
+#define SYS_mmap   15
+#define SYS_munmap 16
+#define SYS_creat  17
+#define SYS_unlink 18
+#define SYS_sendfile 19
+#define SYS_io_setup 20
+#define SYS_io_enter 21
+#define SYS_lseek  22
+#define SYS_pread  23
+#define SYS_pwrite 24
+#define SYS_readv  25
+#define SYS_writev 26
+#define SYS_batch  28
+#define SYS_trace  29
+#define SYS_trace_read 30
+#define SYS_sysstat 31
+#define SYS_poll   32
+#define SYS_pipe   33
+#define SYS_ipc_call 34
+#define SYS_grant  35
+#define SYS_grant_map 36
+#define SYS_grant_revoke 37
+#define SYS_shm_create 38
+#define SYS_shm_map 39
+#define SYS_shm_unmap 40
+
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+/* Kernel struct mmap_args layout (see kernel/include/kernel/mmap.h). */
+struct mmap_args { unsigned addr, len, prot, flags; int fd; unsigned offset; };
+
+/* Kernel struct vfs_iovec layout. */
+struct iovec { void* iov_base; unsigned iov_len; };
+
+/* Kernel struct sys_batch_ent layout; flags for batch(). */
+struct sys_batch_ent { unsigned nr; unsigned args[4]; int result; };
+#define BATCH_STOP_ON_ERR 0x1
+
+/* Kernel struct pollfd layout. */
+struct pollfd { int fd; short events; short revents; };
 
 int write(int fd, const char* buf, unsigned len) {
     // Note: kernel SYS_write ignores fd and expects (buf, len) only
@@ -124,3 +167,415 @@ int getppid(void) {
     );
     return ret;
 }
+
+int getdents(int fd, void* buf, unsigned len) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_getdents), "b"(fd), "c"(buf), "d"(len)
+        : "memory"
+    );
+    return ret;
+}
+
+void* mmap(void* addr, unsigned len, int prot, int flags, int fd, unsigned offset) {
+    struct mmap_args a = { (unsigned)addr, len, (unsigned)prot, (unsigned)flags, fd, offset };
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_mmap), "b"(&a)
+        : "memory"
+    );
+    return (void*)ret;
+}
+
+int munmap(void* addr, unsigned len) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_munmap), "b"(addr), "c"(len)
+        : "memory"
+    );
+    return ret;
+}
+
+int creat(const char* path) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_creat), "b"(path)
+        : "memory"
+    );
+    return ret;
+}
+
+int unlink(const char* path) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_unlink), "b"(path)
+        : "memory"
+    );
+    return ret;
+}
+
+int sendfile(int out_fd, int in_fd, unsigned* offset, unsigned count) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_sendfile), "b"(out_fd), "c"(in_fd), "d"(offset), "S"(count)
+        : "memory"
+    );
+    return ret;
+}
+
+/* p is a struct io_ring_params (see kernel/include/kernel/ioring.h). */
+int io_setup(unsigned entries, void* p) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_io_setup), "b"(entries), "c"(p)
+        : "memory"
+    );
+    return ret;
+}
+
+int io_enter(int ring, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_io_enter), "b"(ring), "c"(to_submit), "d"(min_complete), "S"(flags)
+        : "memory"
+    );
+    return ret;
+}
+
+int lseek(int fd, int offset, int whence) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_lseek), "b"(fd), "c"(offset), "d"(whence)
+        : "memory"
+    );
+    return ret;
+}
+
+int pread(int fd, void* buf, unsigned len, unsigned offset) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_pread), "b"(fd), "c"(buf), "d"(len), "S"(offset)
+        : "memory"
+    );
+    return ret;
+}
+
+int pwrite(int fd, const void* buf, unsigned len, unsigned offset) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_pwrite), "b"(fd), "c"(buf), "d"(len), "S"(offset)
+        : "memory"
+    );
+    return ret;
+}
+
+int readv(int fd, const struct iovec* iov, int iovcnt) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_readv), "b"(fd), "c"(iov), "d"(iovcnt)
+        : "memory"
+    );
+    return ret;
+}
+
+int writev(int fd, const struct iovec* iov, int iovcnt) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_writev), "b"(fd), "c"(iov), "d"(iovcnt)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Kernel data page (kernel/include/kernel/vdso.h), mapped read-only in
+   every process. Reads are seqlocked against the timer and never trap. */
+#define VDSO_DATA_ADDR 0x2FFFE000u
+struct vdso_data {
+    volatile unsigned seq;
+    unsigned hz, ns_per_tick, tsc_mult, tsc_shift;
+    unsigned long long ticks, tick_tsc;
+    int pid, ppid;
+    unsigned htas_intent, htas_affinity;
+    int htas_priority_boost;
+    unsigned reserved[4];
+};
+#define VDSO ((const volatile struct vdso_data*)VDSO_DATA_ADDR)
+
+static unsigned vdso_begin(void) {
+    unsigned s;
+    while ((s = VDSO->seq) & 1) { }
+    __asm__ volatile("" ::: "memory");
+    return s;
+}
+
+static int vdso_retry(unsigned s) {
+    __asm__ volatile("" ::: "memory");
+    return VDSO->seq != s;
+}
+
+/* Nanoseconds since the timer started: PIT ticks plus the TSC time since
+   the last tick, capped below one tick so the clock never runs backwards. */
+unsigned long long clock_monotonic_ns(void) {
+    unsigned s, npt, mult, shift;
+    unsigned long long ticks, tsc0, now;
+    do {
+        s = vdso_begin();
+        ticks = VDSO->ticks;
+        tsc0 = VDSO->tick_tsc;
+        npt = VDSO->ns_per_tick;
+        mult = VDSO->tsc_mult;
+        shift = VDSO->tsc_shift;
+        __asm__ volatile("rdtsc" : "=A"(now));
+    } while (vdso_retry(s));
+    unsigned long long ns = ticks * npt;
+    if (mult && now > tsc0) {
+        unsigned long long d = now - tsc0;
+        unsigned long long frac = d >> 32 ? npt : (((unsigned long long)(unsigned)d * mult) >> shift);
+        ns += frac < npt ? frac : npt - 1;
+    }
+    return ns;
+}
+
+/* Whole seconds since boot, the value SYS_time returns. */
+unsigned vdso_time(void) {
+    unsigned s, hz, ticks;
+    do {
+        s = vdso_begin();
+        hz = VDSO->hz;
+        ticks = (unsigned)VDSO->ticks;
+    } while (vdso_retry(s));
+    return hz ? ticks / hz : 0;
+}
+
+int vdso_getpid(void) { return VDSO->pid; }
+int vdso_getppid(void) { return VDSO->ppid; }
+
+/* HTAS hint of this process: intent (PROFILE_*), CPU affinity mask and
+   latency boost. */
+void vdso_profile(unsigned* intent, unsigned* affinity, int* boost) {
+    unsigned s;
+    do {
+        s = vdso_begin();
+        if (intent) *intent = VDSO->htas_intent;
+        if (affinity) *affinity = VDSO->htas_affinity;
+        if (boost) *boost = VDSO->htas_priority_boost;
+    } while (vdso_retry(s));
+}
+
+/* Fast entry: sysenter_syscall(nr, a, b, c, d) makes the same call as
+   int 0x80 with nr in eax and a..d in ebx/ecx/edx/esi. The kernel returns
+   with SYSEXIT to the address in edi on the stack in ebp, both of which
+   are saved here. Only valid when the CPU has SEP (CPUID.1:EDX bit 11),
+   which is when the kernel enables it. */
+int sysenter_syscall(int nr, unsigned a, unsigned b, unsigned c, unsigned d);
+__asm__(
+    ".text\n"
+    ".globl sysenter_syscall\n"
+    ".type sysenter_syscall, @function\n"
+    "sysenter_syscall:\n"
+    "    pushl %ebp\n"
+    "    pushl %edi\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    movl 20(%esp), %eax\n"
+    "    movl 24(%esp), %ebx\n"
+    "    movl 28(%esp), %ecx\n"
+    "    movl 32(%esp), %edx\n"
+    "    movl 36(%esp), %esi\n"
+    "    movl %esp, %ebp\n"
+    "    call 1f\n"               /* position independent return address */
+    "1:  popl %edi\n"
+    "    addl $(2f - 1b), %edi\n"
+    "    sysenter\n"
+    "2:  popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %edi\n"
+    "    popl %ebp\n"
+    "    ret\n"
+    ".size sysenter_syscall, . - sysenter_syscall\n"
+);
+
+/* Run count calls in one kernel entry; returns how many ran. */
+int batch(struct sys_batch_ent* ents, unsigned count, unsigned flags) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_batch), "b"(ents), "c"(count), "d"(flags)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Log pid's system calls (0: this process) to the kernel trace ring. */
+int trace(int pid, int on) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_trace), "b"(pid), "c"(on)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Copy trace records (kernel struct systrace_rec) from *cursor on. */
+int trace_read(void* recs, unsigned max, unsigned* cursor) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_trace_read), "b"(recs), "c"(max), "d"(cursor)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Per-call counters (kernel struct systrace_stats) of pid; 0 is this
+   process, -1 the whole system. */
+int sysstat(int pid, void* stats) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_sysstat), "b"(pid), "c"(stats)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Wait up to timeout_ms (-1: forever) for one of fds to become ready;
+   returns how many are, 0 on timeout. */
+int poll(struct pollfd* fds, unsigned nfds, int timeout_ms) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_poll), "b"(fds), "c"(nfds), "d"(timeout_ms)
+        : "memory"
+    );
+    return ret;
+}
+
+/* fds[0] reads, fds[1] writes (with fwrite). */
+int pipe(int fds[2]) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_pipe), "b"(fds)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Synchronous call to IPC endpoint ep; msg[4] goes out in registers and is
+   replaced by the reply. 0 on success, -1 if the server is not waiting. */
+int ipc_call(int ep, unsigned msg[4]) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret), "+c"(msg[0]), "+d"(msg[1]), "+S"(msg[2]), "+D"(msg[3])
+        : "a"(SYS_ipc_call), "b"(ep)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Lend [addr, addr+len) to pid to_pid (0: anyone). flags 0 shares the
+   pages read-only, 1 transfers them. Returns a grant id or -1. */
+int grant(void* addr, unsigned len, int to_pid, unsigned flags) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_grant), "b"(addr), "c"(len), "d"(to_pid), "S"(flags)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Map a grant into this process; returns its address or (void*)-1. */
+void* grant_map(int id) {
+    void* ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_grant_map), "b"(id)
+        : "memory"
+    );
+    return ret;
+}
+
+int grant_revoke(int id) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_grant_revoke), "b"(id)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Open the shared memory segment called name, creating it with size bytes
+   if needed (name 0: a new anonymous one). Returns its id or -1. */
+int shm_create(const char* name, unsigned size) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_shm_create), "b"(name), "c"(size)
+        : "memory"
+    );
+    return ret;
+}
+
+/* Map segment id; returns its address or (void*)-1. */
+void* shm_map(int id) {
+    void* ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_shm_map), "b"(id)
+        : "memory"
+    );
+    return ret;
+}
+
+int shm_unmap(void* addr) {
+    int ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_shm_unmap), "b"(addr)
+        : "memory"
+    );
+    return ret;
+}
@@ -5,33 +5,226 @@
 #define SYS_close 5
 #define SYS_sbrk  6
 #define SYS_time  7
-#define SYS_fs_list 8
 #define SYS_fwrite  9
+#define SYS_getdents 14
+#define SYS_mmap     15
+#define SYS_munmap   16
+#define SYS_creat    17
+#define SYS_sendfile 19
+#define SYS_poll     32
+#define SYS_pipe     33
+#define PROT_READ    1
+#define MAP_PRIVATE  2
+#define MCAT_WINDOW  (64u*1024u)
+
+struct mmap_args { unsigned addr, len, prot, flags; int fd; unsigned offset; };
+
+/* Mirrors struct fs_dirent in kernel/include/kernel/fs.h */
+struct dirent { unsigned d_ino; unsigned d_off; unsigned short d_reclen; unsigned char d_type; unsigned char d_namlen; char d_name[]; };
+#define DT_DIR 2
+
+/* Mirrors struct pollfd in kernel/include/kernel/poll.h */
+struct pollfd { int fd; short events; short revents; };
+#define POLLIN  0x001
+#define POLLOUT 0x004
+/* A pipe reports POLLOUT with at least this much room (kernel PIPE_BUF), so
+   a write of up to this size never blocks. */
+#define PIPE_CHUNK 512u
 
 static inline int sys_write(const char* s, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_write),"b"(s),"c"(n):"memory","cc"); return r; }
 static inline int sys_exit(int code){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_exit),"b"(code):"memory","cc"); return r; }
 static inline int sys_read(int fd, void* buf, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_read),"b"(fd),"c"(buf),"d"(n):"memory","cc"); return r; }
 static inline int sys_open(const char* name){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_open),"b"(name):"memory","cc"); return r; }
 static inline int sys_close(int fd){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_close),"b"(fd):"memory","cc"); return r; }
-static inline int sys_fs_list(char* buf, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_fs_list),"b"(buf),"c"(n):"memory","cc"); return r; }
+static inline int sys_getdents(int fd, void* buf, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_getdents),"b"(fd),"c"(buf),"d"(n):"memory","cc"); return r; }
+static inline int sys_mmap(struct mmap_args* a){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_mmap),"b"(a):"memory","cc"); return r; }
+static inline int sys_munmap(void* addr, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_munmap),"b"(addr),"c"(n):"memory","cc"); return r; }
+static inline int sys_creat(const char* name){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_creat),"b"(name):"memory","cc"); return r; }
+static inline int sys_sendfile(int out, int in, unsigned* off, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_sendfile),"b"(out),"c"(in),"d"(off),"S"(n):"memory","cc"); return r; }
 static inline int sys_fwrite(int fd, const void* buf, unsigned n){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_fwrite),"b"(fd),"c"(buf),"d"(n):"memory","cc"); return r; }
+static inline int sys_poll(struct pollfd* fds, unsigned n, int timeout){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_poll),"b"(fds),"c"(n),"d"(timeout):"memory","cc"); return r; }
+static inline int sys_pipe(int* fds){ int r; __asm__ volatile("int $0x80":"=a"(r):"a"(SYS_pipe),"b"(fds):"memory","cc"); return r; }
 
 static unsigned strlen(const char* s){ unsigned n=0; while(s[n]) n++; return n; }
 static void puts(const char* s){ sys_write(s, strlen(s)); }
 static int streq(const char* a, const char* b){ while(*a && (*a==*b)){a++;b++;} return (unsigned char)*a - (unsigned char)*b; }
 
-static void cmd_ls(void){
-    char buf[512]; int n = sys_fs_list(buf, sizeof(buf)-1); if (n<0) n=0; buf[n]=0; sys_write(buf, n);
+/* Pipelines (`a | b`) run inside this one process: command output goes
+   through out(), which writes into the pipe and, whenever the pipe lacks
+   room, lets the filter on the right drain it. Filters take their input a
+   chunk at a time, so any amount of data passes through one page of pipe. */
+struct filter {
+    const char* name;
+    int  (*start)(const char* arg);         /* 0, or -1 after printing usage */
+    void (*feed)(const char* buf, unsigned n);
+    void (*finish)(void);
+};
+
+static int out_fd = 1;                      /* pipe write end while a pipeline runs */
+static const struct filter* sink;           /* right-hand side of the pipeline */
+static int sink_fd = -1;                    /* pipe read end */
+
+/* Feed what the pipe holds to the filter; with wait, read up to EOF. */
+static void drain(int wait){
+    char buf[PIPE_CHUNK];
+    for (;;) {
+        struct pollfd p = { sink_fd, POLLIN, 0 };
+        if (!wait && (sys_poll(&p, 1, 0) <= 0 || !(p.revents & POLLIN))) return;
+        int n = sys_read(sink_fd, buf, sizeof(buf));
+        if (n <= 0) return;
+        sink->feed(buf, (unsigned)n);
+    }
+}
+
+static void out(const char* s, unsigned n){
+    if (out_fd == 1) { sys_write(s, n); return; }
+    while (n) {
+        struct pollfd p = { out_fd, POLLOUT, 0 };
+        if (sys_poll(&p, 1, 0) <= 0 || !(p.revents & POLLOUT)) { drain(0); continue; }
+        unsigned k = n < PIPE_CHUNK ? n : PIPE_CHUNK;
+        if (sys_fwrite(out_fd, s, k) != (int)k) return;
+        s += k; n -= k;
+    }
+}
+
+static void put_num(unsigned v){
+    char b[12]; int i = 0;
+    do { b[i++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (i > 0) { char c = b[--i]; sys_write(&c, 1); }
+}
+
+/* wc: lines, words and bytes of the input. */
+static unsigned wc_lines, wc_words, wc_bytes; static int wc_inword;
+static int wc_start(const char* arg){ (void)arg; wc_lines = wc_words = wc_bytes = 0; wc_inword = 0; return 0; }
+static void wc_feed(const char* b, unsigned n){
+    wc_bytes += n;
+    for (unsigned i = 0; i < n; i++) {
+        char c = b[i];
+        if (c == '\n') wc_lines++;
+        int space = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+        if (!space && !wc_inword) wc_words++;
+        wc_inword = !space;
+    }
+}
+static void wc_finish(void){
+    put_num(wc_lines); puts(" "); put_num(wc_words); puts(" "); put_num(wc_bytes); puts("\n");
+}
+
+/* grep PAT: input lines containing PAT (lines longer than the buffer are
+   matched in pieces). */
+static char grep_pat[64]; static unsigned grep_plen;
+static char grep_line[256]; static unsigned grep_len;
+static int grep_start(const char* arg){
+    if (!arg || !*arg) { puts("usage: ... | grep PATTERN\n"); return -1; }
+    grep_plen = 0; while (arg[grep_plen] && grep_plen < sizeof(grep_pat)) { grep_pat[grep_plen] = arg[grep_plen]; grep_plen++; }
+    grep_len = 0;
+    return 0;
+}
+static void grep_flush(void){
+    for (unsigned i = 0; i + grep_plen <= grep_len; i++) {
+        unsigned k = 0; while (k < grep_plen && grep_line[i+k] == grep_pat[k]) k++;
+        if (k == grep_plen) {
+            sys_write(grep_line, grep_len);
+            if (grep_line[grep_len-1] != '\n') puts("\n");
+            break;
+        }
+    }
+    grep_len = 0;
+}
+static void grep_feed(const char* b, unsigned n){
+    for (unsigned i = 0; i < n; i++) {
+        grep_line[grep_len++] = b[i];
+        if (b[i] == '\n' || grep_len == sizeof(grep_line)) grep_flush();
+    }
+}
+static void grep_finish(void){ if (grep_len) grep_flush(); }
+
+/* cat with no file: copy the input to the console. */
+static int catin_start(const char* arg){ if (arg && *arg) { puts("usage: ... | cat\n"); return -1; } return 0; }
+static void catin_feed(const char* b, unsigned n){ sys_write(b, n); }
+static void catin_finish(void){ }
+
+static const struct filter filters[] = {
+    { "wc",   wc_start,    wc_feed,    wc_finish },
+    { "grep", grep_start,  grep_feed,  grep_finish },
+    { "cat",  catin_start, catin_feed, catin_finish },
+};
+
+static void cmd_ls(const char* path){
+    int fd = sys_open(path && *path ? path : "/");
+    if (fd < 0) { puts("ls: cannot open\n"); return; }
+    unsigned ents[128]; char line[260];
+    int n;
+    while ((n = sys_getdents(fd, ents, sizeof(ents))) > 0) {
+        for (int off = 0; off < n; ) {
+            const struct dirent* d = (const struct dirent*)((const char*)ents + off);
+            unsigned k = 0;
+            for (unsigned j = 0; j < d->d_namlen; j++) line[k++] = d->d_name[j];
+            if (d->d_type == DT_DIR) line[k++] = '/';
+            line[k++] = '\n';
+            out(line, k);
+            off += d->d_reclen;
+        }
+    }
+    sys_close(fd);
 }
 
 static void cmd_cat(const char* name){
     if (!name||!*name){ puts("usage: cat NAME\n"); return; }
     int fd = sys_open(name);
     if (fd < 0) { puts("cat: not found\n"); return; }
-    char buf[256];
-    while (1) { int n = sys_read(fd, buf, sizeof(buf)); if (n <= 0) break; sys_write(buf, (unsigned)n); }
+    if (out_fd == 1) {
+        /* The kernel moves the data from the page cache to the console. */
+        while (sys_sendfile(1, fd, 0, 65536u) > 0) { }
+    } else {
+        char buf[PIPE_CHUNK]; int n;
+        while ((n = sys_read(fd, buf, sizeof(buf))) > 0) out(buf, (unsigned)n);
+    }
     sys_close(fd);
-    puts("\n");
+    out("\n", 1);
+}
+
+static void cmd_cp(const char* args){
+    const char* src = args; const char* p = args;
+    while (p && *p && *p!=' ') p++;
+    if (!src || !*src || !*p){ puts("usage: cp SRC DST\n"); return; }
+    *(char*)p++ = 0; while (*p==' ') p++;
+    if (!*p){ puts("usage: cp SRC DST\n"); return; }
+    int in = sys_open(src);
+    if (in < 0) { puts("cp: not found\n"); return; }
+    int out = sys_creat(p);
+    if (out < 0) { puts("cp: cannot create\n"); sys_close(in); return; }
+    int n;
+    while ((n = sys_sendfile(out, in, 0, 65536u)) > 0) { }
+    if (n < 0) puts("cp: copy failed\n");
+    sys_close(out);
+    sys_close(in);
+}
+
+/* cat through a read-only mapping: pages come straight from the kernel page
+   cache, no read() copy. Text only: the zero fill past EOF ends the output. */
+static void cmd_mcat(const char* name){
+    if (!name||!*name){ puts("usage: mcat NAME\n"); return; }
+    int fd = sys_open(name);
+    if (fd < 0) { puts("mcat: not found\n"); return; }
+    for (unsigned off = 0;; off += MCAT_WINDOW) {
+        struct mmap_args a = { 0, MCAT_WINDOW, PROT_READ, MAP_PRIVATE, fd, off };
+        int r = sys_mmap(&a);
+        if (r == -1) { puts("mcat: mmap failed\n"); break; }
+        const char* p = (const char*)r;
+        unsigned n = 0;
+        while (n < MCAT_WINDOW && p[n]) n++;
+        if (n) out(p, n);
+        sys_munmap((void*)r, MCAT_WINDOW);
+        if (n < MCAT_WINDOW) break;
+    }
+    sys_close(fd);
+    out("\n", 1);
+}
+
+static void cmd_echo(const char* text){
+    if (text) out(text, strlen(text));
+    out("\n", 1);
 }
 
 static void cmd_write(const char* name){
@@ -42,8 +235,48 @@ static void cmd_write(const char* name){
     sys_close(fd);
 }
 
+static void run_command(char* p){
+    while (*p==' ') p++;
+    const char* cmd = p; while (*p && *p!=' ') p++; int has_arg = 0; if (*p){ *p++=0; while(*p==' ') p++; has_arg=1; }
+    if (!*cmd) return;
+    if (streq(cmd,"exit")==0) { sys_exit(0); }
+    else if (streq(cmd,"ls")==0) { cmd_ls(has_arg?p:0); }
+    else if (streq(cmd,"cat")==0) { cmd_cat(has_arg?p:0); }
+    else if (streq(cmd,"mcat")==0) { cmd_mcat(has_arg?p:0); }
+    else if (streq(cmd,"cp")==0) { cmd_cp(has_arg?p:0); }
+    else if (streq(cmd,"write")==0) { cmd_write(has_arg?p:0); }
+    else if (streq(cmd,"echo")==0) { cmd_echo(has_arg?p:0); }
+    else if (streq(cmd,"wc")==0 || streq(cmd,"grep")==0) { puts("usage: CMD | "); puts(cmd); puts("\n"); }
+    else { puts("unknown. try ls/cat/exit\n"); }
+}
+
+/* left | right, where right is a filter. */
+static void run_pipeline(char* left, char* right){
+    while (*right==' ') right++;
+    char* arg = right; while (*arg && *arg!=' ') arg++;
+    if (*arg){ *arg++=0; while (*arg==' ') arg++; }
+    const struct filter* f = 0;
+    for (unsigned i = 0; i < sizeof(filters)/sizeof(filters[0]); i++) if (streq(right, filters[i].name)==0) f = &filters[i];
+    if (!f) { puts("ush: right of | must be wc, grep or cat\n"); return; }
+    int fds[2];
+    if (sys_pipe(fds) != 0) { puts("ush: pipe failed\n"); return; }
+    if (f->start(arg) == 0) {
+        sink = f; sink_fd = fds[0]; out_fd = fds[1];
+        run_command(left);
+        out_fd = 1;
+        sys_close(fds[1]);
+        drain(1);
+        f->finish();
+        sink = 0; sink_fd = -1;
+    } else {
+        sys_close(fds[1]);
+    }
+    sys_close(fds[0]);
+}
+
 void main(void){
-    puts("ush: tiny user shell. Commands: ls, cat NAME, write NAME, exit\n");
+    puts("ush: tiny user shell. Commands: ls [PATH], cat NAME, mcat NAME, cp SRC DST, write NAME, echo TEXT, exit\n");
+    puts("     pipelines: CMD | wc, CMD | grep PAT, CMD | cat\n");
     char line[128];
     for(;;){
         puts("u$ ");
@@ -51,14 +284,13 @@ void main(void){
         if (n <= 0) continue;
         line[n]=0;
         /* strip CR/LF */
-        while (n>0 && (line[n-1]=='\n' || line[n-1]=='\r')) { line[--n]=0; }
-        const char* p = line; while (*p==' ') p++;
-        const char* cmd = p; while (*p && *p!=' ') p++; int has_arg = 0; if (*p){ *(char*)p++=0; while(*p==' ') p++; has_arg=1; }
-        if (!*cmd) continue;
-        if (streq(cmd,"exit")==0) { sys_exit(0); }
-        else if (streq(cmd,"ls")==0) { cmd_ls(); }
-        else if (streq(cmd,"cat")==0) { cmd_cat(has_arg?p:0); }
-        else if (streq(cmd,"write")==0) { cmd_write(has_arg?p:0); }
-        else { puts("unknown. try ls/cat/exit\n"); }
+        while (n>0 && (line[n-1]=='\n' || line[n-1]=='\r' || line[n-1]==' ')) { line[--n]=0; }
+        char* bar = line; while (*bar && *bar!='|') bar++;
+        if (*bar) {
+            char* e = bar; *bar = 0;
+            while (e > line && e[-1]==' ') *--e = 0;
+            run_pipeline(line, bar + 1);
+        }
+        else run_command(line);
     }
 }